@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "ZPCachePolicy.h"
+#include "ZPHash.h"
+#include "ZPLockProfiling.h"
+
+namespace ZPCache
+{
+
+struct ZPAdaptiveOptions
+{
+    double sampleRate = 1.0 / 64;  // 按key哈希抽样进入影子缓存的比例，影子容量按同一比例缩小
+    size_t minShadowCapacity = 64; // 影子容量的下限，容量乘以 sampleRate 不足时相应提高抽样比例
+    size_t period = 0;             // 每这么多次抽样读取比较一次各影子的命中数，0 表示影子容量的10倍
+    size_t initial = 0;            // 开始时使用的候选参数下标
+};
+
+// 自适应参数：同一策略按每个候选参数各建一个缩小的影子实例（值只占一个字节），按key哈希抽样一部分请求同时交给所有影子。
+// 抽样是按key而不是按请求，影子看到的是完整访问序列中一部分key的全部访问，命中率与全尺寸缓存相近（SHARDS 的空间抽样）。
+// 每个周期比较各影子的命中数，主缓存的参数经 setTuning 向最好的那个候选移动一格（爬山），工作负载换阶段后参数随之迁移。
+// 候选参数应按大小排好序，相邻候选的效果相近时爬山才有意义。Policy 的 setTuning 不支持时退化为固定参数的普通缓存。
+// 抽中的请求要再访问每个影子，访问倾斜时若热点key被抽中，实际抽中的请求比例会明显高于 sampleRate，候选不宜过多。
+// 影子只缩放构造参数中的第一个（容量），其余参数原样使用
+template<typename Key, typename Value, template<typename, typename> class Policy>
+class ZPAdaptiveCache : public ZPCachePolicy<Key, Value>
+{
+public:
+    using Cache = Policy<Key, Value>;
+
+    // capacity 与 args 原样转发给主缓存的构造函数
+    template<typename Capacity, typename... Args>
+    ZPAdaptiveCache(std::vector<double> candidates, const ZPAdaptiveOptions& options, Capacity capacity,
+                    const Args&... args)
+        : cache_(capacity, args...)
+        , candidates_(std::move(candidates))
+        , current_(std::min(options.initial, candidates_.empty() ? 0 : candidates_.size() - 1))
+    {
+        size_t fullCapacity = capacity > 0 ? static_cast<size_t>(capacity) : 0;
+        size_t shadowCapacity = static_cast<size_t>(static_cast<double>(fullCapacity) * options.sampleRate);
+        shadowCapacity = std::min(std::max(shadowCapacity, options.minShadowCapacity), fullCapacity);
+        double rate = fullCapacity ? static_cast<double>(shadowCapacity) / static_cast<double>(fullCapacity) : 0.0;
+        sampleAll_ = rate >= 1.0;
+        // rate>=1 时乘积超出uint64_t范围，转换是未定义行为；全采样时也用不到阈值
+        sampleThreshold_ = sampleAll_ ? 0 : static_cast<uint64_t>(rate * 18446744073709551616.0);
+        period_ = options.period ? options.period : std::max<size_t>(shadowCapacity * 10, 1);
+
+        if (candidates_.empty() || shadowCapacity == 0 || !policy().setTuning(candidates_[current_]))
+            return;
+        for (double candidate : candidates_)
+        {
+            shadows_.push_back(std::make_unique<Policy<Key, uint8_t>>(static_cast<Capacity>(shadowCapacity), args...));
+            shadows_.back()->setTuning(candidate);
+        }
+        shadowHits_ = std::make_unique<std::atomic<uint64_t>[]>(candidates_.size());
+    }
+
+    ~ZPAdaptiveCache() override = default;
+
+    void put(Key key, Value value) override
+    {
+        if (sampled(key))
+        {
+            for (auto& shadow : shadows_)
+                shadow->put(key, 1);
+        }
+        policy().put(std::move(key), std::move(value));
+    }
+
+    void put(Key key, Value value, std::chrono::nanoseconds ttl) override
+    {
+        if (sampled(key))
+        {
+            for (auto& shadow : shadows_)
+                shadow->put(key, 1, ttl);
+        }
+        policy().put(std::move(key), std::move(value), ttl);
+    }
+
+    std::optional<std::chrono::nanoseconds> timeToLive(const Key& key) override { return policy().timeToLive(key); }
+
+    bool get(Key key, Value& value) override
+    {
+        if (sampled(key))
+            replay(key);
+        return policy().get(key, value);
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    bool visit(const Key& key, const std::function<void(const Value&)>& visitor) override
+    {
+        if (sampled(key))
+            replay(key);
+        return policy().visit(key, visitor);
+    }
+
+    ZPCacheStats stats() const override { return static_cast<const ZPCachePolicy<Key, Value>&>(cache_).stats(); }
+
+    void enableLatencySampling(uint32_t sampleEvery) override { policy().enableLatencySampling(sampleEvery); }
+
+    bool setEvictionListener(ZPEvictionListener<Key, Value> listener) override
+    {
+        return policy().setEvictionListener(std::move(listener));
+    }
+
+    bool adaptive() const { return !shadows_.empty(); }
+
+    // 主缓存当前使用的候选参数
+    double tuning() const
+    {
+        std::lock_guard<ZPMutex> lock(tuneMutex_);
+        return candidates_.empty() ? 0.0 : candidates_[current_];
+    }
+
+    uint64_t adjustments() const { return adjustments_.load(std::memory_order_relaxed); }
+
+    Cache& cache() { return cache_; }
+
+private:
+    using Shadow = ZPCachePolicy<Key, uint8_t>;
+
+    // 派生策略可能只重载了部分 put/get，统一经基类接口调用
+    ZPCachePolicy<Key, Value>& policy() { return cache_; }
+
+    bool sampled(const Key& key) const
+    {
+        return !shadows_.empty() && (sampleAll_ || static_cast<uint64_t>(hashKey(key)) < sampleThreshold_);
+    }
+
+    // 抽中的读取交给所有影子，只记命中；影子的写入只来自 put，与主缓存看到的访问序列一致
+    void replay(const Key& key)
+    {
+        uint8_t ignored = 0;
+        for (size_t i = 0; i < shadows_.size(); ++i)
+        {
+            if (shadows_[i]->get(key, ignored))
+                shadowHits_[i].fetch_add(1, std::memory_order_relaxed);
+        }
+        if (sampledGets_.fetch_add(1, std::memory_order_relaxed) + 1 >= period_)
+            adapt();
+    }
+
+    // 周期结束时由一个线程比较，其他同时到达的线程直接返回
+    void adapt()
+    {
+        std::unique_lock<ZPMutex> lock(tuneMutex_, std::try_to_lock);
+        if (!lock.owns_lock() || sampledGets_.load(std::memory_order_relaxed) < period_)
+            return;
+        sampledGets_.store(0, std::memory_order_relaxed);
+
+        size_t best = current_;
+        uint64_t bestHits = 0;
+        uint64_t currentHits = 0;
+        for (size_t i = 0; i < shadows_.size(); ++i)
+        {
+            uint64_t hits = shadowHits_[i].exchange(0, std::memory_order_relaxed);
+            if (i == current_)
+                currentHits = hits;
+            if (hits > bestHits)
+            {
+                bestHits = hits;
+                best = i;
+            }
+        }
+        if (bestHits <= currentHits)
+            return;
+        current_ = best > current_ ? current_ + 1 : current_ - 1;
+        policy().setTuning(candidates_[current_]);
+        adjustments_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    Cache                                    cache_;
+    std::vector<double>                      candidates_;
+    std::vector<std::unique_ptr<Shadow>>     shadows_;     // 与 candidates_ 一一对应，不支持调参时为空
+    std::unique_ptr<std::atomic<uint64_t>[]> shadowHits_;  // 本周期各影子的命中数
+    bool                                     sampleAll_ = false;
+    uint64_t                                 sampleThreshold_ = 0; // 哈希小于它的key被抽中
+    size_t                                   period_ = 1;
+    std::atomic<size_t>                      sampledGets_{0};
+    mutable ZPMutex                          tuneMutex_;   // 保护 current_
+    size_t                                   current_;
+    std::atomic<uint64_t>                    adjustments_{0};
+};
+
+} // namespace ZPCache
@@ -0,0 +1,469 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ZPCachePolicy.h"
+#include "ZPFlatHashMap.h"
+#include "ZPHash.h"
+#include "ZPLockProfiling.h"
+#include "ZPLruCache.h"
+#include "ZPSingleFlight.h"
+
+namespace ZPCache
+{
+
+// 把一批条目写回后端。写回失败时抛出异常：写穿模式下异常交给put的调用者，写回模式下这一批被丢弃并计入 failedBatches
+template <typename Key, typename Value>
+using ZPBatchWriter = std::function<void(std::span<const std::pair<Key, Value>>)>;
+
+enum class ZPWriteMode
+{
+    WriteThrough, // put 在调用线程上先写后端再写缓存，后端失败时缓存不变
+    WriteBehind,  // put 只写缓存并把条目交给后台线程，批量写回
+};
+
+struct ZPWriteBehindOptions
+{
+    size_t                    maxBatch = 256;      // 积压到这么多个不同key就立即写出，也是一次调用writer的条目上限
+    size_t                    maxPending = 65536;  // 积压的不同key的上限，队列满时put阻塞，直到后台线程取走这一批
+    std::chrono::milliseconds flushInterval{50};   // 不满一批时最多等待这么久写出
+};
+
+// 写回队列：put把条目放进待写批，同一个key在被取走之前多次写入只保留最后一次的值；
+// 后台线程攒够一批或等到 flushInterval 就把整批取走，在锁外按 maxBatch 分段调用writer。
+// 正在写出的那一批仍可通过 lookup 查到，读穿加载不会在写回完成之前从后端读到旧值。
+// 析构时写出全部积压再退出
+template <typename Key, typename Value>
+class ZPWriteBehindQueue
+{
+public:
+    ZPWriteBehindQueue(ZPBatchWriter<Key, Value> writer, const ZPWriteBehindOptions& options)
+        : writer_(std::move(writer))
+        , options_(normalize(options))
+        , pending_(std::make_unique<Batch>(options_.maxBatch))
+        , writing_(std::make_unique<Batch>(options_.maxBatch))
+        , worker_([this] { run(); })
+    {}
+
+    ~ZPWriteBehindQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        workReady_.notify_one();
+        worker_.join();
+    }
+
+    ZPWriteBehindQueue(const ZPWriteBehindQueue&) = delete;
+    ZPWriteBehindQueue& operator=(const ZPWriteBehindQueue&) = delete;
+
+    // 已在待写批中的key直接覆盖，不会阻塞；否则队列满时等待后台线程取走当前这一批
+    void enqueue(const Key& key, Value value)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;)
+        {
+            auto it = pending_->index.find(key);
+            if (it != pending_->index.end())
+            {
+                pending_->entries[it->second].second = std::move(value);
+                ++enqueued_;
+                return;
+            }
+            if (pending_->entries.size() < options_.maxPending)
+                break;
+            spaceAvailable_.wait(lock);
+        }
+        pending_->index.try_emplace(key, pending_->entries.size());
+        pending_->entries.emplace_back(key, std::move(value));
+        ++enqueued_;
+        if (pending_->entries.size() >= options_.maxBatch)
+            workReady_.notify_one();
+    }
+
+    // 查找尚未写回后端的最新值
+    bool lookup(const Key& key, Value& value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Batch* batch : {pending_.get(), writing_.get()})
+        {
+            auto it = batch->index.find(key);
+            if (it != batch->index.end())
+            {
+                value = batch->entries[it->second].second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 立即写出积压，并等待调用之前入队的条目全部写回（或失败）
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint64_t target = enqueued_;
+        flushTarget_ = std::max(flushTarget_, target);
+        workReady_.notify_one();
+        drained_.wait(lock, [&] { return written_ >= target; });
+    }
+
+    uint64_t writtenEntries() const { return writtenEntries_.load(std::memory_order_relaxed); }
+    uint64_t failedBatches() const { return failedBatches_.load(std::memory_order_relaxed); }
+
+private:
+    using IndexMap = ZPFlatHashMap<Key, size_t>; // key -> entries 中的下标
+
+    struct Batch
+    {
+        explicit Batch(size_t reserveCount) : index(reserveCount) { entries.reserve(reserveCount); }
+
+        std::vector<std::pair<Key, Value>> entries;
+        IndexMap                           index;
+    };
+
+    static ZPWriteBehindOptions normalize(ZPWriteBehindOptions options)
+    {
+        options.maxBatch = std::max<size_t>(options.maxBatch, 1);
+        options.maxPending = std::max(options.maxPending, options.maxBatch);
+        return options;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;)
+        {
+            workReady_.wait_for(lock, options_.flushInterval, [&]
+            {
+                return stopping_ || pending_->entries.size() >= options_.maxBatch ||
+                       (flushTarget_ > written_ && !pending_->entries.empty());
+            });
+            if (pending_->entries.empty())
+            {
+                if (stopping_)
+                    return;
+                continue;
+            }
+
+            // 整批取走，生产者立即可以继续写入新的一批
+            std::swap(pending_, writing_);
+            uint64_t batchEnd = enqueued_;
+            spaceAvailable_.notify_all();
+            lock.unlock();
+            writeOut(writing_->entries);
+            lock.lock();
+
+            writing_->entries.clear();
+            writing_->index.clear();
+            written_ = batchEnd;
+            drained_.notify_all();
+        }
+    }
+
+    void writeOut(std::span<const std::pair<Key, Value>> entries)
+    {
+        for (size_t offset = 0; offset < entries.size(); offset += options_.maxBatch)
+        {
+            std::span<const std::pair<Key, Value>> chunk =
+                entries.subspan(offset, std::min(options_.maxBatch, entries.size() - offset));
+            try
+            {
+                writer_(chunk);
+                writtenEntries_.fetch_add(chunk.size(), std::memory_order_relaxed);
+            }
+            catch (...)
+            {
+                failedBatches_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    ZPBatchWriter<Key, Value> writer_;
+    ZPWriteBehindOptions      options_;
+    std::mutex                mutex_;
+    std::condition_variable   workReady_;      // 唤醒后台线程
+    std::condition_variable   spaceAvailable_; // 唤醒因队列满而阻塞的put
+    std::condition_variable   drained_;        // 唤醒等待flush的调用者
+    std::unique_ptr<Batch>    pending_;        // 正在积累的一批
+    std::unique_ptr<Batch>    writing_;        // 后台线程正在写出的一批
+    uint64_t                  enqueued_ = 0;   // 累计入队（含覆盖）的次数
+    uint64_t                  written_ = 0;    // 已写出的批覆盖到的 enqueued_
+    uint64_t                  flushTarget_ = 0;
+    bool                      stopping_ = false;
+    std::atomic<uint64_t>     writtenEntries_{0};
+    std::atomic<uint64_t>     failedBatches_{0};
+    std::thread               worker_;         // 最后构造，启动时其余成员都已就绪
+};
+
+// 后端存储的接入方式，三项都可以为空
+template <typename Key, typename Value>
+struct ZPBackingStore
+{
+    ZPLoader<Key, Value>           loader;  // 缓存未命中时读后端；后端没有该key时抛出异常
+    ZPBatchWriter<Key, Value>      writer;  // 写回后端
+    ZPEvictionListener<Key, Value> onEvict; // 交给缓存的容量淘汰回调
+    ZPWriteMode                    mode = ZPWriteMode::WriteBehind;
+    ZPWriteBehindOptions           writeBehind;
+};
+
+// 在一个缓存策略前接入慢速后端：未命中时读穿（同一个key同时只加载一次），put按写穿或写回模式写后端。
+// 写回模式下put只写内存和队列，后端看到的是合并过的批量写；被淘汰的脏条目仍留在队列中，不会丢失。
+// 每个key有一个写版本号，put先递增版本再写缓存；读穿的结果只在加载期间版本没有变化时写入，不会覆盖并发put写入的新值。
+// Cache 是任意 ZPCachePolicy 实现，由构造函数的其余参数原地构造
+template <typename Key, typename Value, typename Cache = ZPLruCache<Key, Value>>
+class ZPBackedCache : public ZPCachePolicy<Key, Value>
+{
+    static_assert(std::is_base_of_v<ZPCachePolicy<Key, Value>, Cache>, "Cache must implement ZPCachePolicy");
+
+public:
+    template <typename... Args>
+    explicit ZPBackedCache(ZPBackingStore<Key, Value> store, Args&&... args)
+        : cache_(std::forward<Args>(args)...)
+        , loader_(std::move(store.loader))
+    {
+        if (store.onEvict)
+            cache_.setEvictionListener(std::move(store.onEvict));
+        if (store.mode == ZPWriteMode::WriteBehind && store.writer)
+            queue_ = std::make_unique<ZPWriteBehindQueue<Key, Value>>(std::move(store.writer), store.writeBehind);
+        else
+            writer_ = std::move(store.writer);
+    }
+
+    ~ZPBackedCache() override = default;
+
+    void put(Key key, Value value) override
+    {
+        if (writer_)
+            writeThrough(key, value);
+        if (queue_)
+            queue_->enqueue(key, value);
+        bumpVersion(key);
+        cache_.put(key, std::move(value));
+    }
+
+    void put(Key key, Value value, std::chrono::nanoseconds ttl) override
+    {
+        if (writer_)
+            writeThrough(key, value);
+        if (queue_)
+            queue_->enqueue(key, value);
+        bumpVersion(key);
+        cache_.put(key, std::move(value), ttl);
+    }
+
+    // 未命中时读后端并写入缓存，同一个key同时只加载一次；loader 抛出异常（例如后端没有该key）时返回false
+    bool get(Key key, Value& value) override
+    {
+        if (cache_.get(key, value))
+            return true;
+        return loader_ && readThrough(key, value);
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    bool visit(const Key& key, const std::function<void(const Value&)>& visitor) override
+    {
+        if (cache_.visit(key, visitor))
+            return true;
+        Value value{};
+        if (!loader_ || !get(key, value))
+            return false;
+        visitor(value);
+        return true;
+    }
+
+    bool getHashed(const ZPHashedKey<Key>& key, Value& value) override
+    {
+        if (cache_.getHashed(key, value))
+            return true;
+        return loader_ && get(key.materialize(), value);
+    }
+
+    bool visitHashed(const ZPHashedKey<Key>& key, const std::function<void(const Value&)>& visitor) override
+    {
+        if (cache_.visitHashed(key, visitor))
+            return true;
+        Value value{};
+        if (!loader_ || !get(key.materialize(), value))
+            return false;
+        visitor(value);
+        return true;
+    }
+
+    // 先按缓存策略的批量查询，未命中的key再逐个读穿
+    size_t getMany(std::span<const Key> keys, std::span<Value> values, std::vector<bool>& hits) override
+    {
+        size_t hitCount = cache_.getMany(keys, values, hits);
+        if (!loader_)
+            return hitCount;
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            if (!hits[i] && get(keys[i], values[i]))
+            {
+                hits[i] = true;
+                ++hitCount;
+            }
+        }
+        return hitCount;
+    }
+
+    // 写穿模式下整批一次写后端
+    void putMany(std::span<const Key> keys, std::span<const Value> values) override
+    {
+        if (writer_)
+        {
+            std::vector<std::pair<Key, Value>> batch;
+            batch.reserve(keys.size());
+            for (size_t i = 0; i < keys.size(); ++i)
+                batch.emplace_back(keys[i], values[i]);
+            writer_(batch);
+        }
+        if (queue_)
+        {
+            for (size_t i = 0; i < keys.size(); ++i)
+                queue_->enqueue(keys[i], values[i]);
+        }
+        for (const Key& key : keys)
+            bumpVersion(key);
+        cache_.putMany(keys, values);
+    }
+
+    std::optional<std::chrono::nanoseconds> timeToLive(const Key& key) override { return cache_.timeToLive(key); }
+
+    ZPCacheStats stats() const override { return cache_.stats(); }
+
+    void enableLatencySampling(uint32_t sampleEvery) override { cache_.enableLatencySampling(sampleEvery); }
+
+    bool setEvictionListener(ZPEvictionListener<Key, Value> listener) override
+    {
+        return cache_.setEvictionListener(std::move(listener));
+    }
+
+    // 写回模式下等待此前的put全部写到后端，写穿模式下什么也不做
+    void flush()
+    {
+        if (queue_)
+            queue_->flush();
+    }
+
+    // 写回模式下成功写出的条目数与失败的批数，写穿模式下恒为0
+    uint64_t writtenEntries() const { return queue_ ? queue_->writtenEntries() : 0; }
+    uint64_t failedBatches() const { return queue_ ? queue_->failedBatches() : 0; }
+
+    Cache& cache() { return cache_; }
+
+private:
+    void writeThrough(const Key& key, const Value& value)
+    {
+        std::pair<Key, Value> entry(key, value);
+        writer_(std::span<const std::pair<Key, Value>>(&entry, 1));
+    }
+
+    static constexpr size_t kKeyStripes = 64;
+
+    struct KeyStripe
+    {
+        ZPMutex  mutex;
+        uint64_t version = 0; // 落在本条的key每次put都递增
+    };
+
+    KeyStripe& stripeFor(const Key& key) { return stripes_[hashKey(key) & (kKeyStripes - 1)]; }
+
+    uint64_t versionOf(const Key& key)
+    {
+        KeyStripe& stripe = stripeFor(key);
+        std::lock_guard<ZPMutex> lock(stripe.mutex);
+        return stripe.version;
+    }
+
+    void bumpVersion(const Key& key)
+    {
+        KeyStripe& stripe = stripeFor(key);
+        std::lock_guard<ZPMutex> lock(stripe.mutex);
+        ++stripe.version;
+    }
+
+    // 加载者负责读后端并写入缓存，其余调用者等待同一个结果
+    bool readThrough(const Key& key, Value& value)
+    {
+        auto flight = loads_.join(key);
+        if (!flight.leader())
+        {
+            try
+            {
+                value = flight.future.get();
+                return true;
+            }
+            catch (...)
+            {
+                return false;
+            }
+        }
+        // 从未命中到成为加载者之间，上一次加载可能刚好完成并写入
+        if (cache_.get(key, value))
+        {
+            loads_.complete(key, flight, value);
+            return true;
+        }
+
+        uint64_t version = versionOf(key);
+        try
+        {
+            value = loadFromStore(key);
+        }
+        catch (...)
+        {
+            loads_.fail(key, flight, std::current_exception());
+            return false;
+        }
+        {
+            // put先递增版本再写缓存：检查与写入在条锁内完成，版本没变时之后的put一定会覆盖这次写入
+            KeyStripe& stripe = stripeFor(key);
+            std::lock_guard<ZPMutex> lock(stripe.mutex);
+            if (stripe.version == version)
+                cache_.put(key, value);
+        }
+        loads_.complete(key, flight, value);
+        return true;
+    }
+
+    // 还在写回队列中的值比后端的新
+    Value loadFromStore(const Key& key)
+    {
+        Value value{};
+        if (queue_ && queue_->lookup(key, value))
+            return value;
+        return loader_(key);
+    }
+
+private:
+    Cache                                             cache_;
+    ZPLoader<Key, Value>                              loader_;      // 为空时不读穿
+    ZPBatchWriter<Key, Value>                         writer_;      // 仅写穿模式
+    std::array<KeyStripe, kKeyStripes>                stripes_;
+    ZPSingleFlight<Key, Value>                        loads_;       // 正在进行的读穿
+    std::unique_ptr<ZPWriteBehindQueue<Key, Value>>   queue_;       // 仅写回模式；先于 cache_ 析构，析构时写出积压
+};
+
+} // namespace ZPCache
@@ -1,8 +1,45 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "ZPCacheStats.h"
+#include "ZPHash.h"
+#include "ZPSingleFlight.h"
+
 namespace ZPCache
 {
 
+// 条目权重（通常是值占用的字节数）。按权重计容量的缓存用权重之和代替条目数与容量比较
+template <typename Key, typename Value>
+using ZPWeigher = std::function<size_t(const Key&, const Value&)>;
+
+// 未命中时由 getOrLoad 调用，返回要写入缓存的值；抛出的异常会原样交给所有等待这次加载的调用者
+template <typename Key, typename Value>
+using ZPLoader = std::function<Value(const Key&)>;
+
+// 容量淘汰时的回调，在缓存的锁内调用，结点复用或释放之前拿到被淘汰的key和值；回调中不能再访问本缓存。
+// TTL到期、覆盖写入与删除都不通知
+template <typename Key, typename Value>
+using ZPEvictionListener = std::function<void(const Key&, const Value&)>;
+
+// 异步加载的执行器：把任务交给线程池、事件循环或协程调度器去执行
+using ZPExecutor = std::function<void(std::function<void()>)>;
+
+struct ZPLoadOptions
+{
+    std::chrono::nanoseconds ttl{0};          // >0 时加载结果带TTL写入
+    std::chrono::nanoseconds refreshAhead{0}; // >0 时命中的条目剩余TTL不足它就提前重新加载，旧值照常返回
+};
+
 template <typename Key, typename Value>
 class ZPCachePolicy
 {
@@ -12,11 +49,229 @@ public:
     // 添加缓存接口
     virtual void put(Key key, Value value) = 0;
 
+    // 带TTL的添加：ttl之后条目不再命中；ttl<=0 等同于删除。不支持TTL的策略忽略ttl，按普通put处理
+    virtual void put(Key key, Value value, std::chrono::nanoseconds ttl)
+    {
+        (void)ttl;
+        put(key, std::move(value));
+    }
+
+    // 条目的剩余存活时间，不修改访问顺序；不在缓存中或没有TTL时返回 nullopt
+    virtual std::optional<std::chrono::nanoseconds> timeToLive(const Key& key)
+    {
+        (void)key;
+        return std::nullopt;
+    }
+
     // key是传入参数  访问到的值以传出参数的形式返回 | 访问成功返回true
     virtual bool get(Key key, Value& value) = 0;
     // 如果缓存中能找到key，则直接返回value
     virtual Value get(Key key) = 0;
 
+    // 用预先算好哈希的key查询，std::string 键可以直接传 string_view / const char*，例如 get(ZPHashedKey<std::string>(view), value)。
+    // 支持的策略在分片路由与所有内部索引中复用同一个哈希；默认实现构造一次Key后调用get
+    virtual bool getHashed(const ZPHashedKey<Key>& key, Value& value)
+    {
+        return get(key.materialize(), value);
+    }
+
+    virtual bool visitHashed(const ZPHashedKey<Key>& key, const std::function<void(const Value&)>& visitor)
+    {
+        return visit(key.materialize(), visitor);
+    }
+
+    // 零拷贝访问：命中时在缓存内部的锁保护下把值的引用交给visitor，返回是否命中。
+    // visitor执行期间持有缓存锁，应当尽快返回且不能再调用本缓存。默认实现退化为拷贝一次
+    virtual bool visit(const Key& key, const std::function<void(const Value&)>& visitor)
+    {
+        Value value{};
+        if (!get(key, value))
+            return false;
+        visitor(value);
+        return true;
+    }
+
+    // 用args原地构造一次Value，之后沿put一路移动进缓存结点，不产生深拷贝
+    template<typename... Args>
+    void emplace(const Key& key, Args&&... args)
+    {
+        put(key, Value(std::forward<Args>(args)...));
+    }
+
+    // 批量查询：values[i]、hits[i]与keys[i]一一对应，返回命中个数。
+    // 默认逐个调用get，具体策略可以覆盖为只加一次锁并预取索引槽位的实现
+    virtual size_t getMany(std::span<const Key> keys, std::span<Value> values, std::vector<bool>& hits)
+    {
+        hits.assign(keys.size(), false);
+        size_t hitCount = 0;
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            if (get(keys[i], values[i]))
+            {
+                hits[i] = true;
+                ++hitCount;
+            }
+        }
+        return hitCount;
+    }
+
+    // 批量添加：values[i]对应keys[i]
+    virtual void putMany(std::span<const Key> keys, std::span<const Value> values)
+    {
+        for (size_t i = 0; i < keys.size(); ++i)
+            put(keys[i], values[i]);
+    }
+
+    // 统计快照：命中、未命中、写入、淘汰以及各策略特有的计数。不提供统计的策略返回全零
+    virtual ZPCacheStats stats() const { return {}; }
+
+    // 开启get/put延迟采样（每sampleEvery次采样一次，0关闭），结果见stats()。应在并发使用缓存之前调用
+    virtual void enableLatencySampling(uint32_t sampleEvery) { (void)sampleEvery; }
+
+    // 设置容量淘汰的回调，传空函数取消。应在并发使用缓存之前调用；不支持的策略返回false
+    virtual bool setEvictionListener(ZPEvictionListener<Key, Value> listener)
+    {
+        (void)listener;
+        return false;
+    }
+
+    // 在线调整策略的主要参数（含义由各策略说明，例如 LRU-K 的 k、ARC 的转换阈值），供 ZPAdaptiveCache 使用。
+    // 可以与读写并发调用；没有可调参数的策略返回false
+    virtual bool setTuning(double value)
+    {
+        (void)value;
+        return false;
+    }
+
+    // 读取key，未命中时调用loader加载并写入缓存。同一个key同时只有一个调用者执行loader，
+    // 其余调用者等待同一个结果，结果只写入一次；loader抛出的异常会交给所有等待者，且不写入缓存。
+    // 设置 refreshAhead 时，命中但即将过期的条目由第一个发现的调用者同步重新加载，其余调用者照常拿到旧值
+    Value getOrLoad(const Key& key, const ZPLoader<Key, Value>& loader, const ZPLoadOptions& options = {})
+    {
+        Value value{};
+        if (get(key, value))
+        {
+            if (!needsRefresh(key, options))
+                return value;
+            auto flight = loads_.join(key);
+            if (!flight.leader())
+                return value; // 已有调用者在刷新
+            try
+            {
+                return load(key, loader, options, flight);
+            }
+            catch (...)
+            {
+                return value; // 刷新失败时旧值仍然有效，下一次命中会再尝试
+            }
+        }
+
+        auto flight = loads_.join(key);
+        if (!flight.leader())
+            return flight.future.get();
+        // 从未命中到成为加载者之间，上一次加载可能刚好完成并写入，再查一次避免重复加载
+        if (get(key, value))
+        {
+            loads_.complete(key, flight, value);
+            return value;
+        }
+        return load(key, loader, options, flight);
+    }
+
+    // getOrLoad的异步版本：立即返回 shared_future，加载在executor上执行，适合在协程或事件循环中等待。
+    // 命中时返回已就绪的future；提前刷新同样交给executor，调用者拿到旧值。
+    // 缓存必须比它发出的加载任务活得更久
+    std::shared_future<Value> getOrLoadAsync(const Key& key, ZPLoader<Key, Value> loader, const ZPExecutor& executor,
+                                             const ZPLoadOptions& options = {})
+    {
+        Value value{};
+        if (get(key, value))
+        {
+            if (needsRefresh(key, options))
+            {
+                auto flight = loads_.join(key);
+                if (flight.leader())
+                    submitLoad(key, std::move(loader), executor, options, flight);
+            }
+            return readyFuture(std::move(value));
+        }
+
+        auto flight = loads_.join(key);
+        if (!flight.leader())
+            return flight.future;
+        if (get(key, value))
+        {
+            loads_.complete(key, flight, value);
+            return flight.future;
+        }
+        std::shared_future<Value> future = flight.future;
+        submitLoad(key, std::move(loader), executor, options, flight);
+        return future;
+    }
+
+private:
+    using Flight = typename ZPSingleFlight<Key, Value>::Flight;
+
+    bool needsRefresh(const Key& key, const ZPLoadOptions& options)
+    {
+        if (options.refreshAhead.count() <= 0)
+            return false;
+        std::optional<std::chrono::nanoseconds> remaining = timeToLive(key);
+        return remaining && *remaining < options.refreshAhead;
+    }
+
+    // 由加载者调用：先写入缓存再唤醒等待者
+    Value load(const Key& key, const ZPLoader<Key, Value>& loader, const ZPLoadOptions& options, Flight& flight)
+    {
+        try
+        {
+            Value value = loader(key);
+            if (options.ttl.count() > 0)
+                put(key, value, options.ttl);
+            else
+                put(key, value);
+            loads_.complete(key, flight, value);
+            return value;
+        }
+        catch (...)
+        {
+            loads_.fail(key, flight, std::current_exception());
+            throw;
+        }
+    }
+
+    void submitLoad(const Key& key, ZPLoader<Key, Value> loader, const ZPExecutor& executor,
+                    const ZPLoadOptions& options, Flight& flight)
+    {
+        try
+        {
+            executor([this, key, loader = std::move(loader), options, flight]() mutable
+            {
+                try
+                {
+                    load(key, loader, options, flight);
+                }
+                catch (...)
+                {
+                    // 异常已经交给了 future
+                }
+            });
+        }
+        catch (...)
+        {
+            loads_.fail(key, flight, std::current_exception()); // 执行器拒绝任务
+        }
+    }
+
+    static std::shared_future<Value> readyFuture(Value value)
+    {
+        std::promise<Value> promise;
+        promise.set_value(std::move(value));
+        return promise.get_future().share();
+    }
+
+private:
+    ZPSingleFlight<Key, Value> loads_; // 正在进行的加载
 };
 
 } // namespace ZPCache
\ No newline at end of file
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ZPCache
+{
+
+// 对数线性延迟直方图：每个2的幂区间再分 kSubBuckets 份，相对误差约 1/kSubBuckets。
+// 这是快照里使用的普通版本，可合并（分片缓存把各分片的直方图加在一起）并求分位数；zpcache_bench 的各线程也各持一份
+class ZPLatencyHistogram
+{
+public:
+    static constexpr size_t kSubBucketBits = 3;
+    static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+    static constexpr size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    static size_t indexOf(uint64_t ns)
+    {
+        if (ns < kSubBuckets)
+            return static_cast<size_t>(ns);
+        size_t msb = 63 - static_cast<size_t>(__builtin_clzll(ns));
+        size_t shift = msb - kSubBucketBits;
+        return (shift + 1) * kSubBuckets + (static_cast<size_t>(ns >> shift) & (kSubBuckets - 1));
+    }
+
+    static uint64_t upperBoundOf(size_t index)
+    {
+        size_t group = index / kSubBuckets;
+        uint64_t sub = index % kSubBuckets;
+        if (group == 0)
+            return sub;
+        return (((kSubBuckets | sub) + 1) << (group - 1)) - 1;
+    }
+
+    void record(uint64_t ns) { add(indexOf(ns), 1); }
+
+    void add(size_t index, uint64_t n)
+    {
+        if (counts_.empty())
+            counts_.assign(kBucketCount, 0);
+        counts_[index] += n;
+        total_ += n;
+    }
+
+    void merge(const ZPLatencyHistogram& other)
+    {
+        for (size_t i = 0; i < other.counts_.size(); ++i)
+        {
+            if (other.counts_[i])
+                add(i, other.counts_[i]);
+        }
+    }
+
+    uint64_t count() const { return total_; }
+
+    // 第 p 分位（0 < p <= 1）所在桶的上界，单位纳秒；没有样本时返回0
+    uint64_t percentile(double p) const
+    {
+        if (total_ == 0)
+            return 0;
+        uint64_t rank = std::clamp<uint64_t>(static_cast<uint64_t>(std::ceil(p * total_)), 1, total_);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i)
+        {
+            seen += counts_[i];
+            if (seen >= rank)
+                return upperBoundOf(i);
+        }
+        return upperBoundOf(kBucketCount - 1);
+    }
+
+private:
+    std::vector<uint64_t> counts_; // 没有样本时保持为空，快照不必携带整张表
+    uint64_t              total_ = 0;
+};
+
+// 某一时刻的统计快照。ghost 命中、提升、老化、容量划分只对相应策略有意义，其余策略为0
+struct ZPCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t puts = 0;
+    uint64_t evictions = 0;
+    uint64_t expirations = 0;        // 因TTL到期被回收的条目数，同时计入 evictions
+    uint64_t recencyGhostHits = 0;   // ARC: 命中 B1（LRU部分的幽灵表）
+    uint64_t frequencyGhostHits = 0; // ARC: 命中 B2（LFU部分的幽灵表）
+    uint64_t promotions = 0;         // LRU-K: 从访问历史进入主缓存的次数；ARC: 从LRU部分转入LFU部分的次数
+    uint64_t agingRuns = 0;          // LFU: 开始的老化轮数
+    size_t   recencyCapacity = 0;    // ARC: ArcLruPart 当前容量
+    size_t   frequencyCapacity = 0;  // ARC: ArcLfuPart 当前容量
+    ZPLatencyHistogram getLatency;   // 仅开启采样后才有数据
+    ZPLatencyHistogram putLatency;
+
+    double hitRate() const
+    {
+        uint64_t lookups = hits + misses;
+        return lookups ? static_cast<double>(hits) / lookups : 0.0;
+    }
+
+    ZPCacheStats& operator+=(const ZPCacheStats& other)
+    {
+        hits += other.hits;
+        misses += other.misses;
+        puts += other.puts;
+        evictions += other.evictions;
+        expirations += other.expirations;
+        recencyGhostHits += other.recencyGhostHits;
+        frequencyGhostHits += other.frequencyGhostHits;
+        promotions += other.promotions;
+        agingRuns += other.agingRuns;
+        recencyCapacity += other.recencyCapacity;
+        frequencyCapacity += other.frequencyCapacity;
+        getLatency.merge(other.getLatency);
+        putLatency.merge(other.putLatency);
+        return *this;
+    }
+};
+
+enum class ZPCacheEvent : size_t
+{
+    Hit,
+    Miss,
+    Put,
+    Eviction,
+    Expiration,
+    RecencyGhostHit,
+    FrequencyGhostHit,
+    Promotion,
+    AgingRun,
+    Count
+};
+
+// 每个缓存实例（分片缓存中即每个分片）各自持有一份。计数都是 relaxed 原子操作，
+// 绝大多数调用点已持有该实例的锁，计数所在缓存行本就归当前线程独占，不会额外引入争用
+class ZPCacheCounters
+{
+public:
+    void add(ZPCacheEvent event, uint64_t n = 1)
+    {
+        counters_[static_cast<size_t>(event)].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t load(ZPCacheEvent event) const
+    {
+        return counters_[static_cast<size_t>(event)].load(std::memory_order_relaxed);
+    }
+
+    // 写入快照中的计数与延迟直方图，容量划分等策略特有字段由调用者填写
+    void fill(ZPCacheStats& stats) const
+    {
+        stats.hits += load(ZPCacheEvent::Hit);
+        stats.misses += load(ZPCacheEvent::Miss);
+        stats.puts += load(ZPCacheEvent::Put);
+        stats.evictions += load(ZPCacheEvent::Eviction);
+        stats.expirations += load(ZPCacheEvent::Expiration);
+        stats.recencyGhostHits += load(ZPCacheEvent::RecencyGhostHit);
+        stats.frequencyGhostHits += load(ZPCacheEvent::FrequencyGhostHit);
+        stats.promotions += load(ZPCacheEvent::Promotion);
+        stats.agingRuns += load(ZPCacheEvent::AgingRun);
+        if (getLatency_)
+            getLatency_->fill(stats.getLatency);
+        if (putLatency_)
+            putLatency_->fill(stats.putLatency);
+    }
+
+    // 每 sampleEvery 次 get/put 采样一次耗时，0 表示关闭。必须在缓存被并发访问之前调用
+    void enableLatencySampling(uint32_t sampleEvery)
+    {
+        sampleEvery_ = sampleEvery;
+        if (sampleEvery_ && !getLatency_)
+        {
+            getLatency_ = std::make_unique<AtomicHistogram>();
+            putLatency_ = std::make_unique<AtomicHistogram>();
+        }
+    }
+
+private:
+    struct AtomicHistogram
+    {
+        std::array<std::atomic<uint64_t>, ZPLatencyHistogram::kBucketCount> counts{};
+
+        void record(uint64_t ns)
+        {
+            counts[ZPLatencyHistogram::indexOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void fill(ZPLatencyHistogram& histogram) const
+        {
+            for (size_t i = 0; i < counts.size(); ++i)
+            {
+                uint64_t n = counts[i].load(std::memory_order_relaxed);
+                if (n)
+                    histogram.add(i, n);
+            }
+        }
+    };
+
+public:
+    // 作用域计时：未开启采样时只有一次分支；开启后每个线程每 sampleEvery 次同类操作读两次时钟
+    class LatencyScope
+    {
+    public:
+        LatencyScope(AtomicHistogram* histogram, uint32_t sampleEvery, uint32_t& countdown)
+        {
+            if (sampleEvery == 0)
+                return;
+            if (countdown-- != 0)
+                return;
+            countdown = sampleEvery - 1;
+            histogram_ = histogram;
+            start_ = std::chrono::steady_clock::now();
+        }
+
+        ~LatencyScope()
+        {
+            if (!histogram_)
+                return;
+            auto elapsed = std::chrono::steady_clock::now() - start_;
+            histogram_->record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+
+        LatencyScope(const LatencyScope&) = delete;
+        LatencyScope& operator=(const LatencyScope&) = delete;
+
+    private:
+        AtomicHistogram*                      histogram_ = nullptr;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    // get与put各用一个线程局部倒计数，交替的get/put不会总是落在同一种操作上
+    LatencyScope timeGet()
+    {
+        thread_local uint32_t countdown = 0;
+        return LatencyScope(getLatency_.get(), sampleEvery_, countdown);
+    }
+
+    LatencyScope timePut()
+    {
+        thread_local uint32_t countdown = 0;
+        return LatencyScope(putLatency_.get(), sampleEvery_, countdown);
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(ZPCacheEvent::Count)> counters_{};
+    uint32_t                         sampleEvery_ = 0;
+    std::unique_ptr<AtomicHistogram> getLatency_;
+    std::unique_ptr<AtomicHistogram> putLatency_;
+};
+
+} // namespace ZPCache
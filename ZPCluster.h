@@ -0,0 +1,528 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "ZPCachePolicy.h"
+#include "ZPCacheStats.h"
+#include "ZPFrequencySketch.h"
+#include "ZPHash.h"
+#include "ZPLockProfiling.h"
+#include "ZPLruCache.h"
+#include "ZPSnapshot.h"
+
+namespace ZPCache
+{
+
+// 一致性哈希环：每个节点按权重放置若干虚拟节点，key落在顺时针方向的第一个虚拟节点上。
+// 增删一个节点只移动它的虚拟节点所覆盖的区间，N个节点时约 1/N 的key换节点；虚拟节点越多负载越均匀。
+// 虚拟节点存放在按位置排序的平坦数组中，查找是一次二分。不加锁，由持有者同步
+class ZPClusterRing
+{
+public:
+    explicit ZPClusterRing(size_t virtualNodes = 160)
+        : virtualNodes_(std::max<size_t>(virtualNodes, 1))
+    {}
+
+    // 节点号由调用者分配，与传输层对节点的编号一致；已有的节点按新权重重新放置
+    void addNode(uint32_t node, uint32_t weight = 1)
+    {
+        removeNode(node);
+        size_t replicas = virtualNodes_ * std::max<uint32_t>(weight, 1);
+        for (size_t replica = 0; replica < replicas; ++replica)
+            points_.push_back({mixHash((static_cast<uint64_t>(node) << 32) ^ mixHash(replica)), node});
+        std::sort(points_.begin(), points_.end());
+        ++nodes_;
+    }
+
+    bool removeNode(uint32_t node)
+    {
+        auto removed = std::remove_if(points_.begin(), points_.end(), [node](const Point& p) { return p.node == node; });
+        if (removed == points_.end())
+            return false;
+        points_.erase(removed, points_.end());
+        --nodes_;
+        return true;
+    }
+
+    bool empty() const { return points_.empty(); }
+    size_t nodeCount() const { return nodes_; }
+
+    // hash 应当已经混合过（例如 hashKey 的结果）；环为空时不能调用
+    uint32_t nodeFor(size_t hash) const
+    {
+        auto it = std::lower_bound(points_.begin(), points_.end(), Point{static_cast<uint64_t>(hash), 0},
+                                   [](const Point& a, const Point& b) { return a.position < b.position; });
+        return it == points_.end() ? points_.front().node : it->node;
+    }
+
+private:
+    struct Point
+    {
+        uint64_t position;
+        uint32_t node;
+
+        bool operator<(const Point& other) const
+        {
+            return position != other.position ? position < other.position : node < other.node;
+        }
+    };
+
+    size_t             virtualNodes_; // 权重为1的节点放置的虚拟节点数
+    size_t             nodes_ = 0;
+    std::vector<Point> points_;
+};
+
+// 二进制协议：每一帧以固定的帧头开始，之后是 count 条记录，键值用 ZPSnapshotCodec 编码（要求集群内字节序相同）。
+//   Get   请求：count 个 key；        应答 Reply：count 条 (uint8 是否命中, 命中时的 value)，与请求的 key 一一对应
+//   Put   请求：count 个 (key, value)；应答 Ack：只有帧头，count 为写入条数
+//   Error 应答：请求无法解析
+// 应答带回请求的 requestId，同一连接上流水线发出的多个请求可以按它配对
+enum class ZPClusterOp : uint16_t
+{
+    Get = 1,
+    Put = 2,
+    Reply = 3,
+    Ack = 4,
+    Error = 5,
+};
+
+struct ZPClusterFrameHeader
+{
+    static constexpr uint32_t kMagic = 0x4c43505a; // "ZPCL"
+    static constexpr uint16_t kVersion = 1;
+
+    uint32_t magic = kMagic;
+    uint16_t version = kVersion;
+    uint16_t op = 0;
+    uint64_t requestId = 0;
+    uint32_t count = 0;
+    uint32_t reserved = 0;
+
+    bool valid(ZPClusterOp expected) const
+    {
+        return magic == kMagic && version == kVersion && op == static_cast<uint16_t>(expected);
+    }
+};
+
+// 把一帧请求发给节点，返回应答帧的 future。连接、重连与超时由实现负责；
+// 客户端先把一次批量操作涉及的所有节点的请求都发出，再依次等待应答，实现不应在调用中同步等待应答。
+// 发送失败时抛出异常或让 future 携带异常，这一帧涉及的key按未命中处理
+using ZPClusterTransport = std::function<std::future<std::vector<char>>(uint32_t node, std::vector<char> frame)>;
+
+struct ZPClusterOptions
+{
+    size_t                    virtualNodes = 160;  // 权重为1的节点的虚拟节点数
+    size_t                    nearCapacity = 1024; // 本地近端缓存的条目数（只存热点key），0 表示关闭
+    uint32_t                  hotThreshold = 8;    // sketch 估计的访问频次（最大15）达到此值视为热点
+    size_t                    sketchCapacity = 65536;
+    std::chrono::milliseconds nearTtl{1000};       // 副本最多陈旧这么久，之后必须回源
+};
+
+struct ZPClusterStats
+{
+    uint64_t nearHits = 0;       // 由本地近端缓存应答的key数
+    uint64_t requests = 0;       // 发出的请求帧数
+    uint64_t failedRequests = 0; // 发送失败、应答异常或无法解析的请求帧数
+    size_t   nodes = 0;
+};
+
+// 集群客户端：把 ZPShardedCache 按key哈希分片的做法推广到多个进程。
+// 批量接口先按一致性哈希环把key按节点分组，每个节点只发一帧，所有帧发出之后再等待应答。
+// 读取时用 ZPFrequencySketch 估计每个key的近期频次，热点key的值复制进本地的小容量近端缓存（带TTL的LRU），
+// 热点的读取不再集中打到同一个节点；本客户端写入的key同步更新或移出近端缓存，其他客户端的写入最多在 nearTtl 后可见。
+// 节点的增删与读写可以并发进行
+template<typename Key, typename Value>
+class ZPClusterClient : public ZPCachePolicy<Key, Value>
+{
+public:
+    explicit ZPClusterClient(ZPClusterTransport transport, const ZPClusterOptions& options = {})
+        : transport_(std::move(transport))
+        , options_(options)
+        , ring_(options.virtualNodes)
+        , sketch_(options.sketchCapacity)
+        , near_(static_cast<int>(options.nearCapacity))
+    {}
+
+    ~ZPClusterClient() override = default;
+
+    void addNode(uint32_t node, uint32_t weight = 1)
+    {
+        std::lock_guard<ZPSharedMutex> lock(ringMutex_);
+        ring_.addNode(node, weight);
+    }
+
+    bool removeNode(uint32_t node)
+    {
+        std::lock_guard<ZPSharedMutex> lock(ringMutex_);
+        return ring_.removeNode(node);
+    }
+
+    // 没有节点时返回 nullopt
+    std::optional<uint32_t> nodeFor(const Key& key) const
+    {
+        std::shared_lock<ZPSharedMutex> lock(ringMutex_);
+        if (ring_.empty())
+            return std::nullopt;
+        return ring_.nodeFor(hashKey(key));
+    }
+
+    void put(Key key, Value value) override
+    {
+        putMany(std::span<const Key>(&key, 1), std::span<const Value>(&value, 1));
+    }
+
+    bool get(Key key, Value& value) override
+    {
+        std::vector<bool> hits;
+        return getMany(std::span<const Key>(&key, 1), std::span<Value>(&value, 1), hits) == 1;
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    size_t getMany(std::span<const Key> keys, std::span<Value> values, std::vector<bool>& hits) override
+    {
+        hits.assign(keys.size(), false);
+        std::vector<size_t> hashes(keys.size());
+        std::vector<bool> hot(keys.size());
+        {
+            std::lock_guard<ZPMutex> lock(sketchMutex_);
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                hashes[i] = hashKey(keys[i]);
+                sketch_.increment(hashes[i]);
+                hot[i] = sketch_.frequency(hashes[i]) >= options_.hotThreshold;
+            }
+        }
+
+        size_t hitCount = 0;
+        std::vector<size_t> remote;
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            if (hot[i] && near_.get(keys[i], values[i]))
+            {
+                hits[i] = true;
+                ++hitCount;
+                nearHits_.fetch_add(1, std::memory_order_relaxed);
+            }
+            else
+            {
+                remote.push_back(i);
+            }
+        }
+
+        std::vector<Batch> batches = route(remote, hashes);
+        std::vector<std::future<std::vector<char>>> replies;
+        replies.reserve(batches.size());
+        for (Batch& batch : batches)
+        {
+            std::vector<char> frame;
+            ZPSnapshotWriter out(frame);
+            out.write(header(ZPClusterOp::Get, batch));
+            for (size_t i : batch.indices)
+                out.write(keys[i]);
+            replies.push_back(send(batch.node, std::move(frame)));
+        }
+
+        for (size_t b = 0; b < batches.size(); ++b)
+        {
+            std::vector<char> reply;
+            if (!receive(replies[b], reply))
+                continue;
+            ZPSnapshotReader in(reply.data(), reply.size());
+            if (!readReplyHeader(in, ZPClusterOp::Reply, batches[b]))
+                continue;
+            for (size_t i : batches[b].indices)
+            {
+                uint8_t found = 0;
+                if (!in.read(found) || (found && !in.read(values[i])))
+                {
+                    failedRequests_.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+                if (!found)
+                    continue;
+                hits[i] = true;
+                ++hitCount;
+                if (hot[i])
+                    near_.put(keys[i], values[i], options_.nearTtl);
+            }
+        }
+
+        for (size_t i = 0; i < keys.size(); ++i)
+            counters_.add(hits[i] ? ZPCacheEvent::Hit : ZPCacheEvent::Miss);
+        return hitCount;
+    }
+
+    // 等所有节点确认后返回；没有节点或发送失败的key被丢弃，计入 failedRequests
+    void putMany(std::span<const Key> keys, std::span<const Value> values) override
+    {
+        std::vector<size_t> hashes(keys.size());
+        std::vector<size_t> all(keys.size());
+        std::vector<bool> hot(keys.size());
+        {
+            std::lock_guard<ZPMutex> lock(sketchMutex_);
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                hashes[i] = hashKey(keys[i]);
+                all[i] = i;
+                hot[i] = sketch_.frequency(hashes[i]) >= options_.hotThreshold;
+            }
+        }
+        // 热点key的副本换成新值，其余的移出，避免本客户端读到自己写之前的值
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            counters_.add(ZPCacheEvent::Put);
+            if (hot[i])
+                near_.put(keys[i], values[i], options_.nearTtl);
+            else
+                near_.remove(keys[i]);
+        }
+
+        std::vector<Batch> batches = route(all, hashes);
+        std::vector<std::future<std::vector<char>>> replies;
+        replies.reserve(batches.size());
+        for (Batch& batch : batches)
+        {
+            std::vector<char> frame;
+            ZPSnapshotWriter out(frame);
+            out.write(header(ZPClusterOp::Put, batch));
+            for (size_t i : batch.indices)
+            {
+                out.write(keys[i]);
+                out.write(values[i]);
+            }
+            replies.push_back(send(batch.node, std::move(frame)));
+        }
+        for (size_t b = 0; b < batches.size(); ++b)
+        {
+            std::vector<char> reply;
+            if (!receive(replies[b], reply))
+                continue;
+            ZPSnapshotReader in(reply.data(), reply.size());
+            readReplyHeader(in, ZPClusterOp::Ack, batches[b]);
+        }
+    }
+
+    ZPCacheStats stats() const override
+    {
+        ZPCacheStats snapshot;
+        counters_.fill(snapshot);
+        return snapshot;
+    }
+
+    ZPClusterStats clusterStats() const
+    {
+        ZPClusterStats snapshot;
+        snapshot.nearHits = nearHits_.load(std::memory_order_relaxed);
+        snapshot.requests = requests_.load(std::memory_order_relaxed);
+        snapshot.failedRequests = failedRequests_.load(std::memory_order_relaxed);
+        std::shared_lock<ZPSharedMutex> lock(ringMutex_);
+        snapshot.nodes = ring_.nodeCount();
+        return snapshot;
+    }
+
+private:
+    // 发往同一节点的一帧：indices 是这些key在调用者数组中的下标
+    struct Batch
+    {
+        uint32_t            node;
+        uint64_t            requestId;
+        std::vector<size_t> indices;
+    };
+
+    // 按节点分组，没有节点时全部丢弃
+    std::vector<Batch> route(const std::vector<size_t>& indices, const std::vector<size_t>& hashes)
+    {
+        std::vector<Batch> batches;
+        if (indices.empty())
+            return batches;
+        std::shared_lock<ZPSharedMutex> lock(ringMutex_);
+        if (ring_.empty())
+        {
+            failedRequests_.fetch_add(1, std::memory_order_relaxed);
+            return batches;
+        }
+        for (size_t i : indices)
+        {
+            uint32_t node = ring_.nodeFor(hashes[i]);
+            auto it = std::find_if(batches.begin(), batches.end(), [node](const Batch& b) { return b.node == node; });
+            if (it == batches.end())
+            {
+                batches.push_back({node, nextRequestId_.fetch_add(1, std::memory_order_relaxed), {}});
+                it = batches.end() - 1;
+            }
+            it->indices.push_back(i);
+        }
+        return batches;
+    }
+
+    static ZPClusterFrameHeader header(ZPClusterOp op, const Batch& batch)
+    {
+        ZPClusterFrameHeader header;
+        header.op = static_cast<uint16_t>(op);
+        header.requestId = batch.requestId;
+        header.count = static_cast<uint32_t>(batch.indices.size());
+        return header;
+    }
+
+    std::future<std::vector<char>> send(uint32_t node, std::vector<char> frame)
+    {
+        requests_.fetch_add(1, std::memory_order_relaxed);
+        try
+        {
+            return transport_(node, std::move(frame));
+        }
+        catch (...)
+        {
+            return {};
+        }
+    }
+
+    bool receive(std::future<std::vector<char>>& reply, std::vector<char>& frame)
+    {
+        try
+        {
+            if (reply.valid())
+            {
+                frame = reply.get();
+                return true;
+            }
+        }
+        catch (...)
+        {
+        }
+        failedRequests_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    bool readReplyHeader(ZPSnapshotReader& in, ZPClusterOp op, const Batch& batch)
+    {
+        ZPClusterFrameHeader header;
+        bool ok = in.read(header) && header.valid(op) && header.requestId == batch.requestId &&
+                  header.count == batch.indices.size();
+        if (!ok)
+            failedRequests_.fetch_add(1, std::memory_order_relaxed);
+        return ok;
+    }
+
+private:
+    ZPClusterTransport         transport_;
+    ZPClusterOptions           options_;
+    mutable ZPSharedMutex      ringMutex_;   // 保护 ring_
+    ZPClusterRing              ring_;
+    ZPMutex                    sketchMutex_; // 保护 sketch_
+    ZPFrequencySketch          sketch_;
+    ZPLruCache<Key, Value>     near_;
+    std::atomic<uint64_t>      nextRequestId_{1};
+    std::atomic<uint64_t>      nearHits_{0};
+    std::atomic<uint64_t>      requests_{0};
+    std::atomic<uint64_t>      failedRequests_{0};
+    ZPCacheCounters            counters_;
+};
+
+// 节点一侧：把收到的一帧请求交给本地缓存（通常是 ZPShardedCache），返回应答帧。
+// Get 请求整帧调用一次缓存的 getMany，分片缓存按分片分组，每个分片只加一次锁。
+// 网络收发由使用者负责：按帧读入后调用 handle，把返回的帧写回同一连接。可以从多个线程同时调用
+template<typename Key, typename Value>
+class ZPClusterServer
+{
+public:
+    explicit ZPClusterServer(ZPCachePolicy<Key, Value>& cache)
+        : cache_(cache)
+    {}
+
+    std::vector<char> handle(std::span<const char> request)
+    {
+        ZPSnapshotReader in(request.data(), request.size());
+        ZPClusterFrameHeader header;
+        if (!in.read(header) || header.magic != ZPClusterFrameHeader::kMagic ||
+            header.version != ZPClusterFrameHeader::kVersion)
+            return errorFrame(header.requestId);
+        if (header.op == static_cast<uint16_t>(ZPClusterOp::Get))
+            return handleGet(in, header);
+        if (header.op == static_cast<uint16_t>(ZPClusterOp::Put))
+            return handlePut(in, header);
+        return errorFrame(header.requestId);
+    }
+
+private:
+    static std::vector<char> errorFrame(uint64_t requestId)
+    {
+        ZPClusterFrameHeader header;
+        header.op = static_cast<uint16_t>(ZPClusterOp::Error);
+        header.requestId = requestId;
+        std::vector<char> frame;
+        ZPSnapshotWriter out(frame);
+        out.write(header);
+        return frame;
+    }
+
+    std::vector<char> handleGet(ZPSnapshotReader& in, ZPClusterFrameHeader header)
+    {
+        std::vector<Key> keys(in.boundCount(header.count));
+        if (keys.size() != header.count)
+            return errorFrame(header.requestId);
+        for (Key& key : keys)
+        {
+            if (!in.read(key))
+                return errorFrame(header.requestId);
+        }
+        std::vector<Value> values(keys.size());
+        std::vector<bool> hits;
+        cache_.getMany(keys, values, hits);
+
+        header.op = static_cast<uint16_t>(ZPClusterOp::Reply);
+        std::vector<char> frame;
+        ZPSnapshotWriter out(frame);
+        out.write(header);
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            out.write(static_cast<uint8_t>(hits[i]));
+            if (hits[i])
+                out.write(values[i]);
+        }
+        return frame;
+    }
+
+    std::vector<char> handlePut(ZPSnapshotReader& in, ZPClusterFrameHeader header)
+    {
+        std::vector<Key> keys(in.boundCount(header.count));
+        std::vector<Value> values(keys.size());
+        if (keys.size() != header.count)
+            return errorFrame(header.requestId);
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            if (!in.read(keys[i]) || !in.read(values[i]))
+                return errorFrame(header.requestId);
+        }
+        cache_.putMany(keys, values);
+
+        header.op = static_cast<uint16_t>(ZPClusterOp::Ack);
+        std::vector<char> frame;
+        ZPSnapshotWriter out(frame);
+        out.write(header);
+        return frame;
+    }
+
+private:
+    ZPCachePolicy<Key, Value>& cache_;
+};
+
+} // namespace ZPCache
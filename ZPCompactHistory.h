@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ZPCache
+{
+
+// 只记录"某个key被访问过几次"的定长表，不保存key本身也不保存值，内存在构造时就固定下来。
+// 4路组相联：哈希低位选桶，高16位作为指纹（0表示空槽），每个槽4字节。
+// 桶满时替换计数最小的槽，同时把桶内其余槽的计数减半，长期不再出现的key会逐渐让出位置。
+// 指纹冲突时两个key共用一个计数，只会让某个key提前达到阈值，不会影响正确性。不加锁，由使用者负责同步
+class ZPCompactHistory
+{
+public:
+    static constexpr size_t kWays = 4;
+
+    // capacity 为希望同时追踪的key数，向上取整到 kWays 的2的幂倍
+    explicit ZPCompactHistory(size_t capacity)
+    {
+        size_t bucketCount = std::bit_ceil(std::max<size_t>((capacity + kWays - 1) / kWays, 1));
+        slots_.assign(bucketCount * kWays, Slot{});
+        bucketMask_ = bucketCount - 1;
+    }
+
+    // 记录一次访问并返回新的计数；hash 应当已经混合过（例如 hashKey 的结果）
+    uint32_t increment(size_t hash)
+    {
+        Slot* bucket = bucketOf(hash);
+        uint16_t fingerprint = fingerprintOf(hash);
+
+        Slot* victim = bucket;
+        for (size_t i = 0; i < kWays; ++i)
+        {
+            if (bucket[i].fingerprint == fingerprint)
+            {
+                if (bucket[i].count != UINT16_MAX)
+                    ++bucket[i].count;
+                return bucket[i].count;
+            }
+            if (bucket[i].count < victim->count)
+                victim = &bucket[i];
+        }
+
+        if (victim->fingerprint != 0)
+        {
+            for (size_t i = 0; i < kWays; ++i)
+                bucket[i].count >>= 1;
+        }
+        victim->fingerprint = fingerprint;
+        victim->count = 1;
+        return 1;
+    }
+
+    uint32_t count(size_t hash) const
+    {
+        const Slot* bucket = bucketOf(hash);
+        uint16_t fingerprint = fingerprintOf(hash);
+        for (size_t i = 0; i < kWays; ++i)
+        {
+            if (bucket[i].fingerprint == fingerprint)
+                return bucket[i].count;
+        }
+        return 0;
+    }
+
+    // key进入主缓存后清掉它的历史，腾出槽位
+    void erase(size_t hash)
+    {
+        Slot* bucket = bucketOf(hash);
+        uint16_t fingerprint = fingerprintOf(hash);
+        for (size_t i = 0; i < kWays; ++i)
+        {
+            if (bucket[i].fingerprint == fingerprint)
+            {
+                bucket[i] = Slot{};
+                return;
+            }
+        }
+    }
+
+    void clear() { std::fill(slots_.begin(), slots_.end(), Slot{}); }
+
+    size_t memoryUsage() const { return slots_.size() * sizeof(Slot); }
+
+private:
+    struct Slot
+    {
+        uint16_t fingerprint = 0;
+        uint16_t count = 0;
+    };
+
+    static uint16_t fingerprintOf(size_t hash)
+    {
+        uint16_t fingerprint = static_cast<uint16_t>(static_cast<uint64_t>(hash) >> 48);
+        return fingerprint ? fingerprint : 1;
+    }
+
+    Slot* bucketOf(size_t hash) { return &slots_[(hash & bucketMask_) * kWays]; }
+    const Slot* bucketOf(size_t hash) const { return &slots_[(hash & bucketMask_) * kWays]; }
+
+private:
+    std::vector<Slot> slots_;
+    size_t            bucketMask_ = 0;
+};
+
+} // namespace ZPCache
@@ -0,0 +1,497 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ZPCachePolicy.h"
+#include "ZPHash.h"
+#include "ZPLockProfiling.h"
+
+namespace ZPCache
+{
+
+// 采样淘汰时比较的依据
+enum class ZPSampledEviction
+{
+    Lru, // 最久未访问
+    Lfu, // 访问频次最低（对数计数并随时间衰减），频次相同时最久未访问
+};
+
+// 全并发缓存：没有全局锁、全局链表，也不分片。
+//   - 索引是按容量一次分好桶的链式哈希表，写操作只锁一个桶（自旋锁），读操作完全不加锁：
+//     结点发布后不再修改key和值，覆盖写入是换上一个新结点，读线程沿链表读到的结点总是完整的；
+//   - 摘下的结点按epoch回收：读线程进出时在自己线程所在的分片计数上加减（按epoch奇偶分两格），
+//     回收者推进epoch后等待旧奇偶的计数归零，再释放推进之前摘下的结点。读路径不加锁、不阻塞，
+//     但进入时若恰逢epoch推进要撤销计数重试，所以是无锁（lock-free）而不是无等待；
+//   - 淘汰不维护顺序，而是像Redis那样随机抽样：超出容量时从随机的桶里取 samples 个结点，淘汰其中最久未访问（或频次最低）的一个。
+//     命中只在结点的元数据字里记下当前时钟，时钟只在put时前进，元数据未变时不写结点。
+//     每次读仍要在分片的读者计数上加减一次、在分片的命中或未命中计数上加一次，分片按线程id哈希选取，不同线程可能落在同一分片。
+// 写线程之间仅在同一个桶上互斥；回收攒够一批才进行一次，开销均摊到每次写。
+// 近似淘汰的命中率略低于精确LRU/LFU，samples越大越接近。不支持TTL
+template<typename Key, typename Value>
+class ZPConcurrentCache : public ZPCachePolicy<Key, Value>
+{
+public:
+    explicit ZPConcurrentCache(size_t capacity, ZPSampledEviction eviction = ZPSampledEviction::Lru,
+                               size_t samples = kDefaultSamples)
+        : ZPConcurrentCache(std::allocator_arg, std::pmr::get_default_resource(), capacity, eviction, samples)
+    {}
+
+    // 结点与桶从resource分配；resource会被多个线程同时使用，必须是线程安全的（例如默认的全局堆或 synchronized_pool_resource）
+    ZPConcurrentCache(std::allocator_arg_t, std::pmr::memory_resource* resource, size_t capacity,
+                      ZPSampledEviction eviction = ZPSampledEviction::Lru, size_t samples = kDefaultSamples)
+        : capacity_(capacity)
+        , eviction_(eviction)
+        , samples_(std::max<size_t>(samples, 1))
+        , decayTicks_(std::max<size_t>(capacity, 1))
+        , reclaimBatch_(std::max(kMinReclaimBatch, capacity / 32))
+        , allocator_(resource)
+        , bucketMask_(std::bit_ceil(std::max(capacity, kMinBuckets)) - 1)
+        , buckets_(bucketMask_ + 1, resource)
+        , stripes_(std::make_unique<ReaderStripe[]>(kReaderStripes))
+    {
+        retired_.reserve(reclaimBatch_);
+    }
+
+    // 调用者保证析构时没有其他线程还在使用缓存
+    ~ZPConcurrentCache() override
+    {
+        for (Bucket& bucket : buckets_)
+        {
+            Node* node = bucket.head.load(std::memory_order_relaxed);
+            while (node)
+            {
+                Node* next = node->next.load(std::memory_order_relaxed);
+                destroyNode(node);
+                node = next;
+            }
+        }
+        for (Node* node : retired_)
+            destroyNode(node);
+    }
+
+    ZPConcurrentCache(const ZPConcurrentCache&) = delete;
+    ZPConcurrentCache& operator=(const ZPConcurrentCache&) = delete;
+
+    void put(Key key, Value value) override
+    {
+        if (capacity_ == 0)
+            return;
+
+        auto latency = counters_.timePut();
+        counters_.add(ZPCacheEvent::Put);
+        size_t hash = hashKey(key);
+        uint64_t now = clock_.fetch_add(1, std::memory_order_relaxed) + 1;
+        Node* node = createNode(key, std::move(value), hash, pack(now, kLfuInitCount));
+
+        Bucket& bucket = bucketFor(hash);
+        Node* replaced = nullptr;
+        {
+            BucketLock lock(bucket);
+            std::atomic<Node*>* link = &bucket.head;
+            for (Node* current = link->load(std::memory_order_relaxed); current;
+                 link = &current->next, current = link->load(std::memory_order_relaxed))
+            {
+                if (current->hash == hash && current->key == key)
+                {
+                    // 覆盖写入算一次访问，保留原有的频次
+                    uint64_t meta = current->meta.load(std::memory_order_relaxed);
+                    node->meta.store(pack(now, accessedCount(meta, now)), std::memory_order_relaxed);
+                    node->next.store(current->next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    link->store(node, std::memory_order_release);
+                    replaced = current;
+                    break;
+                }
+            }
+            if (!replaced)
+            {
+                node->next.store(bucket.head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                bucket.head.store(node, std::memory_order_release);
+            }
+        }
+
+        if (replaced)
+            retire(replaced);
+        else if (size_.fetch_add(1, std::memory_order_relaxed) + 1 > capacity_)
+            evictSampled();
+    }
+
+    bool get(Key key, Value& value) override
+    {
+        return lookup(key, hashKey(key), [&](const Value& cached) { value = cached; });
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    // visitor 在读保护区内拿到值的引用，期间结点不会被释放；visitor中不能再访问本缓存
+    bool visit(const Key& key, const std::function<void(const Value&)>& visitor) override
+    {
+        return lookup(key, hashKey(key), visitor);
+    }
+
+    bool getHashed(const ZPHashedKey<Key>& key, Value& value) override
+    {
+        return lookup(key.key, key.hash, [&](const Value& cached) { value = cached; });
+    }
+
+    bool visitHashed(const ZPHashedKey<Key>& key, const std::function<void(const Value&)>& visitor) override
+    {
+        return lookup(key.key, key.hash, visitor);
+    }
+
+    bool remove(const Key& key)
+    {
+        size_t hash = hashKey(key);
+        Bucket& bucket = bucketFor(hash);
+        Node* removed = nullptr;
+        {
+            BucketLock lock(bucket);
+            removed = unlink(bucket, [&](const Node* node) { return node->hash == hash && node->key == key; });
+        }
+        if (!removed)
+            return false;
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        retire(removed);
+        return true;
+    }
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+    ZPCacheStats stats() const override
+    {
+        ZPCacheStats snapshot;
+        counters_.fill(snapshot);
+        for (size_t i = 0; i < kReaderStripes; ++i)
+        {
+            snapshot.hits += stripes_[i].hits.load(std::memory_order_relaxed);
+            snapshot.misses += stripes_[i].misses.load(std::memory_order_relaxed);
+        }
+        return snapshot;
+    }
+
+    void enableLatencySampling(uint32_t sampleEvery) override { counters_.enableLatencySampling(sampleEvery); }
+
+    // 在淘汰者持有被淘汰结点所在桶的锁时调用
+    bool setEvictionListener(ZPEvictionListener<Key, Value> listener) override
+    {
+        evictionListener_ = std::move(listener);
+        return true;
+    }
+
+private:
+    static constexpr size_t kDefaultSamples = 5;
+    static constexpr size_t kMinBuckets = 16;
+    static constexpr size_t kMinReclaimBatch = 128;
+    static constexpr size_t kReaderStripes = 64;
+    static constexpr size_t kProbesPerSample = 8; // 每个样本最多探测的桶数，表很空时也能结束
+    static constexpr uint64_t kLfuInitCount = 5;  // 新结点的初始频次，避免刚写入就被淘汰
+    static constexpr uint64_t kLfuLogFactor = 10;
+    static constexpr uint64_t kCountBits = 8;
+    static constexpr uint64_t kCountMask = (uint64_t(1) << kCountBits) - 1;
+
+    struct Node
+    {
+        Node(const Key& k, Value v, size_t h, uint64_t m)
+            : key(k), value(std::move(v)), hash(h), meta(m)
+        {}
+
+        const Key            key;
+        const Value          value;
+        const size_t         hash;
+        std::atomic<uint64_t> meta;           // 高56位是最近访问的时钟，低8位是LFU频次
+        std::atomic<Node*>    next{nullptr};
+    };
+
+    struct Bucket
+    {
+        std::atomic<Node*> head{nullptr};
+        std::atomic<bool>  locked{false};
+    };
+
+    class BucketLock
+    {
+    public:
+        explicit BucketLock(Bucket& bucket) : bucket_(bucket)
+        {
+            while (bucket_.locked.exchange(true, std::memory_order_acquire))
+            {
+                while (bucket_.locked.load(std::memory_order_relaxed))
+                    std::this_thread::yield();
+            }
+        }
+        ~BucketLock() { bucket_.locked.store(false, std::memory_order_release); }
+
+        BucketLock(const BucketLock&) = delete;
+        BucketLock& operator=(const BucketLock&) = delete;
+
+    private:
+        Bucket& bucket_;
+    };
+
+    // 每个线程固定落在一个分片上，分片按缓存行对齐
+    struct alignas(64) ReaderStripe
+    {
+        std::atomic<uint64_t> active[2] = {}; // 按进入时epoch的奇偶计数的读线程
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+    };
+
+    // 读保护区：期间看到的结点都不会被释放
+    class ReadGuard
+    {
+    public:
+        ReadGuard(const std::atomic<uint64_t>& epoch, ReaderStripe& stripe) : stripe_(stripe)
+        {
+            for (;;)
+            {
+                uint64_t current = epoch.load();
+                parity_ = current & 1;
+                stripe_.active[parity_].fetch_add(1);
+                // 计数之前回收者可能已经推进了epoch并检查过这一格，重新读一次确认没有错过
+                if (epoch.load() == current)
+                    return;
+                stripe_.active[parity_].fetch_sub(1, std::memory_order_release);
+            }
+        }
+        ~ReadGuard() { stripe_.active[parity_].fetch_sub(1, std::memory_order_release); }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+    private:
+        ReaderStripe& stripe_;
+        uint64_t      parity_ = 0;
+    };
+
+    static uint64_t pack(uint64_t tick, uint64_t count) { return (tick << kCountBits) | count; }
+    static uint64_t tickOf(uint64_t meta) { return meta >> kCountBits; }
+    static uint64_t countOf(uint64_t meta) { return meta & kCountMask; }
+
+    static size_t threadStripe()
+    {
+        thread_local const size_t stripe =
+            mixHash(std::hash<std::thread::id>()(std::this_thread::get_id())) & (kReaderStripes - 1);
+        return stripe;
+    }
+
+    // 线程私有的 xorshift，用于抽样与频次的概率递增
+    static uint64_t nextRandom()
+    {
+        thread_local uint64_t state = mixHash(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    Bucket& bucketFor(size_t hash) { return buckets_[hash & bucketMask_]; }
+
+    // 从上次访问以来每过 decayTicks_ 次写入，频次减1
+    uint64_t decayedCount(uint64_t meta, uint64_t now) const
+    {
+        uint64_t periods = (now - std::min(now, tickOf(meta))) / decayTicks_;
+        uint64_t count = countOf(meta);
+        return periods >= count ? 0 : count - periods;
+    }
+
+    // Redis式对数计数：频次越高，再加1的概率越低，8位足以区分数量级
+    uint64_t accessedCount(uint64_t meta, uint64_t now) const
+    {
+        if (eviction_ != ZPSampledEviction::Lfu)
+            return countOf(meta);
+        uint64_t count = decayedCount(meta, now);
+        if (count == kCountMask)
+            return count;
+        uint64_t base = count > kLfuInitCount ? count - kLfuInitCount : 0;
+        if (nextRandom() % (base * kLfuLogFactor + 1) == 0)
+            ++count;
+        return count;
+    }
+
+    // 元数据没有变化时不写，热点key的缓存行保持共享状态
+    void touch(Node* node)
+    {
+        uint64_t now = clock_.load(std::memory_order_relaxed);
+        uint64_t meta = node->meta.load(std::memory_order_relaxed);
+        uint64_t updated = pack(now, accessedCount(meta, now));
+        if (updated != meta)
+            node->meta.store(updated, std::memory_order_relaxed);
+    }
+
+    template<typename Lookup, typename Fn>
+    bool lookup(const Lookup& key, size_t hash, Fn&& fn)
+    {
+        auto latency = counters_.timeGet();
+        ReaderStripe& stripe = stripes_[threadStripe()];
+        ReadGuard guard(epoch_, stripe);
+        for (Node* node = bucketFor(hash).head.load(std::memory_order_acquire); node;
+             node = node->next.load(std::memory_order_acquire))
+        {
+            if (node->hash == hash && node->key == key)
+            {
+                touch(node);
+                fn(node->value);
+                stripe.hits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        stripe.misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // 在持有桶锁时摘下第一个满足 match 的结点，读线程可能仍在访问它，由调用者交给 retire
+    template<typename Match>
+    static Node* unlink(Bucket& bucket, Match&& match)
+    {
+        std::atomic<Node*>* link = &bucket.head;
+        for (Node* node = link->load(std::memory_order_relaxed); node;
+             link = &node->next, node = link->load(std::memory_order_relaxed))
+        {
+            if (match(node))
+            {
+                link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    // 样本越旧（或频次越低）排名越小。LFU 模式下频次占最高8位，访问时间只在频次相同时比较
+    uint64_t rankOf(const Node* node, uint64_t now) const
+    {
+        uint64_t meta = node->meta.load(std::memory_order_relaxed);
+        if (eviction_ == ZPSampledEviction::Lfu)
+            return (decayedCount(meta, now) << (64 - kCountBits)) |
+                   std::min(tickOf(meta), (~uint64_t(0)) >> kCountBits);
+        return tickOf(meta);
+    }
+
+    // 超出容量时随机抽样淘汰，直到回到容量以内。并发写入者可能同时淘汰，结果会短暂低于容量几个条目
+    void evictSampled()
+    {
+        while (size_.load(std::memory_order_relaxed) > capacity_)
+        {
+            Node* evicted = nullptr;
+            bool sampled = false;
+            {
+                ReadGuard guard(epoch_, stripes_[threadStripe()]);
+                uint64_t now = clock_.load(std::memory_order_relaxed);
+                Node* victim = nullptr;
+                uint64_t victimRank = 0;
+                size_t found = 0;
+                for (size_t probe = 0; probe < samples_ * kProbesPerSample && found < samples_; ++probe)
+                {
+                    Bucket& bucket = buckets_[nextRandom() & bucketMask_];
+                    for (Node* node = bucket.head.load(std::memory_order_acquire); node && found < samples_;
+                         node = node->next.load(std::memory_order_acquire))
+                    {
+                        uint64_t rank = rankOf(node, now);
+                        if (!victim || rank < victimRank)
+                        {
+                            victim = node;
+                            victimRank = rank;
+                        }
+                        ++found;
+                    }
+                }
+                if (victim)
+                {
+                    sampled = true;
+                    Bucket& bucket = bucketFor(victim->hash);
+                    BucketLock lock(bucket);
+                    evicted = unlink(bucket, [victim](const Node* node) { return node == victim; });
+                    if (evicted && evictionListener_)
+                        evictionListener_(evicted->key, evicted->value);
+                }
+            }
+            if (!sampled)
+                return; // 表已被并发删空
+            if (evicted)
+            {
+                size_.fetch_sub(1, std::memory_order_relaxed);
+                counters_.add(ZPCacheEvent::Eviction);
+                retire(evicted);
+            }
+        }
+    }
+
+    // 攒够一批再回收，一次推进epoch的开销均摊到每个被摘下的结点
+    void retire(Node* node)
+    {
+        std::vector<Node*> batch;
+        {
+            std::lock_guard<ZPMutex> lock(retireMutex_);
+            retired_.push_back(node);
+            if (retired_.size() < reclaimBatch_)
+                return;
+            batch.swap(retired_);
+            retired_.reserve(reclaimBatch_);
+        }
+        synchronize();
+        for (Node* retired : batch)
+            destroyNode(retired);
+    }
+
+    // 推进epoch并等待在旧epoch中进入的读线程全部离开；之后再也没有读线程能看到推进之前摘下的结点
+    void synchronize()
+    {
+        std::lock_guard<ZPMutex> lock(reclaimMutex_);
+        uint64_t previous = epoch_.load(std::memory_order_relaxed);
+        epoch_.store(previous + 1);
+        size_t parity = previous & 1;
+        for (size_t i = 0; i < kReaderStripes; ++i)
+        {
+            while (stripes_[i].active[parity].load() != 0)
+                std::this_thread::yield();
+        }
+    }
+
+    Node* createNode(const Key& key, Value value, size_t hash, uint64_t meta)
+    {
+        Node* node = allocator_.allocate(1);
+        std::construct_at(node, key, std::move(value), hash, meta);
+        return node;
+    }
+
+    void destroyNode(Node* node)
+    {
+        std::destroy_at(node);
+        allocator_.deallocate(node, 1);
+    }
+
+private:
+    size_t                              capacity_;
+    ZPSampledEviction                   eviction_;
+    size_t                              samples_;      // 每次淘汰比较的样本数
+    uint64_t                            decayTicks_;   // LFU频次衰减1所需的写入次数
+    size_t                              reclaimBatch_; // 攒够这么多个摘下的结点回收一次
+    std::pmr::polymorphic_allocator<Node> allocator_;
+    size_t                              bucketMask_;
+    std::pmr::vector<Bucket>            buckets_;
+    std::unique_ptr<ReaderStripe[]>     stripes_;
+    alignas(64) std::atomic<uint64_t>   clock_{0};     // 每次put前进1，命中只读它
+    alignas(64) std::atomic<size_t>     size_{0};
+    alignas(64) std::atomic<uint64_t>   epoch_{0};
+    ZPMutex                             retireMutex_;  // 保护 retired_
+    ZPMutex                             reclaimMutex_; // 同一时刻只有一个回收者推进epoch
+    std::vector<Node*>                  retired_;
+    ZPEvictionListener<Key, Value>      evictionListener_;
+    ZPCacheCounters                     counters_;
+};
+
+} // namespace ZPCache
@@ -0,0 +1,487 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define ZPCACHE_FLAT_MAP_SSE2 1
+#endif
+
+#include "ZPHash.h"
+
+namespace ZPCache
+{
+
+// 开放寻址哈希表（Swiss-table风格），作为各缓存策略的 key -> Node 索引。
+// 每个槽位对应一个控制字节：最高位为1表示空/已删除，否则低7位保存哈希的指纹(h2)。
+// 以16个槽位为一组，用SSE2一次比较整组控制字节；结点内联存储在连续数组中，不再为每个条目单独分配。
+// 按缓存容量预留槽位后（负载因子不超过7/8），稳态的插入/删除不会触发扩容。
+template<typename Key, typename Mapped, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class ZPFlatHashMap
+{
+public:
+    using value_type = std::pair<Key, Mapped>;
+
+private:
+    static constexpr size_t kGroupWidth = 16;
+    static constexpr size_t kPrefetchDistance = 4;
+    static constexpr int8_t kEmpty = -128;  // 0b10000000
+    static constexpr int8_t kDeleted = -2;  // 0b11111110
+
+    struct alignas(kGroupWidth) CtrlGroup
+    {
+        int8_t ctrl[kGroupWidth];
+    };
+
+    // 一组控制字节的批量匹配，返回的位掩码第i位对应组内第i个槽位
+    class Group
+    {
+    public:
+        explicit Group(const CtrlGroup& group)
+#ifdef ZPCACHE_FLAT_MAP_SSE2
+            : ctrl_(_mm_load_si128(reinterpret_cast<const __m128i*>(group.ctrl)))
+#else
+            : ctrl_(group)
+#endif
+        {}
+
+        uint32_t match(int8_t h2) const
+        {
+#ifdef ZPCACHE_FLAT_MAP_SSE2
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_)));
+#else
+            uint32_t mask = 0;
+            for (size_t i = 0; i < kGroupWidth; ++i)
+                mask |= static_cast<uint32_t>(ctrl_.ctrl[i] == h2) << i;
+            return mask;
+#endif
+        }
+
+        uint32_t matchEmpty() const { return match(kEmpty); }
+
+        // 空和已删除的控制字节最高位均为1
+        uint32_t matchEmptyOrDeleted() const
+        {
+#ifdef ZPCACHE_FLAT_MAP_SSE2
+            return static_cast<uint32_t>(_mm_movemask_epi8(ctrl_));
+#else
+            uint32_t mask = 0;
+            for (size_t i = 0; i < kGroupWidth; ++i)
+                mask |= static_cast<uint32_t>(ctrl_.ctrl[i] < 0) << i;
+            return mask;
+#endif
+        }
+
+    private:
+#ifdef ZPCACHE_FLAT_MAP_SSE2
+        __m128i ctrl_;
+#else
+        CtrlGroup ctrl_;
+#endif
+    };
+
+    static int lowestBit(uint32_t mask)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctz(mask);
+#else
+        int i = 0;
+        while (!(mask & 1u)) { mask >>= 1; ++i; }
+        return i;
+#endif
+    }
+
+    template<bool IsConst>
+    class IteratorImpl
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename ZPFlatHashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
+        using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+        using MapPtr = std::conditional_t<IsConst, const ZPFlatHashMap*, ZPFlatHashMap*>;
+
+        IteratorImpl() = default;
+        IteratorImpl(MapPtr map, size_t index) : map_(map), index_(index) {}
+
+        // 允许 iterator -> const_iterator 的隐式转换
+        template<bool OtherConst, typename = std::enable_if_t<IsConst && !OtherConst>>
+        IteratorImpl(const IteratorImpl<OtherConst>& other) : map_(other.map_), index_(other.index_) {}
+
+        reference operator*() const { return map_->slots_[index_]; }
+        pointer operator->() const { return &map_->slots_[index_]; }
+
+        IteratorImpl& operator++()
+        {
+            index_ = map_->nextFull(index_ + 1);
+            return *this;
+        }
+
+        IteratorImpl operator++(int)
+        {
+            IteratorImpl old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const IteratorImpl& other) const { return index_ == other.index_; }
+        bool operator!=(const IteratorImpl& other) const { return index_ != other.index_; }
+
+    private:
+        MapPtr map_ = nullptr;
+        size_t index_ = 0;
+
+        template<bool> friend class IteratorImpl;
+        friend class ZPFlatHashMap;
+    };
+
+public:
+    using iterator = IteratorImpl<false>;
+    using const_iterator = IteratorImpl<true>;
+
+    // 控制字节与槽位数组从 resource 分配，默认是全局堆
+    explicit ZPFlatHashMap(size_t expectedSize = 0,
+                           std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : resource_(resource)
+    {
+        reserve(expectedSize);
+    }
+
+    ZPFlatHashMap(const ZPFlatHashMap&) = delete;
+    ZPFlatHashMap& operator=(const ZPFlatHashMap&) = delete;
+
+    ~ZPFlatHashMap()
+    {
+        destroySlots();
+        deallocate(ctrl_, slots_, slotCount_);
+    }
+
+    iterator begin() { return iterator(this, nextFull(0)); }
+    iterator end() { return iterator(this, slotCount_); }
+    const_iterator begin() const { return const_iterator(this, nextFull(0)); }
+    const_iterator end() const { return const_iterator(this, slotCount_); }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // 槽位总数（含空槽位），可用于按槽位下标分批遍历
+    size_t slotCount() const { return slotCount_; }
+
+    // 索引本身占用的字节数（控制字节 + 槽位数组）
+    size_t memoryUsage() const
+    {
+        return sizeof(*this) + slotCount_ * (sizeof(int8_t) + sizeof(value_type));
+    }
+
+    // 依次访问槽位下标位于[first, last)中的条目，用于按批次增量遍历整张表
+    template<typename Fn>
+    void forEachInSlots(size_t first, size_t last, Fn&& fn)
+    {
+        last = last < slotCount_ ? last : slotCount_;
+        for (size_t i = nextFull(first); i < last; i = nextFull(i + 1))
+            fn(slots_[i]);
+    }
+
+    // 保证至少能容纳count个条目而不扩容
+    void reserve(size_t count)
+    {
+        size_t needed = kGroupWidth;
+        while (maxLoad(needed) < count)
+            needed *= 2;
+        if (needed > slotCount_)
+            rehash(needed);
+    }
+
+    iterator find(const Key& key)
+    {
+        return iterator(this, findIndex(key));
+    }
+
+    const_iterator find(const Key& key) const
+    {
+        return const_iterator(this, findIndex(key));
+    }
+
+    // 使用预先算好的哈希（hashOf的结果）查找，避免重复计算。
+    // key 也可以是能与 Key 直接比较的查询类型（例如 std::string 键用 string_view 查询），hash 须与 hashOf 一致
+    template<typename K>
+    iterator find(const K& key, size_t hash)
+    {
+        return iterator(this, findIndex(key, hash));
+    }
+
+    template<typename K>
+    const_iterator find(const K& key, size_t hash) const
+    {
+        return const_iterator(this, findIndex(key, hash));
+    }
+
+    size_t hashOf(const Key& key) const { return hashKey(key, hash_); }
+
+    // 预取哈希对应的第一个探测组（控制字节与槽位）
+    void prefetchHash(size_t hash) const
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        size_t group = h1(hash) & (groupCount() - 1);
+        __builtin_prefetch(&ctrl_[group]);
+        __builtin_prefetch(&slots_[group * kGroupWidth]);
+#else
+        (void)hash;
+#endif
+    }
+
+    void prefetch(const Key& key) const { prefetchHash(hashOf(key)); }
+
+    // 批量查找：提前kPrefetchDistance个key计算哈希并预取探测组，让后续key的访存与当前key的比较重叠。
+    // fn(i, it)中可以修改本表，之后的查找在调用时才进行，不受影响
+    template<typename Fn>
+    void findBatch(std::span<const Key> keys, Fn&& fn)
+    {
+        size_t hashes[kPrefetchDistance];
+        const size_t n = keys.size();
+        for (size_t i = 0; i < n && i < kPrefetchDistance; ++i)
+        {
+            hashes[i] = hashOf(keys[i]);
+            prefetchHash(hashes[i]);
+        }
+        for (size_t i = 0; i < n; ++i)
+        {
+            size_t hash = hashes[i % kPrefetchDistance];
+            if (i + kPrefetchDistance < n)
+            {
+                hashes[i % kPrefetchDistance] = hashOf(keys[i + kPrefetchDistance]);
+                prefetchHash(hashes[i % kPrefetchDistance]);
+            }
+            fn(i, iterator(this, findIndex(keys[i], hash)));
+        }
+    }
+
+    bool contains(const Key& key) const { return findIndex(key) != slotCount_; }
+    size_t count(const Key& key) const { return contains(key) ? 1 : 0; }
+
+    // 不存在时用args构造Mapped并插入，存在时不做修改
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args)
+    {
+        size_t hash = hashKey(key, hash_);
+        size_t index = findIndex(key, hash);
+        if (index != slotCount_)
+            return { iterator(this, index), false };
+
+        index = prepareInsert(hash);
+        std::construct_at(&slots_[index], std::piecewise_construct,
+                          std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+        return { iterator(this, index), true };
+    }
+
+    template<typename M>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, M&& mapped)
+    {
+        auto result = try_emplace(key, std::forward<M>(mapped));
+        if (!result.second)
+            result.first->second = std::forward<M>(mapped);
+        return result;
+    }
+
+    Mapped& operator[](const Key& key)
+    {
+        return try_emplace(key).first->second;
+    }
+
+    void erase(iterator it)
+    {
+        eraseIndex(it.index_);
+    }
+
+    size_t erase(const Key& key)
+    {
+        size_t index = findIndex(key);
+        if (index == slotCount_)
+            return 0;
+        eraseIndex(index);
+        return 1;
+    }
+
+    // 清空条目，保留已分配的槽位
+    void clear()
+    {
+        destroySlots();
+        for (size_t g = 0; g < groupCount(); ++g)
+            std::memset(ctrl_[g].ctrl, static_cast<unsigned char>(kEmpty), kGroupWidth);
+        size_ = 0;
+        deleted_ = 0;
+        growthLeft_ = maxLoad(slotCount_);
+    }
+
+private:
+    static size_t maxLoad(size_t slotCount) { return slotCount - slotCount / 8; }
+
+    size_t groupCount() const { return groupCountFor(slotCount_); }
+    static size_t groupCountFor(size_t slotCount) { return slotCount / kGroupWidth; }
+    int8_t ctrlAt(size_t index) const { return ctrl_[index / kGroupWidth].ctrl[index % kGroupWidth]; }
+    void setCtrl(size_t index, int8_t value) { ctrl_[index / kGroupWidth].ctrl[index % kGroupWidth] = value; }
+
+    static int8_t h2(size_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+    static size_t h1(size_t hash) { return hash >> 7; }
+
+    size_t nextFull(size_t index) const
+    {
+        while (index < slotCount_ && ctrlAt(index) < 0)
+            ++index;
+        return index;
+    }
+
+    size_t findIndex(const Key& key) const
+    {
+        return findIndex(key, hashKey(key, hash_));
+    }
+
+    // 以组为单位做三角探测；遇到含空槽位的组即可确定key不存在
+    template<typename K>
+    size_t findIndex(const K& key, size_t hash) const
+    {
+        if (slotCount_ == 0)
+            return slotCount_;
+
+        const size_t groupMask = groupCount() - 1;
+        size_t group = h1(hash) & groupMask;
+        for (size_t step = 1; ; ++step)
+        {
+            Group g(ctrl_[group]);
+            for (uint32_t mask = g.match(h2(hash)); mask != 0; mask &= mask - 1)
+            {
+                size_t index = group * kGroupWidth + lowestBit(mask);
+                if (keyEquals(slots_[index].first, key))
+                    return index;
+            }
+            if (g.matchEmpty() != 0)
+                return slotCount_;
+            group = (group + step) & groupMask;
+        }
+    }
+
+    template<typename K>
+    bool keyEquals(const Key& stored, const K& key) const
+    {
+        if constexpr (std::is_same_v<K, Key>)
+            return equal_(stored, key);
+        else
+            return stored == key;
+    }
+
+    // 沿探测序列找到第一个空/已删除槽位
+    size_t findInsertSlot(size_t hash) const
+    {
+        const size_t groupMask = groupCount() - 1;
+        size_t group = h1(hash) & groupMask;
+        for (size_t step = 1; ; ++step)
+        {
+            uint32_t mask = Group(ctrl_[group]).matchEmptyOrDeleted();
+            if (mask != 0)
+                return group * kGroupWidth + lowestBit(mask);
+            group = (group + step) & groupMask;
+        }
+    }
+
+    // 为一个确定不存在的key找到插入位置并写好控制字节
+    size_t prepareInsert(size_t hash)
+    {
+        size_t index = findInsertSlot(hash);
+        if (ctrlAt(index) == kEmpty && growthLeft_ == 0)
+        {
+            // 墓碑过多时原地重建，否则扩容一倍
+            rehash(deleted_ >= size_ / 2 ? slotCount_ : slotCount_ * 2);
+            index = findInsertSlot(hash);
+        }
+
+        if (ctrlAt(index) == kEmpty)
+            --growthLeft_;
+        else
+            --deleted_;
+        setCtrl(index, h2(hash));
+        ++size_;
+        return index;
+    }
+
+    void eraseIndex(size_t index)
+    {
+        std::destroy_at(&slots_[index]);
+        --size_;
+
+        // 若所在组中仍有空槽位，则没有任何探测序列会越过该组，可以直接置空而不必留下墓碑
+        if (Group(ctrl_[index / kGroupWidth]).matchEmpty() != 0)
+        {
+            setCtrl(index, kEmpty);
+            ++growthLeft_;
+        }
+        else
+        {
+            setCtrl(index, kDeleted);
+            ++deleted_;
+        }
+    }
+
+    void rehash(size_t newSlotCount)
+    {
+        CtrlGroup* oldCtrl = ctrl_;
+        value_type* oldSlots = slots_;
+        size_t oldSlotCount = slotCount_;
+
+        slotCount_ = newSlotCount;
+        ctrl_ = static_cast<CtrlGroup*>(resource_->allocate(groupCount() * sizeof(CtrlGroup), alignof(CtrlGroup)));
+        slots_ = static_cast<value_type*>(resource_->allocate(slotCount_ * sizeof(value_type), alignof(value_type)));
+        for (size_t g = 0; g < groupCount(); ++g)
+            std::memset(ctrl_[g].ctrl, static_cast<unsigned char>(kEmpty), kGroupWidth);
+        deleted_ = 0;
+        growthLeft_ = maxLoad(slotCount_) - size_;
+
+        for (size_t i = 0; i < oldSlotCount; ++i)
+        {
+            if (oldCtrl[i / kGroupWidth].ctrl[i % kGroupWidth] < 0)
+                continue;
+            size_t hash = hashKey(oldSlots[i].first, hash_);
+            size_t index = findInsertSlot(hash);
+            setCtrl(index, h2(hash));
+            std::construct_at(&slots_[index], std::move(oldSlots[i]));
+            std::destroy_at(&oldSlots[i]);
+        }
+        deallocate(oldCtrl, oldSlots, oldSlotCount);
+    }
+
+    void destroySlots()
+    {
+        for (size_t i = nextFull(0); i < slotCount_; i = nextFull(i + 1))
+            std::destroy_at(&slots_[i]);
+    }
+
+    void deallocate(CtrlGroup* ctrl, value_type* slots, size_t slotCount)
+    {
+        if (!ctrl)
+            return;
+        resource_->deallocate(ctrl, groupCountFor(slotCount) * sizeof(CtrlGroup), alignof(CtrlGroup));
+        resource_->deallocate(slots, slotCount * sizeof(value_type), alignof(value_type));
+    }
+
+private:
+    std::pmr::memory_resource* resource_;
+    CtrlGroup*  ctrl_ = nullptr;  // 控制字节，按组对齐
+    value_type* slots_ = nullptr; // 槽位数组，只有控制字节为FULL的槽位已构造
+    size_t      slotCount_ = 0;
+    size_t      size_ = 0;
+    size_t      deleted_ = 0;     // 墓碑数量
+    size_t      growthLeft_ = 0;  // 还能写入多少个空槽位而不超过最大负载
+    [[no_unique_address]] Hash     hash_;
+    [[no_unique_address]] KeyEqual equal_;
+};
+
+} // namespace ZPCache
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ZPCache
+{
+
+// 4 位 Count-Min Sketch，用于估计key近期的访问频次（TinyLFU 的准入过滤器）。
+// 每个64位字存放16个4位计数器；一个key在4个不同的字中各占一个计数器，估计值取4个中的最小值，最大为15。
+// 累计增加次数达到 sampleSize（10倍容量）时所有计数器减半，旧的热度逐渐衰减，新热点可以追上来。
+// 每个被追踪的key大约只占8字节，且不保存key本身。不加锁，由持有它的缓存负责同步
+class ZPFrequencySketch
+{
+public:
+    static constexpr uint32_t kMaxFrequency = 15;
+
+    explicit ZPFrequencySketch(size_t capacity)
+    {
+        ensureCapacity(capacity);
+    }
+
+    // 按预计追踪的key数重建（清空所有计数）
+    void ensureCapacity(size_t capacity)
+    {
+        size_t tableSize = std::bit_ceil(std::max<size_t>(capacity, 1));
+        table_.assign(tableSize, 0);
+        tableMask_ = tableSize - 1;
+        sampleSize_ = std::max<size_t>(capacity, 1) * 10;
+        additions_ = 0;
+    }
+
+    // hash 应当已经混合过（例如 hashKey 的结果）
+    uint32_t frequency(size_t hash) const
+    {
+        uint32_t start = static_cast<uint32_t>(hash & 3) << 2;
+        uint32_t frequency = kMaxFrequency;
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            size_t index = indexOf(hash, i);
+            uint32_t count = static_cast<uint32_t>(table_[index] >> ((start + i) << 2)) & 0xF;
+            frequency = std::min(frequency, count);
+        }
+        return frequency;
+    }
+
+    // 记录一次访问；4个计数器都已饱和时不计入 sampleSize
+    void increment(size_t hash)
+    {
+        uint32_t start = static_cast<uint32_t>(hash & 3) << 2;
+        bool added = false;
+        for (uint32_t i = 0; i < 4; ++i)
+            added |= incrementAt(indexOf(hash, i), start + i);
+
+        if (added && ++additions_ >= sampleSize_)
+            reset();
+    }
+
+    void clear()
+    {
+        std::fill(table_.begin(), table_.end(), 0);
+        additions_ = 0;
+    }
+
+    size_t memoryUsage() const { return table_.size() * sizeof(uint64_t); }
+
+private:
+    static constexpr uint64_t kSeeds[4] = {
+        0xc3a5c85c97cb3127ull, 0xb492b66fbe98f273ull, 0x9ae16a3b2f90404full, 0xcbf29ce484222325ull};
+    static constexpr uint64_t kResetMask = 0x7777777777777777ull; // 每个4位计数器右移一位后清掉借入的最高位
+    static constexpr uint64_t kOneMask = 0x1111111111111111ull;
+
+    // 第 i 个哈希函数选中的字下标
+    size_t indexOf(size_t hash, uint32_t i) const
+    {
+        uint64_t h = (static_cast<uint64_t>(hash) + kSeeds[i]) * kSeeds[i];
+        h += h >> 32;
+        return static_cast<size_t>(h) & tableMask_;
+    }
+
+    // 第 index 个字中的第 counter 个计数器（0-15）加一，已饱和返回false
+    bool incrementAt(size_t index, uint32_t counter)
+    {
+        uint32_t offset = counter << 2;
+        uint64_t mask = uint64_t(0xF) << offset;
+        if ((table_[index] & mask) == mask)
+            return false;
+        table_[index] += uint64_t(1) << offset;
+        return true;
+    }
+
+    // 所有计数器减半；奇数计数器减半时的截断误差按 1/4 折算后从 additions_ 中扣除
+    void reset()
+    {
+        size_t oddCounters = 0;
+        for (uint64_t& word : table_)
+        {
+            oddCounters += static_cast<size_t>(std::popcount(word & kOneMask));
+            word = (word >> 1) & kResetMask;
+        }
+        additions_ = (additions_ - (oddCounters >> 2)) >> 1;
+    }
+
+private:
+    std::vector<uint64_t> table_;
+    size_t                tableMask_ = 0;
+    size_t                sampleSize_ = 0;
+    size_t                additions_ = 0;
+};
+
+} // namespace ZPCache
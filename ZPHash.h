@@ -0,0 +1,89 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace ZPCache
+{
+
+// 对std::hash的结果再做一次位混合（murmur3 fmix64）。
+// std::hash<int>等整数哈希是恒等映射，直接取低位或高位会让连续key聚集到相邻的桶/分片
+inline size_t mixHash(size_t hash)
+{
+    uint64_t h = static_cast<uint64_t>(hash);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+}
+
+// 先调用Hash再混合，缓存内所有索引统一使用这一哈希
+template<typename Key, typename Hash = std::hash<Key>>
+inline size_t hashKey(const Key& key, const Hash& hash = Hash())
+{
+    return mixHash(hash(key));
+}
+
+// 查询时用来代表key的轻量类型：std::string 键用 string_view，不必为一次查找构造临时字符串；其他类型直接引用原key
+template<typename Key>
+struct ZPKeyView
+{
+    using type = const Key&;
+};
+
+template<>
+struct ZPKeyView<std::string>
+{
+    using type = std::string_view;
+};
+
+template<typename Key>
+using ZPKeyViewT = typename ZPKeyView<Key>::type;
+
+// 与 hashKey<Key> 结果相同的查询哈希。std::hash<std::string_view> 与 std::hash<std::string> 对相同内容的结果一致，
+// 所以 string_view 算出的哈希可以直接用于 std::string 键的索引
+template<typename Key>
+inline size_t hashLookup(ZPKeyViewT<Key> key)
+{
+    using View = std::remove_cvref_t<ZPKeyViewT<Key>>;
+    return mixHash(std::hash<View>()(key));
+}
+
+// 可以用来构造 ZPHashedKey 的查询类型。非字符串key的视图是 const Key&，只接受 Key 本身：
+// 换成可转换的其他类型（例如 int 键传 long）时引用会绑定到构造函数返回即销毁的临时对象
+template<typename Lookup, typename Key>
+concept ZPKeyLookup = std::same_as<std::remove_cvref_t<Lookup>, Key> ||
+                      (!std::is_reference_v<ZPKeyViewT<Key>> && std::is_convertible_v<const Lookup&, ZPKeyViewT<Key>>);
+
+// 携带预先算好哈希的查询key：分片路由、主索引与ARC幽灵表共用这一次哈希计算。
+// 只保存key的视图，不拥有key，只能作为一次调用的临时参数
+template<typename Key>
+struct ZPHashedKey
+{
+    ZPKeyViewT<Key> key;
+    size_t          hash;
+
+    template<ZPKeyLookup<Key> Lookup>
+    ZPHashedKey(const Lookup& lookup)
+        : key(lookup)
+        , hash(hashLookup<Key>(key))
+    {}
+
+    template<ZPKeyLookup<Key> Lookup>
+    ZPHashedKey(const Lookup& lookup, size_t precomputedHash)
+        : key(lookup)
+        , hash(precomputedHash)
+    {}
+
+    // 需要真正的Key时（插入、或不支持异构查找的策略）才构造
+    Key materialize() const { return Key(key); }
+};
+
+} // namespace ZPCache
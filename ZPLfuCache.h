@@ -1,10 +1,23 @@
 #pragma once
 
 #include "ZPCachePolicy.h"
+#include "ZPFlatHashMap.h"
+#include "ZPLockProfiling.h"
+#include "ZPNodePool.h"
+#include "ZPSnapshot.h"
+#include "ZPTimingWheel.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
 #include <cstdint>
 #include <memory>
 #include <mutex>
-#include <unordered_map>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 namespace ZPCache {
 // Rfu cache
 
@@ -14,33 +27,32 @@ template<typename Key, typename Value>
 class FreqList
 {
 private:
-    struct Node
-    {
-        int freq;   // 访问频次
-        Key key; 
-        Value value;   
-        std::weak_ptr<Node> pre; // 上一节点改为weak_ptr 打破循环引用
-        std::shared_ptr<Node> next;
-        
-        Node()
-        : freq(1), next(nullptr){}
-        Node(Key key, Value value)
-        : freq(1), key(key), value(value), next(nullptr) {}
+    struct Node : ZPTimerLink // 带TTL的结点挂在缓存的定时轮上
+    {
+        int freq = 1;      // 访问频次
+        size_t weight = 1; // 条目权重，按条目数计容量时恒为1
+        Key key{};
+        Value value{};
+        Node* pre = nullptr; // 结点由缓存的ZPNodePool持有，链表只用裸指针串联
+        Node* next = nullptr;
     };
 
-    using NodePtr = std::shared_ptr<Node>;
-    int freq_; // 访问频率
-    NodePtr head_;  // 假头节点
-    NodePtr tail_;  // 假尾节点
+    using NodePtr = Node*;
+    int freq_ = 0; // 访问频率
+    NodePtr head_ = nullptr;  // 假头节点
+    NodePtr tail_ = nullptr;  // 假尾节点
 
 public:
-    explicit FreqList(int n) //explicit 意为明确的，
-    : freq_(n)
+    // 链表本身也取自结点池，首尾虚拟结点从缓存的结点池中取
+    void init(int n, ZPNodePool<Node>& pool)
     {
-        head_ = std::make_shared<Node>();
-        tail_ = std::make_shared<Node>();
+        freq_ = n;
+        head_ = pool.acquire();
+        tail_ = pool.acquire();
+        head_->pre = nullptr;
         head_->next = tail_;
         tail_->pre = head_;
+        tail_->next = nullptr;
     }
 
     bool isEmpty() const{
@@ -53,22 +65,32 @@ public:
     
         node->pre = tail_->pre;
         node->next = tail_;
-        tail_->pre.lock()->next = node; // 使用lock()获取shaderd_ptr，因为weak_ptr 不能直接访问对象需要用lock升级为shared_ptr
-                                        // 如果对象存在返回有效的shared_ptr ，如果不存在 返回空的shared_ptr
+        tail_->pre->next = node;
         tail_->pre = node;
     }
 
+    // 插到最旧的位置，加载快照时按从新到旧的顺序依次插入
+    void addFirstNode(NodePtr node){
+        if(!node || !head_ || !tail_)
+            return;
+
+        node->pre = head_;
+        node->next = head_->next;
+        head_->next->pre = node;
+        head_->next = node;
+    }
+
     void removeNode(NodePtr node){
         if(!node || !head_ || !tail_)
             return;
-        if(node->pre.expired() || !node->next){
+        if(!node->pre || !node->next){
             return;
         }
 
-        auto pre = node->pre.lock(); // 使用lock()获取shaderd_ptr
-        pre->next = node->next;
-        node->next->pre = pre;
-        node->next = nullptr;       // 确保显示置空next 指针，彻底断开节点与链表的连接
+        node->pre->next = node->next;
+        node->next->pre = node->pre;
+        node->pre = nullptr;
+        node->next = nullptr;       // 确保显示置空指针，彻底断开节点与链表的连接
     }
 
     NodePtr getFirstNode() const {return head_->next;}
@@ -82,44 +104,68 @@ class ZPLfuCache : public ZPCachePolicy<Key, Value>
 {
 public:
     using Node = typename FreqList<Key, Value>::Node;
-    using NodePtr = std::shared_ptr<Node>;
-    using NodeMap = std::unordered_map<Key, NodePtr>;
+    using NodePtr = Node*;
+    using NodeMap = ZPFlatHashMap<Key, NodePtr>;
+    using ListType = FreqList<Key, Value>;
 
     ZPLfuCache(int capacity, int maxAverageNum =10)
-    : capacity_(capacity), minFreq_(INT8_MAX), maxAverageNum_(maxAverageNum),
-    curAverageNum_(0), curTotalNum_(0)
+    : ZPLfuCache(std::allocator_arg, std::pmr::get_default_resource(), capacity, maxAverageNum)
+    {}
+
+    // 结点、频次链表与索引都从resource分配；结点池按capacity预分配（外加若干频次链表的虚拟结点），淘汰的结点回池复用
+    ZPLfuCache(std::allocator_arg_t, std::pmr::memory_resource* resource, int capacity, int maxAverageNum = 10)
+    : ZPLfuCache(capacity > 0 ? static_cast<size_t>(capacity) : 0, nullptr, maxAverageNum, resource,
+                 capacity > 0 ? static_cast<size_t>(capacity) : 0)
+    {}
+
+    // 按权重计容量：所有条目的权重之和（例如字节数）不超过maxWeight，超出时按访问频次从低到高淘汰到预算以内
+    ZPLfuCache(size_t maxWeight, ZPWeigher<Key, Value> weigher, int maxAverageNum = 10)
+    : ZPLfuCache(std::allocator_arg, std::pmr::get_default_resource(), maxWeight, std::move(weigher), maxAverageNum)
+    {}
+
+    ZPLfuCache(std::allocator_arg_t, std::pmr::memory_resource* resource, size_t maxWeight,
+               ZPWeigher<Key, Value> weigher, int maxAverageNum = 10)
+    : ZPLfuCache(maxWeight, std::move(weigher), maxAverageNum, resource, kWeightedReserve)
     {}
 
     ~ZPLfuCache() override = default;
 
     void put(Key key, Value value) override{
-        if(capacity_ == 0)
+        if(maxWeight_ == 0)
             return;
 
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = nodeMap_.find(key);
-        if(it != nodeMap_.end())
+        auto latency = counters_.timePut();
+        std::lock_guard<ZPMutex> lock(mutex_);
+        expireEntries();
+        counters_.add(ZPCacheEvent::Put);
+        putEntry(key, std::move(value), 0);
+    }
+
+    // 带TTL的添加：ttl之后条目过期，不再命中，并在之后的读写中由定时轮回收（计入淘汰统计）。
+    // 同一个key之后不带TTL的put会取消过期时间；ttl<=0 等同于删除
+    void put(Key key, Value value, std::chrono::nanoseconds ttl) override
+    {
+        if(maxWeight_ == 0)
+            return;
+
+        auto latency = counters_.timePut();
+        std::lock_guard<ZPMutex> lock(mutex_);
+        uint64_t now = ZPTimingWheel::now();
+        expireEntries(now);
+        counters_.add(ZPCacheEvent::Put);
+        if(ttl.count() <= 0)
         {
-            // reset value
-            it->second->value = value;
-            // 找到了直接调整就好了，不用再去get中找一遍
-            getInternal(it->second, value);
+            auto it = nodeMap_.find(key);
+            if(it != nodeMap_.end())
+                eraseNode(it->second);
             return;
         }
-
-        putInternal(key, value);
+        putEntry(key, std::move(value), ZPTimingWheel::deadline(now, ttl));
     }
 
     bool get(Key key, Value& value) override
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = nodeMap_.find(key);
-        if(it != nodeMap_.end())
-        {
-            getInternal(it->second, value);
-            return true;
-        }
-        return false;
+        return visitLive(key, nodeMap_.hashOf(key), [&](const Value& cached) { value = cached; });
     }
 
     Value get(Key key) override
@@ -129,38 +175,302 @@ public:
         return value;
     }
 
+    // 在锁内把缓存中的值直接交给visitor，不做拷贝；visitor中不能再访问本缓存
+    bool visit(const Key& key, const std::function<void(const Value&)>& visitor) override
+    {
+        return visitLive(key, nodeMap_.hashOf(key), visitor);
+    }
+
+    // 直接用调用方的key视图与哈希探测索引，不构造Key也不再计算哈希
+    bool getHashed(const ZPHashedKey<Key>& key, Value& value) override
+    {
+        return visitLive(key.key, key.hash, [&](const Value& cached) { value = cached; });
+    }
+
+    bool visitHashed(const ZPHashedKey<Key>& key, const std::function<void(const Value&)>& visitor) override
+    {
+        return visitLive(key.key, key.hash, visitor);
+    }
+
+    // 整批只加一次锁，索引查找带预取
+    size_t getMany(std::span<const Key> keys, std::span<Value> values, std::vector<bool>& hits) override
+    {
+        hits.assign(keys.size(), false);
+        size_t hitCount = 0;
+        std::lock_guard<ZPMutex> lock(mutex_);
+        uint64_t now = expireEntries();
+        nodeMap_.findBatch(keys, [&](size_t i, auto it)
+        {
+            if (it == nodeMap_.end())
+                return;
+            if (it->second->expiredAt(now))
+            {
+                expireNode(it->second);
+                return;
+            }
+            getInternal(it->second, values[i]);
+            hits[i] = true;
+            ++hitCount;
+        });
+        counters_.add(ZPCacheEvent::Hit, hitCount);
+        counters_.add(ZPCacheEvent::Miss, keys.size() - hitCount);
+        return hitCount;
+    }
+
+    void putMany(std::span<const Key> keys, std::span<const Value> values) override
+    {
+        if (maxWeight_ == 0)
+            return;
+
+        std::lock_guard<ZPMutex> lock(mutex_);
+        expireEntries();
+        counters_.add(ZPCacheEvent::Put, keys.size());
+        nodeMap_.findBatch(keys, [&](size_t i, auto it)
+        {
+            if (it != nodeMap_.end())
+                updateNode(it->second, values[i]);
+            else
+                putInternal(keys[i], values[i]);
+        });
+    }
+
     // 清空缓存
     void purge()
     {
-        nodeMap_.clear();
-        freqToFreqList_.clear();
+        clearEntries();
+    }
+
+    // 把全部条目连同访问频次写入快照：频次从高到低，同一频次内从新到旧
+    bool saveSnapshot(const std::string& path)
+    {
+        ZPSnapshotWriter out(path);
+        writeSnapshot(out);
+        return out.commit();
+    }
+
+    // 用快照替换当前全部内容，直接重建各频次链表，不经过put。容量比保存时小时优先保留高频的条目；
+    // 停机期间已到期的条目被跳过。文件损坏或类型不符时缓存为空并返回false
+    bool loadSnapshot(const std::string& path)
+    {
+        ZPSnapshotReader in(path);
+        return readSnapshot(in);
+    }
+
+    void writeSnapshot(ZPSnapshotWriter& out)
+    {
+        std::lock_guard<ZPMutex> lock(mutex_);
+        uint64_t now = ZPTimingWheel::now();
+        std::vector<int> freqs;
+        freqs.reserve(freqToFreqList_.size());
+        for (auto& [freq, list] : freqToFreqList_)
+        {
+            if (!list->isEmpty())
+                freqs.push_back(freq);
+        }
+        std::sort(freqs.begin(), freqs.end(), std::greater<int>());
+
+        out.writeHeader(ZPSnapshotKind::Lfu, sizeof(Key), sizeof(Value));
+        out.write(static_cast<uint64_t>(nodeMap_.size()));
+        for (int freq : freqs)
+        {
+            ListType* list = freqToFreqList_[freq];
+            for (NodePtr node = list->tail_->pre; node != list->head_; node = node->pre)
+            {
+                out.write(node->key);
+                out.write(node->value);
+                out.write(static_cast<int32_t>(node->freq));
+                out.writeTtl(node->expiresAt(), now);
+            }
+        }
+    }
+
+    bool readSnapshot(ZPSnapshotReader& in)
+    {
+        std::lock_guard<ZPMutex> lock(mutex_);
+        clearEntries();
+
+        uint64_t count = 0;
+        if (!in.readHeader(ZPSnapshotKind::Lfu, sizeof(Key), sizeof(Value)) || !in.read(count))
+            return false;
+        nodeMap_.reserve(static_cast<size_t>(std::min<uint64_t>(in.boundCount(count), maxWeight_)));
+
+        uint64_t now = ZPTimingWheel::now();
+        timers_.advance(now, [](ZPTimerLink*) {});
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            Key key{};
+            Value value{};
+            int32_t freq = 0;
+            uint64_t ttl = 0;
+            if (!in.read(key) || !in.read(value) || !in.read(freq) || !in.read(ttl))
+            {
+                clearEntries();
+                return false;
+            }
+
+            // 装满后其余记录频次更低，只解码跳过
+            uint64_t expiresAt = 0;
+            if (!in.restoreDeadline(ttl, now, expiresAt))
+                continue;
+            size_t weight = weigh(key, value);
+            if (weight > maxWeight_ - totalWeight_ || nodeMap_.find(key) != nodeMap_.end())
+                continue;
+
+            NodePtr node = pool_.acquire();
+            node->key = std::move(key);
+            node->value = std::move(value);
+            node->freq = std::max<int32_t>(freq, 1);
+            node->weight = weight;
+            totalWeight_ += weight;
+            setExpiry(node, expiresAt);
+            nodeMap_[node->key] = node;
+            listFor(node->freq)->addFirstNode(node);
+            curTotalNum_ += node->freq;
+            minFreq_ = std::min(minFreq_, node->freq);
+        }
+        curAverageNum_ = nodeMap_.empty() ? 0 : curTotalNum_ / static_cast<int>(nodeMap_.size());
+        return true;
+    }
+
+    // 当前所有条目的权重之和；按条目数计容量时即条目数
+    size_t totalWeight()
+    {
+        std::lock_guard<ZPMutex> lock(mutex_);
+        return totalWeight_;
+    }
+
+    std::optional<std::chrono::nanoseconds> timeToLive(const Key& key) override
+    {
+        std::lock_guard<ZPMutex> lock(mutex_);
+        auto it = nodeMap_.find(key);
+        if (it == nodeMap_.end() || it->second->expiresAt() == 0)
+            return std::nullopt;
+        return ZPTimingWheel::remaining(it->second->expiresAt(), ZPTimingWheel::now());
+    }
+
+    ZPCacheStats stats() const override
+    {
+        ZPCacheStats snapshot;
+        counters_.fill(snapshot);
+        return snapshot;
+    }
+
+    void enableLatencySampling(uint32_t sampleEvery) override { counters_.enableLatencySampling(sampleEvery); }
+
+    bool setEvictionListener(ZPEvictionListener<Key, Value> listener) override
+    {
+        evictionListener_ = std::move(listener);
+        return true;
+    }
+
+    // value 是新的 maxAverageNum：平均访问频次超过它时开始老化，越小越偏向近期访问
+    bool setTuning(double value) override
+    {
+        std::lock_guard<ZPMutex> lock(mutex_);
+        maxAverageNum_ = static_cast<int>(std::clamp(std::lround(value), 1L, long(INT_MAX)));
+        return true;
     }
    
 
 
 private:
-    void putInternal(Key key, Value value); // 添加缓存
+    static constexpr size_t kWeightedReserve = 64;
+    static constexpr size_t kReservedLists = 16; // 预留的频次链表数，老化会把频次压在较小的范围内
+
+    ZPLfuCache(size_t maxWeight, ZPWeigher<Key, Value> weigher, int maxAverageNum,
+               std::pmr::memory_resource* resource, size_t reserveCount)
+    : maxWeight_(maxWeight), weigher_(std::move(weigher)), minFreq_(INT8_MAX), maxAverageNum_(maxAverageNum),
+    curAverageNum_(0), curTotalNum_(0)
+    , pool_(reserveCount + 2 * kReservedLists, resource)
+    , listPool_(kReservedLists, resource)
+    , nodeMap_(reserveCount, resource)
+    , freqToFreqList_(kReservedLists, resource)
+    {}
+
+    void putInternal(Key key, Value value, uint64_t expiresAt = 0); // 添加缓存
     void getInternal(NodePtr node, Value& value); // 获取缓存
+    void touchNode(NodePtr node); // 记录一次访问：访问频次+1并调整所在频次链表
+    void putEntry(const Key& key, Value value, uint64_t expiresAt); // expiresAt 为0表示不过期
+    void updateNode(NodePtr node, Value value, uint64_t expiresAt = 0); // 替换已有结点的值，按新权重淘汰到预算以内
+    void setExpiry(NodePtr node, uint64_t expiresAt);
+    uint64_t expireEntries(); // 回收已到期的结点并返回当前时间；定时轮为空时不读时钟，返回0
+    void expireEntries(uint64_t now);
+    void expireNode(NodePtr node);
+
+    // 查找未过期的结点，已过期的顺便回收并当作不存在。lookup 是 Key 或其视图，hash 与 nodeMap_.hashOf 一致
+    template<typename Lookup>
+    typename NodeMap::iterator findLive(const Lookup& key, size_t hash, uint64_t now)
+    {
+        auto it = nodeMap_.find(key, hash);
+        if (it != nodeMap_.end() && it->second->expiredAt(now))
+        {
+            expireNode(it->second);
+            return nodeMap_.end();
+        }
+        return it;
+    }
+
+    // 命中时记一次访问再把值交给fn
+    template<typename Lookup, typename Fn>
+    bool visitLive(const Lookup& key, size_t hash, Fn&& fn)
+    {
+        auto latency = counters_.timeGet();
+        std::lock_guard<ZPMutex> lock(mutex_);
+        auto it = findLive(key, hash, expireEntries());
+        if(it == nodeMap_.end())
+        {
+            counters_.add(ZPCacheEvent::Miss);
+            return false;
+        }
+        NodePtr node = it->second;
+        touchNode(node);
+        fn(node->value);
+        counters_.add(ZPCacheEvent::Hit);
+        return true;
+    }
+
+    size_t weigh(const Key& key, const Value& value) const
+    {
+        return weigher_ ? std::max<size_t>(weigher_(key, value), 1) : 1;
+    }
 
     void kickOut(); // 移除缓存中的过期数据
+    void clearEntries(); // 释放全部条目与频次链表，访问频次统计归零
+    void eraseNode(NodePtr node); // 从频次链表与索引中彻底移除结点
+    bool refreshMinFreq(); // minFreq_对应的链表为空时改为最小的非空频次，缓存为空返回false
 
     void removeFromFreqList(NodePtr node); // 从频率列表中移除节点
     void addToFreqList(NodePtr node); // 添加到频率列表
+    ListType* listFor(int freq); // 取得该频次的链表，不存在则创建
+    void releaseNode(NodePtr node); // 释放结点持有的值并归还结点池
 
     void addFreqNum(); // 增加平均访问等频率
     void decreaseFreqNum(int num); // 减少平均访问等频率
     void handleOverMaxAverageNum(); // 处理当前平均访问频率超过上限的情况
-    void updateMinFreq();
+    void agingStep(); // 推进一批老化
 
 private:
-    int capacity_;
+    size_t maxWeight_;       // 缓存容量：权重之和的上限，未设置weigher时即条目数
+    size_t totalWeight_ = 0; // 当前所有条目的权重之和
+    ZPWeigher<Key, Value> weigher_; // 为空时每个条目权重为1
+    ZPEvictionListener<Key, Value> evictionListener_; // 为空时不通知
+    ZPTimingWheel timers_;         // 只挂带TTL的结点
     int minFreq_;       // 最小访问频次
     int maxAverageNum_; // 最大平均访问频次
     int curAverageNum_; // 当前平均访问频次
     int curTotalNum_;   // 当前访问所有缓存次数总数
-    std::mutex mutex_;  // 互斥锁
+    ZPMutex mutex_;  // 互斥锁
+    ZPNodePool<Node> pool_;         // 条目与各频次链表的虚拟结点
+    ZPNodePool<ListType> listPool_; // 频次链表，频次链表一旦创建就一直保留到清空缓存
     NodeMap nodeMap_;   // key 到缓存节点的映射
-    std::unordered_map<int , FreqList<Key, Value>*> freqToFreqList_; // 访问频次到该频次链表的映射
+    ZPFlatHashMap<int, ListType*> freqToFreqList_; // 访问频次到该频次链表的映射
+
+    // 老化不再一次性遍历所有结点：每次访问只处理索引中固定数量的槽位，直到整张表走完一轮
+    static constexpr size_t kAgingSlotsPerStep = 64;
+    bool aging_ = false;      // 是否有一轮老化正在进行
+    size_t agingCursor_ = 0;  // 本轮老化处理到的槽位下标
+    size_t agingSlots_ = 0;   // 本轮开始时索引的槽位数，扩容后槽位下标不再对应原来的结点
+    ZPCacheCounters counters_;
 };
 
 template<typename Key, typename Value>
@@ -169,6 +479,12 @@ void ZPLfuCache<Key, Value>::getInternal(NodePtr node, Value& value)
     // 找到之后需要将其从低访问频次的链表中删除，并且添加到+1的访问频次链表中，
     // 访问频次+1, 然后把value值返回
     value = node->value;
+    touchNode(node);
+}
+
+template<typename Key, typename Value>
+void ZPLfuCache<Key, Value>::touchNode(NodePtr node)
+{
     // 从原有访问频次的链表中删除节点
     removeFromFreqList(node);
     node->freq++;
@@ -183,18 +499,95 @@ void ZPLfuCache<Key, Value>::getInternal(NodePtr node, Value& value)
 }
 
 template<typename Key, typename Value>
-void ZPLfuCache<Key, Value>::putInternal(Key key, Value value)
+void ZPLfuCache<Key, Value>::putEntry(const Key& key, Value value, uint64_t expiresAt)
+{
+    auto it = nodeMap_.find(key);
+    if(it != nodeMap_.end())
+    {
+        // reset value，找到了直接调整就好了，不用再去get中找一遍
+        updateNode(it->second, std::move(value), expiresAt);
+        return;
+    }
+
+    putInternal(key, std::move(value), expiresAt);
+}
+
+template<typename Key, typename Value>
+void ZPLfuCache<Key, Value>::setExpiry(NodePtr node, uint64_t expiresAt)
+{
+    if (expiresAt)
+        timers_.schedule(node, expiresAt);
+    else
+        timers_.cancel(node);
+}
+
+template<typename Key, typename Value>
+uint64_t ZPLfuCache<Key, Value>::expireEntries()
+{
+    if (timers_.empty())
+        return 0;
+    uint64_t now = ZPTimingWheel::now();
+    expireEntries(now);
+    return now;
+}
+
+template<typename Key, typename Value>
+void ZPLfuCache<Key, Value>::expireEntries(uint64_t now)
+{
+    timers_.advance(now, [this](ZPTimerLink* link) { expireNode(static_cast<NodePtr>(link)); });
+}
+
+template<typename Key, typename Value>
+void ZPLfuCache<Key, Value>::expireNode(NodePtr node)
+{
+    eraseNode(node);
+    counters_.add(ZPCacheEvent::Eviction);
+    counters_.add(ZPCacheEvent::Expiration);
+}
+
+template<typename Key, typename Value>
+void ZPLfuCache<Key, Value>::updateNode(NodePtr node, Value value, uint64_t expiresAt)
+{
+    size_t weight = weigh(node->key, value);
+    if (weight > maxWeight_)
+    {
+        // 新值单独就超出了总预算，连同旧值一起丢弃
+        eraseNode(node);
+        return;
+    }
+
+    totalWeight_ = totalWeight_ - node->weight + weight;
+    node->weight = weight;
+    node->value = std::move(value);
+    setExpiry(node, expiresAt);
+    touchNode(node);
+    while (totalWeight_ > maxWeight_)
+        kickOut();
+}
+
+template<typename Key, typename Value>
+void ZPLfuCache<Key, Value>::putInternal(Key key, Value value, uint64_t expiresAt)
 {
+    size_t weight = weigh(key, value);
+    if (weight > maxWeight_)
+        return; // 单个条目超过总预算，不缓存
+
     // 如果不在缓存中，则需要判断缓存是否已满
-    if(nodeMap_.size() == capacity_)
+    while (totalWeight_ + weight > maxWeight_)
     {
         // 缓存已满， 删除最不常访问的节点， 更新当前平均访问频次和总访问频次
         kickOut();
     }
 
-    // 创建新结点，将新结点添加进入，更新最小访问频次
-    NodePtr node = std::make_shared<Node>(key, value);
-    nodeMap_[key] = node;
+    // 从结点池取出新结点，将新结点添加进入，更新最小访问频次
+    NodePtr node = pool_.acquire();
+    node->freq = 1;
+    node->key = std::move(key);
+    node->value = std::move(value);
+    node->weight = weight;
+    totalWeight_ += weight;
+    setExpiry(node, expiresAt);
+    nodeMap_[node->key] = node;
     addToFreqList(node);
     addFreqNum();
     minFreq_ = std::min(minFreq_, 1);
@@ -203,10 +596,91 @@ void ZPLfuCache<Key, Value>::putInternal(Key key, Value value)
 template<typename Key, typename Value>
 void ZPLfuCache<Key, Value>::kickOut()
 {
-    NodePtr node = freqToFreqList_[minFreq_]->getFirstNode();
+    // 按权重淘汰时一次可能要连续淘汰多个结点，minFreq_所在的链表可能已被淘汰空
+    if (!refreshMinFreq())
+        return;
+    NodePtr victim = freqToFreqList_[minFreq_]->getFirstNode();
+    counters_.add(ZPCacheEvent::Eviction);
+    if (evictionListener_)
+        evictionListener_(victim->key, victim->value);
+    eraseNode(victim);
+}
+
+template<typename Key, typename Value>
+void ZPLfuCache<Key, Value>::clearEntries()
+{
+    timers_.clear();
+    nodeMap_.clear();
+    for (auto& [freq, list] : freqToFreqList_)
+    {
+        NodePtr node = list->head_->next;
+        while (node != list->tail_)
+        {
+            NodePtr next = node->next;
+            releaseNode(node);
+            node = next;
+        }
+        releaseNode(list->head_);
+        releaseNode(list->tail_);
+        listPool_.release(list);
+    }
+    freqToFreqList_.clear();
+    totalWeight_ = 0;
+    minFreq_ = INT8_MAX;
+    curAverageNum_ = 0;
+    curTotalNum_ = 0;
+    aging_ = false;
+}
+
+template<typename Key, typename Value>
+void ZPLfuCache<Key, Value>::eraseNode(NodePtr node)
+{
     removeFromFreqList(node);
     nodeMap_.erase(node->key);
+    totalWeight_ -= node->weight;
     decreaseFreqNum(node->freq);
+    releaseNode(node);
+}
+
+template<typename Key, typename Value>
+void ZPLfuCache<Key, Value>::releaseNode(NodePtr node)
+{
+    timers_.cancel(node);
+    node->pre = nullptr;
+    node->next = nullptr;
+    node->value = Value();
+    pool_.release(node);
+}
+
+template<typename Key, typename Value>
+typename ZPLfuCache<Key, Value>::ListType* ZPLfuCache<Key, Value>::listFor(int freq)
+{
+    ListType*& list = freqToFreqList_[freq];
+    if (!list)
+    {
+        list = listPool_.acquire();
+        list->init(freq, pool_);
+    }
+    return list;
+}
+
+template<typename Key, typename Value>
+bool ZPLfuCache<Key, Value>::refreshMinFreq()
+{
+    auto it = freqToFreqList_.find(minFreq_);
+    if (it != freqToFreqList_.end() && !it->second->isEmpty())
+        return true;
+
+    bool found = false;
+    for (auto& [freq, list] : freqToFreqList_)
+    {
+        if (!list->isEmpty() && (!found || freq < minFreq_))
+        {
+            minFreq_ = freq;
+            found = true;
+        }
+    }
+    return found;
 }
 
 template<typename Key, typename Value>
@@ -227,15 +701,8 @@ void ZPLfuCache<Key, Value>::addToFreqList(NodePtr node)
     if (!node) 
         return;
 
-    // 添加进入相应的频次链表前需要判断该频次链表是否存在
-    auto freq = node->freq;
-    if (freqToFreqList_.find(node->freq) == freqToFreqList_.end())
-    {
-        // 不存在则创建
-        freqToFreqList_[node->freq] = new FreqList<Key, Value>(node->freq);
-    }
-
-    freqToFreqList_[freq]->addNode(node);
+    // 添加进入相应的频次链表，该频次的链表不存在时先创建
+    listFor(node->freq)->addNode(node);
 }
 
 template<typename Key, typename Value>
@@ -247,7 +714,7 @@ void ZPLfuCache<Key, Value>::addFreqNum()
     else
         curAverageNum_ = curTotalNum_ / nodeMap_.size();
 
-    if (curAverageNum_ > maxAverageNum_)
+    if (aging_ || curAverageNum_ > maxAverageNum_)
     {
        handleOverMaxAverageNum();
     }
@@ -270,43 +737,57 @@ void ZPLfuCache<Key, Value>::handleOverMaxAverageNum()
     if (nodeMap_.empty())
         return;
 
-    // 当前平均访问频次已经超过了最大平均访问频次，所有结点的访问频次- (maxAverageNum_ / 2)
-    for (auto it = nodeMap_.begin(); it != nodeMap_.end(); ++it)
+    // 当前平均访问频次已经超过了最大平均访问频次，开始新一轮老化：
+    // 所有结点的访问频次- (maxAverageNum_ / 2)，分摊到之后的每次访问中完成
+    if (!aging_)
     {
-        // 检查结点是否为空
-        if (!it->second)
-            continue;
-
-        NodePtr node = it->second;
+        aging_ = true;
+        agingCursor_ = 0;
+        agingSlots_ = nodeMap_.slotCount();
+        counters_.add(ZPCacheEvent::AgingRun);
+    }
+    agingStep();
+}
 
-        // 先从当前频率列表中移除
-        removeFromFreqList(node);
+template<typename Key, typename Value>
+void ZPLfuCache<Key, Value>::agingStep()
+{
+    // 本轮中途的插入使索引扩容时结点都换了槽位，继续走下去会漏掉一些结点、重复老化另一些。
+    // 直接结束本轮，平均频次仍然超限时下一次访问会在新的槽位上开始新一轮
+    if (nodeMap_.slotCount() != agingSlots_)
+    {
+        aging_ = false;
+        curAverageNum_ = nodeMap_.empty() ? 0 : curTotalNum_ / nodeMap_.size();
+        return;
+    }
 
-        // 减少频率
-        node->freq -= maxAverageNum_ / 2;
-        if (node->freq < 1) node->freq = 1;
+    const int decay = std::max(1, maxAverageNum_ / 2);
+    size_t last = agingCursor_ + kAgingSlotsPerStep;
+    nodeMap_.forEachInSlots(agingCursor_, last, [&](auto& entry)
+    {
+        NodePtr node = entry.second;
+        int oldFreq = node->freq;
+        int newFreq = std::max(1, oldFreq - decay);
+        if (newFreq == oldFreq)
+            return;
 
-        // 添加到新的频率列表
+        // 先从当前频率列表中移除，减少频率后添加到新的频率列表
+        removeFromFreqList(node);
+        node->freq = newFreq;
         addToFreqList(node);
-    }
 
-    // 更新最小频率
-    updateMinFreq();
-}
+        // 频次只会降低，最小频次随之下调即可，无需扫描所有频率列表
+        minFreq_ = std::min(minFreq_, newFreq);
+        curTotalNum_ -= oldFreq - newFreq;
+    });
 
-template<typename Key, typename Value>
-void ZPLfuCache<Key, Value>::updateMinFreq() 
-{
-    minFreq_ = INT8_MAX;
-    for (const auto& pair : freqToFreqList_) 
+    agingCursor_ = last;
+    if (agingCursor_ >= nodeMap_.slotCount())
     {
-        if (pair.second && !pair.second->isEmpty()) 
-        {
-            minFreq_ = std::min(minFreq_, pair.first);
-        }
+        // 本轮结束，按老化后的总访问次数重新计算平均访问频次
+        aging_ = false;
+        curAverageNum_ = nodeMap_.empty() ? 0 : curTotalNum_ / nodeMap_.size();
     }
-    if (minFreq_ == INT8_MAX) 
-        minFreq_ = 1;
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+
+namespace ZPCache
+{
+
+// 当前线程的加锁统计。只在定义了 ZPCACHE_LOCK_PROFILING 时才会被累加；
+// 计数放在线程局部变量里，统计本身不会引入新的共享缓存行
+struct ZPLockStats
+{
+    uint64_t acquisitions = 0; // 成功加锁次数（含共享锁）
+    uint64_t contended = 0;    // 第一次尝试失败、需要等待的次数
+    uint64_t waitNs = 0;       // 等待锁的总时间
+};
+
+inline ZPLockStats& threadLockStats()
+{
+    thread_local ZPLockStats stats;
+    return stats;
+}
+
+inline void resetThreadLockStats() { threadLockStats() = ZPLockStats{}; }
+
+// 可计时的互斥锁包装：先 try_lock，失败时才读时钟，记录阻塞等待的时长。
+// 满足 Lockable（以及 Mutex 支持时的 SharedLockable），可直接用于 lock_guard / shared_lock
+template<typename Mutex>
+class ZPProfiledMutex
+{
+public:
+    void lock()
+    {
+        if (!mutex_.try_lock())
+            waitFor([this] { mutex_.lock(); });
+        ++threadLockStats().acquisitions;
+    }
+
+    bool try_lock()
+    {
+        bool locked = mutex_.try_lock();
+        if (locked)
+            ++threadLockStats().acquisitions;
+        return locked;
+    }
+
+    void unlock() { mutex_.unlock(); }
+
+    void lock_shared() requires requires(Mutex& m) { m.lock_shared(); }
+    {
+        if (!mutex_.try_lock_shared())
+            waitFor([this] { mutex_.lock_shared(); });
+        ++threadLockStats().acquisitions;
+    }
+
+    bool try_lock_shared() requires requires(Mutex& m) { m.try_lock_shared(); }
+    {
+        bool locked = mutex_.try_lock_shared();
+        if (locked)
+            ++threadLockStats().acquisitions;
+        return locked;
+    }
+
+    void unlock_shared() requires requires(Mutex& m) { m.unlock_shared(); }
+    {
+        mutex_.unlock_shared();
+    }
+
+private:
+    template<typename BlockingLock>
+    static void waitFor(BlockingLock blockingLock)
+    {
+        auto start = std::chrono::steady_clock::now();
+        blockingLock();
+        auto waited = std::chrono::steady_clock::now() - start;
+        ZPLockStats& stats = threadLockStats();
+        ++stats.contended;
+        stats.waitNs += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count());
+    }
+
+private:
+    Mutex mutex_;
+};
+
+// 各缓存策略统一使用的锁类型；编译时定义 ZPCACHE_LOCK_PROFILING 即可在不改代码的情况下统计锁等待
+#ifdef ZPCACHE_LOCK_PROFILING
+using ZPMutex = ZPProfiledMutex<std::mutex>;
+using ZPSharedMutex = ZPProfiledMutex<std::shared_mutex>;
+#else
+using ZPMutex = std::mutex;
+using ZPSharedMutex = std::shared_mutex;
+#endif
+
+} // namespace ZPCache
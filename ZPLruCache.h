@@ -1,14 +1,32 @@
 #pragma once 
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
 #include <cstring>
+#include <functional>
 #include <list>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
-#include <unordered_map>
+#include <optional>
+#include <shared_mutex>
+#include <string>
 #include <thread>
 #include <vector>
 
 #include "ZPCachePolicy.h"
+#include "ZPCompactHistory.h"
+#include "ZPFlatHashMap.h"
+#include "ZPHash.h"
+#include "ZPLockProfiling.h"
+#include "ZPNodePool.h"
+#include "ZPShardedCache.h"
+#include "ZPSnapshot.h"
+#include "ZPTimingWheel.h"
 
 namespace ZPCache
 {
@@ -16,26 +34,96 @@ namespace ZPCache
 // 前向声明
 template<typename Key, typename Value> class ZPLruCache;
 
+// LRU命中时的并发策略
+enum class LruHitMode
+{
+    Exclusive, // 每次命中都加独占锁并立即把结点移到最新位置（严格LRU）
+    Buffered,  // 命中只加共享锁，结点先记入环形缓冲区，之后在独占锁下批量重放（近似LRU，读可并行）
+};
+
+// ZPLruCache 的锁：只有 Buffered 模式的命中需要共享锁，Exclusive 模式用普通互斥锁，不为读写锁付出额外开销。
+// 模式在构造时确定，共享加锁在 Exclusive 模式下退化为独占加锁，调用处统一按 Buffered 的方式写
+class LruMutex
+{
+public:
+    explicit LruMutex(bool shared) : shared_(shared) {}
+
+    void lock()
+    {
+        if (shared_)
+            sharedMutex_.lock();
+        else
+            mutex_.lock();
+    }
+
+    bool try_lock() { return shared_ ? sharedMutex_.try_lock() : mutex_.try_lock(); }
+
+    void unlock()
+    {
+        if (shared_)
+            sharedMutex_.unlock();
+        else
+            mutex_.unlock();
+    }
+
+    void lock_shared()
+    {
+        if (shared_)
+            sharedMutex_.lock_shared();
+        else
+            mutex_.lock();
+    }
+
+    void unlock_shared()
+    {
+        if (shared_)
+            sharedMutex_.unlock_shared();
+        else
+            mutex_.unlock();
+    }
+
+private:
+    const bool    shared_;
+    ZPMutex       mutex_;       // Exclusive 模式
+    ZPSharedMutex sharedMutex_; // Buffered 模式
+};
+
 template<typename Key, typename Value>
-class LruNode 
+class LruNode : public ZPTimerLink // 带TTL的结点挂在所属缓存的定时轮上
 {
 private:
     Key key_;
     Value value_;
     size_t accessCount_;  // 访问次数
-    std::weak_ptr<LruNode<Key, Value>> prev_;  // 改为weak_ptr打破循环引用
-    std::shared_ptr<LruNode<Key, Value>> next_;
+    size_t weight_;       // 条目权重，按条目数计容量时恒为1
+    bool protected_;      // 分段模式下是否位于保护段
+    LruNode* prev_;       // 结点由ZPNodePool统一持有，链表只用裸指针串联
+    LruNode* next_;
 
 public:
+    LruNode()
+        : key_()
+        , value_()
+        , accessCount_(1)
+        , weight_(1)
+        , protected_(false)
+        , prev_(nullptr)
+        , next_(nullptr)
+    {}
+
     LruNode(Key key, Value value)
-        : key_(key)
-        , value_(value)
+        : key_(std::move(key))
+        , value_(std::move(value))
         , accessCount_(1) 
+        , weight_(1)
+        , protected_(false)
+        , prev_(nullptr)
+        , next_(nullptr)
     {}
 
     // 提供必要的访问器
     Key getKey() const { return key_; }
-    Value getValue() const { return value_; }
+    const Value& getValue() const { return value_; }
     void setValue(const Value& value) { value_ = value; }
     size_t getAccessCount() const { return accessCount_; }
     void incrementAccessCount() { ++accessCount_; }
@@ -49,46 +137,95 @@ class ZPLruCache : public ZPCachePolicy<Key, Value>
 {
 public:
     using LruNodeType = LruNode<Key, Value>;
-    using NodePtr = std::shared_ptr<LruNodeType>;
-    using NodeMap = std::unordered_map<Key, NodePtr>;
+    using NodePtr = LruNodeType*;
+    using NodeMap = ZPFlatHashMap<Key, NodePtr>;
 
-    ZPLruCache(int capacity)
-        : capacity_(capacity)
-    {
-        initializeList();
-    }
+    // 结点池和索引都按capacity_预分配（结点池外加两个虚拟结点），稳态下不再分配内存
+    ZPLruCache(int capacity, LruHitMode hitMode = LruHitMode::Exclusive)
+        : ZPLruCache(std::allocator_arg, std::pmr::get_default_resource(), capacity, hitMode)
+    {}
+
+    // 结点池与索引从resource分配（例如分片缓存为每个分片准备的池化resource），要求resource比缓存活得更久
+    ZPLruCache(std::allocator_arg_t, std::pmr::memory_resource* resource, int capacity,
+               LruHitMode hitMode = LruHitMode::Exclusive)
+        : ZPLruCache(capacity > 0 ? static_cast<size_t>(capacity) : 0, nullptr, hitMode, resource,
+                     capacity > 0 ? static_cast<size_t>(capacity) : 0)
+    {}
+
+    // 按权重计容量：所有条目的权重之和（例如字节数）不超过maxWeight，超出时从最久未访问的一端淘汰到预算以内。
+    // 条目数事先未知，结点池与索引只预留少量空间，之后按需增长
+    ZPLruCache(size_t maxWeight, ZPWeigher<Key, Value> weigher, LruHitMode hitMode = LruHitMode::Exclusive)
+        : ZPLruCache(std::allocator_arg, std::pmr::get_default_resource(), maxWeight, std::move(weigher), hitMode)
+    {}
+
+    ZPLruCache(std::allocator_arg_t, std::pmr::memory_resource* resource, size_t maxWeight,
+               ZPWeigher<Key, Value> weigher, LruHitMode hitMode = LruHitMode::Exclusive)
+        : ZPLruCache(maxWeight, std::move(weigher), hitMode, resource, kWeightedReserve)
+    {}
 
     ~ZPLruCache() override = default;
 
     // 添加缓存
     void put(Key key, Value value) override
     {
-        if (capacity_ <= 0)
+        if (maxWeight_ == 0)
             return;
     
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = nodeMap_.find(key);
-        if (it != nodeMap_.end())
+        auto latency = counters_.timePut();
+        std::lock_guard<LruMutex> lock(mutex_);
+        drainReadBuffers();
+        expireEntries();
+        counters_.add(ZPCacheEvent::Put);
+        putEntry(key, std::move(value), 0);
+    }
+
+    // 带TTL的添加：ttl之后条目过期，不再命中，并在之后的读写中由定时轮回收（计入淘汰统计）。
+    // 同一个key之后不带TTL的put会取消过期时间；ttl<=0 等同于删除
+    void put(Key key, Value value, std::chrono::nanoseconds ttl) override
+    {
+        if (maxWeight_ == 0)
+            return;
+
+        auto latency = counters_.timePut();
+        std::lock_guard<LruMutex> lock(mutex_);
+        drainReadBuffers();
+        uint64_t now = ZPTimingWheel::now();
+        expireEntries(now);
+        counters_.add(ZPCacheEvent::Put);
+        if (ttl.count() <= 0)
         {
-            // 如果在当前容器中,则更新value,并调用get方法，代表该数据刚被访问
-            updateExistingNode(it->second, value);
-            return ;
+            auto it = nodeMap_.find(key);
+            if (it != nodeMap_.end())
+                eraseNode(it->second);
+            return;
         }
-
-        addNewNode(key, value);
+        putEntry(key, std::move(value), ZPTimingWheel::deadline(now, ttl));
     }
 
     bool get(Key key, Value& value) override
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = nodeMap_.find(key);
-        if (it != nodeMap_.end())
-        {
-            moveToMostRecent(it->second);
-            value = it->second->getValue();
-            return true;
-        }
-        return false;
+        auto latency = counters_.timeGet();
+        return recordLookup(visitNode(key, nodeMap_.hashOf(key), [&](const Value& cached) { value = cached; }));
+    }
+
+    // 在锁内把缓存中的值直接交给visitor，不做拷贝；visitor中不能再访问本缓存
+    bool visit(const Key& key, const std::function<void(const Value&)>& visitor) override
+    {
+        auto latency = counters_.timeGet();
+        return recordLookup(visitNode(key, nodeMap_.hashOf(key), visitor));
+    }
+
+    // 直接用调用方的key视图与哈希探测索引，不构造Key也不再计算哈希
+    bool getHashed(const ZPHashedKey<Key>& key, Value& value) override
+    {
+        auto latency = counters_.timeGet();
+        return recordLookup(visitNode(key.key, key.hash, [&](const Value& cached) { value = cached; }));
+    }
+
+    bool visitHashed(const ZPHashedKey<Key>& key, const std::function<void(const Value&)>& visitor) override
+    {
+        auto latency = counters_.timeGet();
+        return recordLookup(visitNode(key.key, key.hash, visitor));
     }
 
     Value get(Key key) override
@@ -99,87 +236,614 @@ public:
         return value;
     }
 
+    // 整批只加一次锁，索引查找带预取
+    size_t getMany(std::span<const Key> keys, std::span<Value> values, std::vector<bool>& hits) override
+    {
+        hits.assign(keys.size(), false);
+        size_t hitCount = 0;
+        std::lock_guard<LruMutex> lock(mutex_);
+        drainReadBuffers();
+        uint64_t now = expireEntries();
+        nodeMap_.findBatch(keys, [&](size_t i, auto it)
+        {
+            if (it == nodeMap_.end())
+                return;
+            if (it->second->expiredAt(now))
+            {
+                expireNode(it->second);
+                return;
+            }
+            moveToMostRecent(it->second);
+            values[i] = it->second->getValue();
+            hits[i] = true;
+            ++hitCount;
+        });
+        counters_.add(ZPCacheEvent::Hit, hitCount);
+        counters_.add(ZPCacheEvent::Miss, keys.size() - hitCount);
+        return hitCount;
+    }
+
+    void putMany(std::span<const Key> keys, std::span<const Value> values) override
+    {
+        if (maxWeight_ == 0)
+            return;
+
+        std::lock_guard<LruMutex> lock(mutex_);
+        drainReadBuffers();
+        expireEntries();
+        counters_.add(ZPCacheEvent::Put, keys.size());
+        nodeMap_.findBatch(keys, [&](size_t i, auto it)
+        {
+            if (it != nodeMap_.end())
+                updateExistingNode(it->second, values[i]);
+            else
+                addNewNode(keys[i], values[i]);
+        });
+    }
+
     // 删除指定元素
     void remove(Key key) 
     {   
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<LruMutex> lock(mutex_);
+        drainReadBuffers();
         auto it = nodeMap_.find(key);
         if (it != nodeMap_.end())
+            eraseNode(it->second);
+    }
+
+    // 当前所有条目的权重之和；按条目数计容量时即条目数
+    size_t totalWeight()
+    {
+        std::lock_guard<LruMutex> lock(mutex_);
+        return totalWeight_;
+    }
+
+    // 把全部条目按从新到旧的顺序写入快照文件，键和值用 ZPSnapshotCodec 编码。写入期间持有独占锁
+    bool saveSnapshot(const std::string& path)
+    {
+        ZPSnapshotWriter out(path);
+        writeSnapshot(out);
+        return out.commit();
+    }
+
+    // 用快照替换当前全部内容：按记录顺序直接建立链表与索引，不经过put，也不计入统计。
+    // 容量比保存时小时只保留最新的条目；停机期间已到期的条目被跳过。文件损坏或类型不符时缓存为空并返回false
+    bool loadSnapshot(const std::string& path)
+    {
+        ZPSnapshotReader in(path);
+        return readSnapshot(in);
+    }
+
+    // 供分片缓存把各分片写进同一个文件
+    void writeSnapshot(ZPSnapshotWriter& out)
+    {
+        std::lock_guard<LruMutex> lock(mutex_);
+        drainReadBuffers();
+        uint64_t now = ZPTimingWheel::now();
+        out.writeHeader(ZPSnapshotKind::Lru, sizeof(Key), sizeof(Value));
+        out.write(static_cast<uint64_t>(nodeMap_.size()));
+        for (NodePtr node = dummyTail_->prev_; node != dummyHead_; node = node->prev_)
+        {
+            if (node == midpoint_)
+                continue;
+            out.write(node->key_);
+            out.write(node->value_);
+            out.writeTtl(node->expiresAt(), now);
+        }
+    }
+
+    bool readSnapshot(ZPSnapshotReader& in)
+    {
+        std::lock_guard<LruMutex> lock(mutex_);
+        drainReadBuffers();
+        clearEntries();
+
+        uint64_t count = 0;
+        if (!in.readHeader(ZPSnapshotKind::Lru, sizeof(Key), sizeof(Value)) || !in.read(count))
+            return false;
+        size_t reserveCount = static_cast<size_t>(std::min<uint64_t>(in.boundCount(count), maxWeight_));
+        nodeMap_.reserve(reserveCount);
+        pool_.reserve(reserveCount);
+
+        uint64_t now = ZPTimingWheel::now();
+        timers_.advance(now, [](ZPTimerLink*) {});
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            Key key{};
+            Value value{};
+            uint64_t ttl = 0;
+            if (!in.read(key) || !in.read(value) || !in.read(ttl))
+            {
+                clearEntries();
+                return false;
+            }
+
+            // 缓存装满后其余记录更旧，只解码跳过，保证读取位置停在本段末尾
+            uint64_t expiresAt = 0;
+            if (!in.restoreDeadline(ttl, now, expiresAt))
+                continue;
+            size_t weight = weigh(key, value);
+            if (weight > maxWeight_ - totalWeight_ || nodeMap_.find(key) != nodeMap_.end())
+                continue;
+
+            NodePtr node = pool_.acquire();
+            node->key_ = std::move(key);
+            node->value_ = std::move(value);
+            node->accessCount_ = 1;
+            node->weight_ = weight;
+            totalWeight_ += weight;
+            setExpiry(node, expiresAt);
+            insertOldest(node);
+            nodeMap_[node->key_] = node;
+        }
+        return true;
+    }
+
+    // 只读结点的过期时间，Buffered模式与读并行
+    std::optional<std::chrono::nanoseconds> timeToLive(const Key& key) override
+    {
+        std::shared_lock<LruMutex> lock(mutex_);
+        auto it = nodeMap_.find(key);
+        if (it == nodeMap_.end() || it->second->expiresAt() == 0)
+            return std::nullopt;
+        return ZPTimingWheel::remaining(it->second->expiresAt(), ZPTimingWheel::now());
+    }
+
+    ZPCacheStats stats() const override
+    {
+        ZPCacheStats snapshot;
+        counters_.fill(snapshot);
+        if (readBuffers_)
         {
-            removeNode(it->second);
-            nodeMap_.erase(it);
+            for (size_t stripe = 0; stripe < kReadBufferStripes; ++stripe)
+            {
+                snapshot.hits += readBuffers_[stripe].hits.load(std::memory_order_relaxed);
+                snapshot.misses += readBuffers_[stripe].misses.load(std::memory_order_relaxed);
+            }
         }
+        return snapshot;
+    }
+
+    void enableLatencySampling(uint32_t sampleEvery) override { counters_.enableLatencySampling(sampleEvery); }
+
+    bool setEvictionListener(ZPEvictionListener<Key, Value> listener) override
+    {
+        evictionListener_ = std::move(listener);
+        return true;
+    }
+
+protected:
+    // 命中时刷新访问顺序，不拷贝值也不计入命中统计，供派生类判断key是否已在主缓存中
+    bool touch(const Key& key)
+    {
+        return visitNode(key, nodeMap_.hashOf(key), [](const Value&) {});
+    }
+
+    size_t maxWeight() const { return maxWeight_; }
+
+    // 分段模式下调整保护段的权重上限，超出的部分从最旧的一端降回试用段；不是分段模式时返回false
+    bool setProtectedCapacity(size_t protectedWeight)
+    {
+        std::lock_guard<LruMutex> lock(mutex_);
+        if (!midpoint_ || protectedWeight == 0)
+            return false;
+        protectedCapacity_ = protectedWeight;
+        while (protectedWeight_ > protectedCapacity_)
+        {
+            NodePtr oldest = midpoint_->next_;
+            removeNode(oldest);
+            linkBefore(midpoint_, oldest);
+        }
+        return true;
+    }
+
+    static constexpr size_t kWeightedReserve = 64;
+
+    // protectedWeight > 0 时启用分段（SLRU）模式，供 ZPSlruCache 使用
+    ZPLruCache(size_t maxWeight, ZPWeigher<Key, Value> weigher, LruHitMode hitMode,
+               std::pmr::memory_resource* resource, size_t reserveCount, size_t protectedWeight = 0)
+        : maxWeight_(maxWeight)
+        , protectedCapacity_(protectedWeight)
+        , weigher_(std::move(weigher))
+        , hitMode_(hitMode)
+        , pool_(reserveCount + (protectedWeight ? 3 : 2), resource)
+        , nodeMap_(reserveCount, resource)
+        , mutex_(hitMode == LruHitMode::Buffered)
+    {
+        if (hitMode_ == LruHitMode::Buffered)
+            readBuffers_ = std::make_unique<ReadBuffer[]>(kReadBufferStripes);
+        initializeList();
     }
 
 private:
+    size_t weigh(const Key& key, const Value& value) const
+    {
+        return weigher_ ? std::max<size_t>(weigher_(key, value), 1) : 1;
+    }
+
+    // 每个线程固定映射到一个缓冲区分片，分片之间按缓存行对齐，避免读线程互相争用同一个写下标
+    static constexpr size_t kReadBufferStripes = 16;
+    static constexpr size_t kReadBufferSize = 32;
+
+    struct alignas(64) ReadBuffer
+    {
+        std::atomic<size_t> writeIndex{0};
+        std::atomic<uint64_t> hits{0};   // Buffered模式的命中/未命中按分片计数，读线程之间不争用同一计数器
+        std::atomic<uint64_t> misses{0};
+        std::array<std::atomic<NodePtr>, kReadBufferSize> nodes{};
+    };
+
+    static size_t readBufferStripe()
+    {
+        thread_local const size_t stripe =
+            mixHash(std::hash<std::thread::id>()(std::this_thread::get_id())) & (kReadBufferStripes - 1);
+        return stripe;
+    }
+
+    bool recordLookup(bool hit)
+    {
+        if (readBuffers_)
+        {
+            ReadBuffer& buffer = readBuffers_[readBufferStripe()];
+            (hit ? buffer.hits : buffer.misses).fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            counters_.add(hit ? ZPCacheEvent::Hit : ZPCacheEvent::Miss);
+        }
+        return hit;
+    }
+
+    // lookup 是 Key 或其视图（见 ZPKeyView），hash 与 nodeMap_.hashOf 一致
+    template<typename Lookup, typename Fn>
+    bool visitNode(const Lookup& key, size_t hash, Fn&& fn)
+    {
+        if (hitMode_ == LruHitMode::Buffered)
+            return visitBuffered(key, hash, fn);
+
+        std::lock_guard<LruMutex> lock(mutex_);
+        uint64_t now = expireEntries();
+        auto it = nodeMap_.find(key, hash);
+        if (it != nodeMap_.end())
+        {
+            if (it->second->expiredAt(now))
+            {
+                expireNode(it->second);
+                return false;
+            }
+            moveToMostRecent(it->second);
+            fn(it->second->getValue());
+            return true;
+        }
+        return false;
+    }
+
+    // 共享锁下的命中：只读取值并记录本次访问，不修改链表
+    template<typename Lookup, typename Fn>
+    bool visitBuffered(const Lookup& key, size_t hash, Fn&& fn)
+    {
+        bool bufferFull = false;
+        bool expired = false;
+        {
+            std::shared_lock<LruMutex> lock(mutex_);
+            auto it = nodeMap_.find(key, hash);
+            if (it == nodeMap_.end())
+                return false;
+            // 共享锁下不能修改定时轮，已过期的结点先当作未命中，出锁后再尝试回收
+            expired = !timers_.empty() && it->second->expiredAt(ZPTimingWheel::now());
+            if (!expired)
+            {
+                fn(it->second->getValue());
+                bufferFull = recordHit(it->second);
+            }
+        }
+
+        // 缓冲区写满或遇到过期结点时尝试获取独占锁批量重放并回收；拿不到锁说明其他线程正在写，交给它们处理
+        if (bufferFull || expired)
+        {
+            std::unique_lock<LruMutex> lock(mutex_, std::try_to_lock);
+            if (lock.owns_lock())
+            {
+                drainReadBuffers();
+                expireEntries();
+            }
+        }
+        return !expired;
+    }
+
+    // 返回缓冲区是否已满；已满时本次访问直接丢弃，只损失一点LRU精度
+    bool recordHit(NodePtr node)
+    {
+        ReadBuffer& buffer = readBuffers_[readBufferStripe()];
+        size_t index = buffer.writeIndex.fetch_add(1, std::memory_order_relaxed);
+        if (index >= kReadBufferSize)
+            return true;
+        buffer.nodes[index].store(node, std::memory_order_relaxed);
+        return index + 1 == kReadBufferSize;
+    }
+
+    // 必须持有独占锁调用：此时没有读线程处于临界区，记录的结点都仍在链表中
+    void drainReadBuffers()
+    {
+        if (!readBuffers_)
+            return;
+
+        for (size_t stripe = 0; stripe < kReadBufferStripes; ++stripe)
+        {
+            ReadBuffer& buffer = readBuffers_[stripe];
+            size_t count = buffer.writeIndex.load(std::memory_order_relaxed);
+            if (count == 0)
+                continue;
+            count = count < kReadBufferSize ? count : kReadBufferSize;
+            for (size_t i = 0; i < count; ++i)
+            {
+                NodePtr node = buffer.nodes[i].exchange(nullptr, std::memory_order_relaxed);
+                if (node && node->next_)
+                    moveToMostRecent(node);
+            }
+            buffer.writeIndex.store(0, std::memory_order_relaxed);
+        }
+    }
+
     void initializeList()
     {
         // 创建首尾虚拟节点
-        dummyHead_ = std::make_shared<LruNodeType>(Key(), Value());
-        dummyTail_ = std::make_shared<LruNodeType>(Key(), Value());
+        dummyHead_ = pool_.acquire();
+        dummyTail_ = pool_.acquire();
         dummyHead_->next_ = dummyTail_;
         dummyTail_->prev_ = dummyHead_;
+        if (protectedCapacity_)
+        {
+            midpoint_ = pool_.acquire();
+            linkBefore(dummyTail_, midpoint_);
+        }
+    }
+
+    void putEntry(const Key& key, Value value, uint64_t expiresAt)
+    {
+        auto it = nodeMap_.find(key);
+        if (it != nodeMap_.end())
+        {
+            // 如果在当前容器中,则更新value,并调用get方法，代表该数据刚被访问
+            updateExistingNode(it->second, std::move(value), expiresAt);
+            return ;
+        }
+
+        addNewNode(key, std::move(value), expiresAt);
     }
 
-    void updateExistingNode(NodePtr node, const Value& value) 
+    // expiresAt 为0表示不过期，并取消该结点原有的过期时间
+    void updateExistingNode(NodePtr node, Value value, uint64_t expiresAt = 0) 
     {
-        node->setValue(value);
+        size_t weight = weigh(node->key_, value);
+        if (weight > maxWeight_)
+        {
+            // 新值单独就超出了总预算，连同旧值一起丢弃
+            eraseNode(node);
+            return;
+        }
+
+        // 淘汰期间先把 node 摘下，它不会被选为淘汰对象：分段模式下超过保护段份额的结点留在试用段，可能正处在最旧的位置。
+        // 新值不超过总预算，剩余权重超出时链表上总还有别的结点可淘汰
+        removeNode(node);
+        totalWeight_ -= node->weight_;
+        while (totalWeight_ + weight > maxWeight_)
+            releaseNode(evictLeastRecent());
+        node->weight_ = weight;
+        totalWeight_ += weight;
+        node->value_ = std::move(value);
+        setExpiry(node, expiresAt);
         moveToMostRecent(node);
     }
 
-    void addNewNode(const Key& key, const Value& value) 
+    void addNewNode(const Key& key, Value value, uint64_t expiresAt = 0) 
     {
-       if (nodeMap_.size() >= capacity_) 
-       {
-           evictLeastRecent();
-       }
+        size_t weight = weigh(key, value);
+        if (weight > maxWeight_)
+            return; // 单个条目超过总预算，不缓存
 
-       NodePtr newNode = std::make_shared<LruNodeType>(key, value);
-       insertNode(newNode);
-       nodeMap_[key] = newNode;
+        // 淘汰到预算以内；最后一个被淘汰的结点直接复用，否则从结点池中取一个空闲结点
+        NodePtr newNode = nullptr;
+        while (totalWeight_ + weight > maxWeight_)
+        {
+            if (newNode)
+                releaseNode(newNode);
+            newNode = evictLeastRecent();
+        }
+        if (!newNode)
+            newNode = pool_.acquire();
+
+        newNode->key_ = key;
+        newNode->value_ = std::move(value);
+        newNode->accessCount_ = 1;
+        newNode->weight_ = weight;
+        totalWeight_ += weight;
+        setExpiry(newNode, expiresAt);
+        // 分段模式下新结点先进入试用段，再次访问才进入保护段
+        if (midpoint_)
+            linkBefore(midpoint_, newNode);
+        else
+            insertNode(newNode);
+        nodeMap_[key] = newNode;
+    }
+
+    void setExpiry(NodePtr node, uint64_t expiresAt)
+    {
+        if (expiresAt)
+            timers_.schedule(node, expiresAt);
+        else
+            timers_.cancel(node);
+    }
+
+    // 回收定时轮上已到期的结点，返回当前时间；定时轮为空时不读时钟，返回0（此时没有结点会过期）
+    uint64_t expireEntries()
+    {
+        if (timers_.empty())
+            return 0;
+        uint64_t now = ZPTimingWheel::now();
+        expireEntries(now);
+        return now;
+    }
+
+    void expireEntries(uint64_t now)
+    {
+        timers_.advance(now, [this](ZPTimerLink* link) { expireNode(static_cast<NodePtr>(link)); });
     }
 
-    // 将该节点移动到最新的位置
+    void expireNode(NodePtr node)
+    {
+        eraseNode(node);
+        counters_.add(ZPCacheEvent::Eviction);
+        counters_.add(ZPCacheEvent::Expiration);
+    }
+
+    // 从链表、索引和定时轮上移除结点并归还结点池
+    void eraseNode(NodePtr node)
+    {
+        removeNode(node);
+        nodeMap_.erase(node->key_);
+        totalWeight_ -= node->weight_;
+        releaseNode(node);
+    }
+
+    // 将该节点移动到最新的位置；分段模式下即进入保护段
     void moveToMostRecent(NodePtr node) 
     {
         removeNode(node);
+        if (midpoint_ && node->weight_ > protectedCapacity_)
+        {
+            linkBefore(midpoint_, node); // 单个条目就超过保护段份额，留在试用段，不把整个保护段挤出去
+            return;
+        }
         insertNode(node);
+        if (midpoint_)
+            protectNode(node);
+    }
+
+    // 保护段超出份额时，其中最久未访问的结点降回试用段的最新位置，只是越过分界结点，不改变整条链表的顺序
+    void protectNode(NodePtr node)
+    {
+        node->protected_ = true;
+        protectedWeight_ += node->weight_;
+        while (protectedWeight_ > protectedCapacity_)
+        {
+            NodePtr oldest = midpoint_->next_;
+            removeNode(oldest);
+            linkBefore(midpoint_, oldest);
+        }
     }
 
     void removeNode(NodePtr node) 
     {
-        if(!node->prev_.expired() && node->next_) 
+        if (node->protected_)
+        {
+            protectedWeight_ -= node->weight_;
+            node->protected_ = false;
+        }
+        if(node->prev_ && node->next_) 
         {
-            auto prev = node->prev_.lock(); // 使用lock()获取shared_ptr
-            prev->next_ = node->next_;
-            node->next_->prev_ = prev;
-            node->next_ = nullptr; // 清空next_指针，彻底断开节点与链表的连接
+            node->prev_->next_ = node->next_;
+            node->next_->prev_ = node->prev_;
+            node->prev_ = nullptr;
+            node->next_ = nullptr; // 清空指针，彻底断开节点与链表的连接
         }
     }
 
+    // 放到最旧的位置，加载快照时按从新到旧的顺序依次插入
+    void insertOldest(NodePtr node)
+    {
+        node->prev_ = dummyHead_;
+        node->next_ = dummyHead_->next_;
+        dummyHead_->next_->prev_ = node;
+        dummyHead_->next_ = node;
+    }
+
+    // 释放全部条目，要求已持有独占锁且读缓冲区已重放
+    void clearEntries()
+    {
+        NodePtr node = dummyHead_->next_;
+        while (node != dummyTail_)
+        {
+            NodePtr next = node->next_;
+            node->prev_ = nullptr;
+            node->next_ = nullptr;
+            if (node != midpoint_)
+                releaseNode(node);
+            node = next;
+        }
+        dummyHead_->next_ = dummyTail_;
+        dummyTail_->prev_ = dummyHead_;
+        if (midpoint_)
+            linkBefore(dummyTail_, midpoint_);
+        nodeMap_.clear();
+        timers_.clear();
+        totalWeight_ = 0;
+        protectedWeight_ = 0;
+    }
+
     // 从尾部插入结点
     void insertNode(NodePtr node) 
     {
-        node->next_ = dummyTail_;
-        node->prev_ = dummyTail_->prev_;
-        dummyTail_->prev_.lock()->next_ = node; // 使用lock()获取shared_ptr
-        dummyTail_->prev_ = node;
+        linkBefore(dummyTail_, node);
     }
 
-    // 驱逐最近最少访问
-    void evictLeastRecent() 
+    void linkBefore(NodePtr position, NodePtr node)
+    {
+        node->next_ = position;
+        node->prev_ = position->prev_;
+        position->prev_->next_ = node;
+        position->prev_ = node;
+    }
+
+    // 驱逐最近最少访问，返回已摘下的结点供调用者复用；分段模式下先淘汰试用段，试用段为空时才淘汰保护段
+    NodePtr evictLeastRecent() 
     {
         NodePtr leastRecent = dummyHead_->next_;
+        if (leastRecent == midpoint_)
+            leastRecent = midpoint_->next_;
         removeNode(leastRecent);
-        nodeMap_.erase(leastRecent->getKey());
+        nodeMap_.erase(leastRecent->key_);
+        totalWeight_ -= leastRecent->weight_;
+        timers_.cancel(leastRecent);
+        counters_.add(ZPCacheEvent::Eviction);
+        if (evictionListener_)
+            evictionListener_(leastRecent->key_, leastRecent->value_);
+        return leastRecent;
+    }
+
+    // 归还结点前释放其持有的值，避免大对象滞留在空闲结点中
+    void releaseNode(NodePtr node)
+    {
+        timers_.cancel(node);
+        node->protected_ = false;
+        node->value_ = Value();
+        pool_.release(node);
     }
 
 private:
-    int           capacity_; // 缓存容量
+    size_t        maxWeight_;       // 缓存容量：权重之和的上限，未设置weigher时即条目数
+    size_t        totalWeight_ = 0; // 当前所有条目的权重之和
+    size_t        protectedCapacity_;   // 分段模式下保护段的权重上限，0表示普通LRU
+    size_t        protectedWeight_ = 0; // 保护段当前的权重之和
+    ZPWeigher<Key, Value> weigher_; // 为空时每个条目权重为1
+    ZPEvictionListener<Key, Value> evictionListener_; // 为空时不通知
+    ZPTimingWheel timers_;          // 只挂带TTL的结点
+    LruHitMode    hitMode_;
+    ZPNodePool<LruNodeType> pool_; // 结点存储
     NodeMap       nodeMap_; // key -> Node 
-    std::mutex    mutex_;
+    LruMutex      mutex_; // Buffered模式下命中只加共享锁
+    std::unique_ptr<ReadBuffer[]> readBuffers_; // 仅Buffered模式分配
     NodePtr       dummyHead_; // 虚拟头结点
     NodePtr       dummyTail_;
+    NodePtr       midpoint_ = nullptr; // 分段模式下试用段与保护段的分界结点，链表为 头 -> 试用段 -> 分界 -> 保护段 -> 尾
+    ZPCacheCounters counters_;
+};
+
+// LRU-K 访问历史的存储方式
+enum class LruKHistoryMode
+{
+    Exact,   // 历史是一个容量为historyCapacity的LRU（key -> 次数），未准入的值另存于同容量的LRU中
+    Compact, // 历史只是定长的指纹计数表（ZPCompactHistory，每个key 4字节），不保存值，准入只能发生在put时
 };
 
 // LRU优化：Lru-k版本。 通过继承的方式进行再优化
@@ -187,142 +851,240 @@ template<typename Key, typename Value>
 class ZPLruKCache : public ZPLruCache<Key, Value>
 {
 public:
-    ZPLruKCache(int capacity, int historyCapacity, int k)
+    ZPLruKCache(int capacity, int historyCapacity, int k, LruKHistoryMode historyMode = LruKHistoryMode::Exact)
         : ZPLruCache<Key, Value>(capacity) // 调用基类构造
-        , historyList_(std::make_unique<ZPLruCache<Key, size_t>>(historyCapacity))
         , k_(k)
-    {}
-
-    Value get(Key key) 
+        , historyMode_(historyMode)
     {
-        // 首先尝试从主缓存获取数据
-        Value value{};
-        bool inMainCache = ZPLruCache<Key, Value>::get(key, value);
-
-        // 获取并更新访问历史计数
-        size_t historyCount = historyList_->get(key);
-        historyCount++;
-        historyList_->put(key, historyCount);
-
-        // 如果数据在主缓存中，直接返回
-        if (inMainCache) 
+        if (historyMode_ == LruKHistoryMode::Exact)
         {
-            return value;
+            historyList_ = std::make_unique<ZPLruCache<Key, size_t>>(historyCapacity);
+            historyValues_ = std::make_unique<ZPLruCache<Key, Value>>(historyCapacity);
         }
-
-        // 如果数据不在主缓存，但访问次数达到了k次
-        if (historyCount >= k_) 
+        else
         {
-            // 检查是否有历史值记录
-            auto it = historyValueMap_.find(key);
-            if (it != historyValueMap_.end()) 
-            {
-                // 有历史值，将其添加到主缓存
-                Value storedValue = it->second;
-                
-                // 从历史记录移除
-                historyList_->remove(key);
-                historyValueMap_.erase(it);
-                
-                // 添加到主缓存
-                ZPLruCache<Key, Value>::put(key, storedValue);
-                
-                return storedValue;
-            }
-            // 没有历史值记录，无法添加到缓存，返回默认值
+            compactHistory_ = std::make_unique<ZPCompactHistory>(historyCapacity > 0 ? historyCapacity : 0);
         }
+    }
 
-        // 数据不在主缓存且不满足添加条件，返回默认值
+    bool get(Key key, Value& value) override
+    {
+        return visit(key, [&](const Value& cached) { value = cached; });
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
         return value;
     }
 
-    void put(Key key, Value value) 
+    // 主缓存命中时不再更新访问历史；未命中时计一次访问，Exact模式下次数达到k且存有值则顺便准入
+    bool visit(const Key& key, const std::function<void(const Value&)>& visitor) override
+    {
+        if (ZPLruCache<Key, Value>::visit(key, visitor))
+            return true;
+
+        std::lock_guard<ZPMutex> lock(historyMutex_);
+        size_t historyCount = recordAccess(key);
+        if (historyCount < static_cast<size_t>(k_) || historyMode_ == LruKHistoryMode::Compact)
+            return false;
+
+        Value storedValue{};
+        if (!historyValues_->get(key, storedValue))
+            return false; // 没有历史值记录，无法添加到缓存
+
+        forgetHistory(key);
+        visitor(storedValue);
+        ZPLruCache<Key, Value>::put(key, std::move(storedValue));
+        promotions_.fetch_add(1, std::memory_order_relaxed);
+        getPromotions_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void put(Key key, Value value) override
+    {
+        putEntry(key, std::move(value), std::nullopt);
+    }
+
+    // TTL只作用于主缓存中的条目；尚在历史中的值不带TTL，之后由get准入时也不带TTL。ttl<=0 同时清掉访问历史
+    void put(Key key, Value value, std::chrono::nanoseconds ttl) override
     {
-        // 检查是否已在主缓存
-        Value existingValue{};
-        bool inMainCache = ZPLruCache<Key, Value>::get(key, existingValue);
-        
-        if (inMainCache) 
+        if (ttl.count() <= 0)
         {
-            // 已在主缓存，直接更新
-            ZPLruCache<Key, Value>::put(key, value);
+            ZPLruCache<Key, Value>::put(key, std::move(value), ttl);
+            std::lock_guard<ZPMutex> lock(historyMutex_);
+            forgetHistory(key);
             return;
         }
-        
-        // 获取并更新访问历史
-        size_t historyCount = historyList_->get(key);
-        historyCount++;
-        historyList_->put(key, historyCount);
-        
-        // 保存值到历史记录映射，供后续get操作使用
-        historyValueMap_[key] = value;
-        
-        // 检查是否达到k次访问阈值
-        if (historyCount >= k_) 
-        {
-            // 达到阈值，添加到主缓存
-            historyList_->remove(key);
-            historyValueMap_.erase(key);
-            ZPLruCache<Key, Value>::put(key, value);
-        }
+        putEntry(key, std::move(value), ttl);
     }
 
-private:
-    int                                     k_; // 进入缓存队列的评判标准
-    std::unique_ptr<ZPLruCache<Key, size_t>> historyList_; // 访问数据历史记录(value为访问次数)
-    std::unordered_map<Key, Value>          historyValueMap_; // 存储未达到k次访问的数据值
-};
+    // 未命中时历史表需要真正的Key，回到按Key查询的路径
+    bool getHashed(const ZPHashedKey<Key>& key, Value& value) override
+    {
+        return ZPCachePolicy<Key, Value>::getHashed(key, value);
+    }
 
-// lru优化：对lru进行分片，提高高并发使用的性能
-template<typename Key, typename Value>
-class ZPhashLruCaches
-{
-public:
-    ZPhashLruCaches(size_t capacity, int sliceNum)
-        : capacity_(capacity)
-        , sliceNum_(sliceNum > 0 ? sliceNum : std::thread::hardware_concurrency())
+    bool visitHashed(const ZPHashedKey<Key>& key, const std::function<void(const Value&)>& visitor) override
+    {
+        return ZPCachePolicy<Key, Value>::visitHashed(key, visitor);
+    }
+
+    // 每个key都要经过访问历史的判断，不能直接使用基类的批量读写
+    size_t getMany(std::span<const Key> keys, std::span<Value> values, std::vector<bool>& hits) override
     {
-        size_t sliceSize = std::ceil(capacity / static_cast<double>(sliceNum_)); // 获取每个分片的大小
-        for (int i = 0; i < sliceNum_; ++i)
+        return ZPCachePolicy<Key, Value>::getMany(keys, values, hits);
+    }
+
+    void putMany(std::span<const Key> keys, std::span<const Value> values) override
+    {
+        ZPCachePolicy<Key, Value>::putMany(keys, values);
+    }
+
+    ZPCacheStats stats() const override
+    {
+        ZPCacheStats snapshot = ZPLruCache<Key, Value>::stats();
+        snapshot.promotions += promotions_.load(std::memory_order_relaxed);
+        // get 从访问历史准入时返回命中，但主缓存已经记了一次未命中，准入写入也记了一次put
+        uint64_t admitted = getPromotions_.load(std::memory_order_relaxed);
+        snapshot.hits += admitted;
+        snapshot.misses -= std::min(snapshot.misses, admitted);
+        snapshot.puts -= std::min(snapshot.puts, admitted);
+        return snapshot;
+    }
+
+    // Compact模式下历史表占用的字节数，构造后不再变化；Exact模式返回0（占用随保存的值而定）
+    size_t historyMemoryUsage() const
+    {
+        return compactHistory_ ? compactHistory_->memoryUsage() : 0;
+    }
+
+    // value 是新的 k：访问历史中的计数保留，已达到新k的key在下一次访问时准入
+    bool setTuning(double value) override
+    {
+        std::lock_guard<ZPMutex> lock(historyMutex_);
+        k_ = static_cast<int>(std::clamp(std::lround(value), 1L, long(INT_MAX)));
+        return true;
+    }
+
+private:
+    void putEntry(const Key& key, Value value, std::optional<std::chrono::nanoseconds> ttl)
+    {
+        // 检查是否已在主缓存（只刷新访问顺序，不拷贝旧值）
+        if (this->touch(key))
         {
-            lruSliceCaches_.emplace_back(new ZPLruCache<Key, Value>(sliceSize)); 
+            putMain(key, std::move(value), ttl);
+            return;
+        }
+
+        std::lock_guard<ZPMutex> lock(historyMutex_);
+        size_t historyCount = recordAccess(key);
+
+        // 达到k次访问阈值，直接进入主缓存
+        if (historyCount >= static_cast<size_t>(k_))
+        {
+            forgetHistory(key);
+            putMain(key, std::move(value), ttl);
+            promotions_.fetch_add(1, std::memory_order_relaxed);
+            return;
         }
+
+        // Exact模式保存值供后续get准入，受historyCapacity限制，最久未访问的值会被挤掉
+        if (historyMode_ == LruKHistoryMode::Exact)
+            historyValues_->put(key, std::move(value));
     }
 
-    void put(Key key, Value value)
+    void putMain(const Key& key, Value value, std::optional<std::chrono::nanoseconds> ttl)
     {
-        // 获取key的hash值，并计算出对应的分片索引
-        size_t sliceIndex = Hash(key) % sliceNum_;
-        lruSliceCaches_[sliceIndex]->put(key, value);
+        if (ttl)
+            ZPLruCache<Key, Value>::put(key, std::move(value), *ttl);
+        else
+            ZPLruCache<Key, Value>::put(key, std::move(value));
     }
 
-    bool get(Key key, Value& value)
+    // 以下两个函数都要求已持有historyMutex_
+    size_t recordAccess(const Key& key)
     {
-        // 获取key的hash值，并计算出对应的分片索引
-        size_t sliceIndex = Hash(key) % sliceNum_;
-        return lruSliceCaches_[sliceIndex]->get(key, value);
+        if (compactHistory_)
+            return compactHistory_->increment(hashKey(key));
+
+        size_t historyCount = historyList_->get(key) + 1;
+        historyList_->put(key, historyCount);
+        return historyCount;
     }
 
-    Value get(Key key)
+    void forgetHistory(const Key& key)
     {
-        Value value;
-        memset(&value, 0, sizeof(value));
-        get(key, value);
-        return value;
+        if (compactHistory_)
+        {
+            compactHistory_->erase(hashKey(key));
+            return;
+        }
+        historyList_->remove(key);
+        historyValues_->remove(key);
     }
 
 private:
-    // 将key转换为对应hash值
-    size_t Hash(Key key)
+    int                                      k_; // 进入缓存队列的评判标准
+    LruKHistoryMode                          historyMode_;
+    std::unique_ptr<ZPLruCache<Key, size_t>> historyList_;    // Exact: 访问数据历史记录(value为访问次数)
+    std::unique_ptr<ZPLruCache<Key, Value>>  historyValues_;  // Exact: 存储未达到k次访问的数据值
+    std::unique_ptr<ZPCompactHistory>        compactHistory_; // Compact: 指纹计数表
+    ZPMutex                                  historyMutex_;
+    std::atomic<uint64_t>                    promotions_{0}; // 从访问历史进入主缓存的次数
+    std::atomic<uint64_t>                    getPromotions_{0}; // 其中由get准入的次数
+};
+
+// LRU优化：分段LRU（SLRU / 简化的2Q）。新条目先进入试用段，再次命中才进入保护段；保护段超出份额时最旧的结点降回试用段，
+// 淘汰总是先从试用段的最旧一端开始。一次性的顺序扫描只会冲刷试用段，保护段中的热点数据得以保留。
+// 复用 ZPLruCache 的链表、索引与锁：两段是同一条链表被一个分界结点隔开，每次操作的开销与普通LRU相当，
+// TTL、权重、Buffered命中、批量读写与快照都照常可用（快照不记录分段，加载后全部条目位于试用段）
+template<typename Key, typename Value>
+class ZPSlruCache : public ZPLruCache<Key, Value>
+{
+public:
+    // protectedRatio 是保护段占总容量的比例，常用 0.8
+    ZPSlruCache(int capacity, double protectedRatio = kDefaultProtectedRatio,
+                LruHitMode hitMode = LruHitMode::Exclusive)
+        : ZPSlruCache(std::allocator_arg, std::pmr::get_default_resource(), capacity, protectedRatio, hitMode)
+    {}
+
+    ZPSlruCache(std::allocator_arg_t, std::pmr::memory_resource* resource, int capacity,
+                double protectedRatio = kDefaultProtectedRatio, LruHitMode hitMode = LruHitMode::Exclusive)
+        : ZPLruCache<Key, Value>(capacity > 0 ? static_cast<size_t>(capacity) : 0, nullptr, hitMode, resource,
+                                 capacity > 0 ? static_cast<size_t>(capacity) : 0,
+                                 protectedShare(capacity > 0 ? static_cast<size_t>(capacity) : 0, protectedRatio))
+    {}
+
+    // 按权重计容量：保护段的份额同样以权重计
+    ZPSlruCache(size_t maxWeight, ZPWeigher<Key, Value> weigher, double protectedRatio = kDefaultProtectedRatio,
+                LruHitMode hitMode = LruHitMode::Exclusive)
+        : ZPLruCache<Key, Value>(maxWeight, std::move(weigher), hitMode, std::pmr::get_default_resource(),
+                                 ZPLruCache<Key, Value>::kWeightedReserve, protectedShare(maxWeight, protectedRatio))
+    {}
+
+    // value 是新的保护段比例（0~1）：越大越偏向反复访问的key，越小越偏向近期写入的key
+    bool setTuning(double value) override
     {
-        std::hash<Key> hashFunc;
-        return hashFunc(key);
+        return this->setProtectedCapacity(protectedShare(this->maxWeight(), value));
     }
 
 private:
-    size_t                                              capacity_;  // 总容量
-    int                                                 sliceNum_;  // 切片数量
-    std::vector<std::unique_ptr<ZPLruCache<Key, Value>>> lruSliceCaches_; // 切片LRU缓存
+    static constexpr double kDefaultProtectedRatio = 0.8;
+
+    // 保护段至少占1，至多给试用段留下1；容量不足2时退化为普通LRU
+    static size_t protectedShare(size_t capacity, double ratio)
+    {
+        if (capacity < 2)
+            return 0;
+        size_t share = static_cast<size_t>(static_cast<double>(capacity) * std::clamp(ratio, 0.0, 1.0));
+        return std::clamp<size_t>(share, 1, capacity - 1);
+    }
 };
 
+// lru优化：对lru进行分片，提高高并发使用的性能（通用实现见 ZPShardedCache）
+template<typename Key, typename Value>
+using ZPhashLruCaches = ZPShardedCache<Key, Value, ZPLruCache<Key, Value>>;
+
 } // namespace ZPCache
\ No newline at end of file
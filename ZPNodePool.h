@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace ZPCache
+{
+
+// 定长结点池：按缓存容量一次性预分配一整块slab，结点之间用裸指针串联。
+// 被淘汰/删除的结点回到空闲栈，之后的插入直接复用，稳态下不再调用分配器。
+// 预分配的slab用完时（例如ARC自适应扩容）才会追加新的slab，已分配的内存直到池析构才归还。
+// slab与空闲栈都从 resource 分配，默认是全局堆；分片缓存给每个分片一个独立的池化 resource
+template<typename Node>
+class ZPNodePool
+{
+public:
+    explicit ZPNodePool(size_t reserveCount, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : slabSize_(reserveCount > 0 ? reserveCount : kMinSlabSize)
+        , resource_(resource)
+        , slabs_(resource)
+        , freeNodes_(resource)
+    {
+        if (reserveCount > 0)
+            addSlab(reserveCount);
+    }
+
+    ~ZPNodePool()
+    {
+        for (Slab& slab : slabs_)
+        {
+            std::destroy_n(slab.nodes, slab.count);
+            resource_->deallocate(slab.nodes, slab.count * sizeof(Node), alignof(Node));
+        }
+    }
+
+    ZPNodePool(const ZPNodePool&) = delete;
+    ZPNodePool& operator=(const ZPNodePool&) = delete;
+
+    // 取出一个空闲结点，结点中可能残留上一次使用时的数据，由调用者负责覆盖
+    Node* acquire()
+    {
+        if (freeNodes_.empty())
+            addSlab(slabSize_);
+
+        Node* node = freeNodes_.back();
+        freeNodes_.pop_back();
+        return node;
+    }
+
+    // 归还结点，空闲栈的容量在addSlab时已预留，这里不会触发分配
+    void release(Node* node)
+    {
+        freeNodes_.push_back(node);
+    }
+
+    // 保证之后至少还能取出count个结点而不再追加slab，批量加载前一次性补足
+    void reserve(size_t count)
+    {
+        if (freeNodes_.size() < count)
+            addSlab(count - freeNodes_.size());
+    }
+
+    size_t capacity() const { return totalNodes_; }
+    size_t freeCount() const { return freeNodes_.size(); }
+
+private:
+    struct Slab
+    {
+        Node*  nodes;
+        size_t count;
+    };
+
+    void addSlab(size_t count)
+    {
+        Node* slab = static_cast<Node*>(resource_->allocate(count * sizeof(Node), alignof(Node)));
+        std::uninitialized_value_construct_n(slab, count);
+        slabs_.push_back({slab, count});
+        totalNodes_ += count;
+        freeNodes_.reserve(totalNodes_);
+
+        // 逆序压栈，使得acquire按slab内的地址顺序取出结点
+        for (size_t i = count; i > 0; --i)
+            freeNodes_.push_back(&slab[i - 1]);
+    }
+
+private:
+    static constexpr size_t kMinSlabSize = 16;
+
+    size_t                     slabSize_;       // 追加slab时的大小
+    size_t                     totalNodes_ = 0; // 所有slab中的结点总数
+    std::pmr::memory_resource* resource_;
+    std::pmr::vector<Slab>     slabs_;
+    std::pmr::vector<Node*>    freeNodes_;      // 空闲结点栈
+};
+
+} // namespace ZPCache
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ZPCachePolicy.h"
+#include "ZPHash.h"
+#include "ZPSnapshot.h"
+
+namespace ZPCache
+{
+
+// 通用分片缓存：key按哈希路由到某个分片，每个分片是一个独立加锁的缓存策略实例（LRU、LRU-K、LFU、ARC均可）。
+// 分片数向上取整为2的幂，用掩码代替取模；std::hash<int>等恒等哈希先经mixHash打散，避免连续key聚集到同一分片。
+template<typename Key, typename Value, typename Shard>
+class ZPShardedCache : public ZPCachePolicy<Key, Value>
+{
+public:
+    // shardArgs 是容量之后的其余构造参数，原样传给每个分片，例如 LRU-K 的 (historyCapacity, k)
+    template<typename... ShardArgs>
+    ZPShardedCache(size_t capacity, int shardNum, const ShardArgs&... shardArgs)
+        : capacity_(0)
+        , shardNum_(roundUpPowerOfTwo(shardNum > 0 ? shardNum : std::thread::hardware_concurrency()))
+        , shardMask_(shardNum_ - 1)
+    {
+        // 余数分给前几个分片，各分片容量之和恰好等于总容量；总容量小于分片数时每个分片至少1
+        shards_.reserve(shardNum_);
+        for (size_t i = 0; i < shardNum_; ++i)
+        {
+            size_t shardCapacity = capacity / shardNum_ + (i < capacity % shardNum_ ? 1 : 0);
+            if (capacity > 0)
+                shardCapacity = std::max<size_t>(shardCapacity, 1);
+            capacity_ += shardCapacity;
+            shards_.emplace_back(std::make_unique<PaddedShard>(shardCapacity, shardArgs...));
+        }
+    }
+
+    ~ZPShardedCache() override = default;
+
+    void put(Key key, Value value) override
+    {
+        shardFor(key).put(key, std::move(value));
+    }
+
+    void put(Key key, Value value, std::chrono::nanoseconds ttl) override
+    {
+        shardFor(key).put(key, std::move(value), ttl);
+    }
+
+    std::optional<std::chrono::nanoseconds> timeToLive(const Key& key) override
+    {
+        return shardFor(key).timeToLive(key);
+    }
+
+    bool get(Key key, Value& value) override
+    {
+        return shardFor(key).get(key, value);
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    bool visit(const Key& key, const std::function<void(const Value&)>& visitor) override
+    {
+        return shardFor(key).visit(key, visitor);
+    }
+
+    // 分片路由用哈希的高位，分片内的索引用同一个哈希，整个查询只算一次哈希
+    bool getHashed(const ZPHashedKey<Key>& key, Value& value) override
+    {
+        return policyAt(shardIndexOf(key.hash)).getHashed(key, value);
+    }
+
+    bool visitHashed(const ZPHashedKey<Key>& key, const std::function<void(const Value&)>& visitor) override
+    {
+        return policyAt(shardIndexOf(key.hash)).visitHashed(key, visitor);
+    }
+
+    // 先按分片分组，每个分片只调用一次其批量接口（只加一次锁）
+    size_t getMany(std::span<const Key> keys, std::span<Value> values, std::vector<bool>& hits) override
+    {
+        hits.assign(keys.size(), false);
+        std::vector<size_t> order, offsets;
+        groupByShard(keys, order, offsets);
+
+        size_t hitCount = 0;
+        std::vector<Key> shardKeys;
+        std::vector<Value> shardValues;
+        std::vector<bool> shardHits;
+        for (size_t s = 0; s < shardNum_; ++s)
+        {
+            size_t begin = offsets[s], end = offsets[s + 1];
+            if (begin == end)
+                continue;
+
+            shardKeys.clear();
+            for (size_t j = begin; j < end; ++j)
+                shardKeys.push_back(keys[order[j]]);
+            shardValues.resize(end - begin);
+
+            hitCount += policyAt(s).getMany(shardKeys, shardValues, shardHits);
+            for (size_t j = begin; j < end; ++j)
+            {
+                if (shardHits[j - begin])
+                {
+                    values[order[j]] = std::move(shardValues[j - begin]);
+                    hits[order[j]] = true;
+                }
+            }
+        }
+        return hitCount;
+    }
+
+    void putMany(std::span<const Key> keys, std::span<const Value> values) override
+    {
+        std::vector<size_t> order, offsets;
+        groupByShard(keys, order, offsets);
+
+        std::vector<Key> shardKeys;
+        std::vector<Value> shardValues;
+        for (size_t s = 0; s < shardNum_; ++s)
+        {
+            size_t begin = offsets[s], end = offsets[s + 1];
+            if (begin == end)
+                continue;
+
+            shardKeys.clear();
+            shardValues.clear();
+            for (size_t j = begin; j < end; ++j)
+            {
+                shardKeys.push_back(keys[order[j]]);
+                shardValues.push_back(values[order[j]]);
+            }
+            policyAt(s).putMany(shardKeys, shardValues);
+        }
+    }
+
+    // 各分片的计数相加，延迟直方图按桶合并
+    ZPCacheStats stats() const override
+    {
+        ZPCacheStats snapshot;
+        for (const auto& shard : shards_)
+            snapshot += static_cast<const ZPCachePolicy<Key, Value>&>(shard->cache).stats();
+        return snapshot;
+    }
+
+    void enableLatencySampling(uint32_t sampleEvery) override
+    {
+        for (size_t s = 0; s < shardNum_; ++s)
+            policyAt(s).enableLatencySampling(sampleEvery);
+    }
+
+    // 每个分片各自在自己的锁内调用 listener，不同分片的回调可能并发执行
+    bool setEvictionListener(ZPEvictionListener<Key, Value> listener) override
+    {
+        bool supported = true;
+        for (size_t s = 0; s < shardNum_; ++s)
+            supported = policyAt(s).setEvictionListener(listener) && supported;
+        return supported;
+    }
+
+    // 所有分片使用同一组参数
+    bool setTuning(double value) override
+    {
+        bool supported = true;
+        for (size_t s = 0; s < shardNum_; ++s)
+            supported = policyAt(s).setTuning(value) && supported;
+        return supported;
+    }
+
+    // 所有分片依次写入同一个文件，每个分片在自己的锁内保持一致，分片之间不是同一时刻的快照。
+    // 分片类型需要提供 writeSnapshot/readSnapshot（LRU、LFU、ARC）
+    bool saveSnapshot(const std::string& path)
+    {
+        ZPSnapshotWriter out(path);
+        out.writeHeader(ZPSnapshotKind::Sharded, sizeof(Key), sizeof(Value));
+        out.write(static_cast<uint64_t>(shardNum_));
+        for (auto& shard : shards_)
+            shard->cache.writeSnapshot(out);
+        return out.commit();
+    }
+
+    // 分片数必须与保存时相同，key才能原样落回各自的分片；中途失败时之前的分片保留已加载的内容
+    bool loadSnapshot(const std::string& path)
+    {
+        ZPSnapshotReader in(path);
+        uint64_t shardNum = 0;
+        if (!in.readHeader(ZPSnapshotKind::Sharded, sizeof(Key), sizeof(Value)) || !in.read(shardNum) ||
+            shardNum != shardNum_)
+            return false;
+        for (auto& shard : shards_)
+        {
+            if (!shard->cache.readSnapshot(in))
+                return false;
+        }
+        return true;
+    }
+
+    size_t shardCount() const { return shardNum_; }
+    // 各分片容量之和
+    size_t capacity() const { return capacity_; }
+    Shard& shard(size_t index) { return shards_[index]->cache; }
+
+private:
+    static constexpr size_t kCacheLineSize = 64;
+
+    // 每个分片独占整数个缓存行，分片各自的互斥锁之间不会发生伪共享。
+    // 分片类型支持 (std::allocator_arg, resource, capacity, ...) 构造时（LRU、LFU、ARC），结点池与索引从分片自己的池化 resource 分配：
+    // 分片只在持有自己的独占锁时分配内存，所以用不加锁的 unsynchronized_pool_resource，分片之间也不共享堆上的空闲链表
+    struct alignas(kCacheLineSize) PaddedShard
+    {
+        template<typename... Args>
+        explicit PaddedShard(size_t capacity, const Args&... args) : cache(makeShard(resource, capacity, args...)) {}
+
+        std::pmr::unsynchronized_pool_resource resource; // 必须先于 cache 构造、后于 cache 析构
+        Shard                                  cache;
+    };
+
+    template<typename... Args>
+    static Shard makeShard(std::pmr::memory_resource& resource, size_t capacity, const Args&... args)
+    {
+        if constexpr (std::is_constructible_v<Shard, std::allocator_arg_t, std::pmr::memory_resource*, size_t, const Args&...>)
+            return Shard(std::allocator_arg, &resource, capacity, args...);
+        else
+            return Shard(capacity, args...);
+    }
+
+    static size_t roundUpPowerOfTwo(size_t n)
+    {
+        size_t power = 1;
+        while (power < n)
+            power <<= 1;
+        return power;
+    }
+
+    // 分片取混合后哈希的高半部分，和分片内部索引使用的低位错开
+    size_t shardIndex(const Key& key) const
+    {
+        return shardIndexOf(hashKey(key));
+    }
+
+    size_t shardIndexOf(size_t hash) const
+    {
+        return (hash >> (sizeof(size_t) * 4)) & shardMask_;
+    }
+
+    // 经由ZPCachePolicy接口访问分片，与直接持有该策略对象的调用方行为一致
+    ZPCachePolicy<Key, Value>& shardFor(const Key& key)
+    {
+        return shards_[shardIndex(key)]->cache;
+    }
+
+    ZPCachePolicy<Key, Value>& policyAt(size_t index)
+    {
+        return shards_[index]->cache;
+    }
+
+    // 计数排序：order按分片顺序列出keys的下标，分片s对应order[offsets[s], offsets[s + 1])
+    void groupByShard(std::span<const Key> keys, std::vector<size_t>& order, std::vector<size_t>& offsets) const
+    {
+        std::vector<size_t> shardOf(keys.size());
+        offsets.assign(shardNum_ + 1, 0);
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            shardOf[i] = shardIndex(keys[i]);
+            ++offsets[shardOf[i] + 1];
+        }
+        for (size_t s = 0; s < shardNum_; ++s)
+            offsets[s + 1] += offsets[s];
+
+        std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+        order.resize(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i)
+            order[cursor[shardOf[i]]++] = i;
+    }
+
+private:
+    size_t                                     capacity_;  // 各分片容量之和
+    size_t                                     shardNum_;  // 分片数量（2的幂）
+    size_t                                     shardMask_;
+    std::vector<std::unique_ptr<PaddedShard>>  shards_;
+};
+
+} // namespace ZPCache
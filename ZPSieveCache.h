@@ -0,0 +1,300 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+#include "ZPCachePolicy.h"
+#include "ZPFlatHashMap.h"
+#include "ZPHash.h"
+#include "ZPLockProfiling.h"
+
+namespace ZPCache
+{
+
+// SIEVE：按插入顺序排成一个队列，新key总是进入队头；命中只把 visited 位置1，不移动任何东西。
+// 淘汰时指针从队尾向队头扫：visited 的清零后跳过，遇到第一个未访问的即淘汰，指针停在该处下次继续；走到队头后绕回队尾。
+// 元数据全部是平坦数组而不是链表：
+//   - keys_/values_ 按槽位存放条目，槽位一经分配不再移动；
+//   - ring_ 是按插入顺序排列的槽位号，下标越大越新，淘汰留下的空洞由 occupied_ 位图标记；
+//   - visited_ 与 occupied_ 按 ring_ 的下标对齐，淘汰指针一次检查一个64位字（64个位置），用 ctz 找到下一个候选。
+// ring_ 的长度是容量的两倍，写到末尾时把存活条目按原顺序压实到开头，每次压实之后至少还能插入 capacity 次，均摊O(1)。
+// 命中只是一次原子或操作，所以 get 只加共享锁，读可以并行；put 与淘汰加独占锁
+template<typename Key, typename Value>
+class ZPSieveCache : public ZPCachePolicy<Key, Value>
+{
+public:
+    using IndexMap = ZPFlatHashMap<Key, uint32_t>; // key -> 槽位
+
+    explicit ZPSieveCache(size_t capacity)
+        : capacity_(capacity)
+        , ringSize_(ringSizeFor(capacity))
+        , keys_(capacity)
+        , values_(capacity)
+        , slotPos_(capacity)
+        , ring_(ringSize_)
+        , occupied_(ringSize_ / kWordBits)
+        , visited_(std::make_unique<std::atomic<uint64_t>[]>(ringSize_ / kWordBits))
+        , index_(capacity)
+    {
+        freeSlots_.reserve(capacity);
+        for (size_t slot = capacity; slot > 0; --slot)
+            freeSlots_.push_back(static_cast<uint32_t>(slot - 1));
+    }
+
+    ~ZPSieveCache() override = default;
+
+    void put(Key key, Value value) override
+    {
+        if (capacity_ == 0)
+            return;
+
+        auto latency = counters_.timePut();
+        std::lock_guard<ZPSharedMutex> lock(mutex_);
+        counters_.add(ZPCacheEvent::Put);
+        auto it = index_.find(key);
+        if (it != index_.end())
+        {
+            // 覆盖已有的key同样算一次访问
+            values_[it->second] = std::move(value);
+            markVisited(slotPos_[it->second]);
+            return;
+        }
+        insert(key, std::move(value));
+    }
+
+    bool get(Key key, Value& value) override
+    {
+        return lookup(key, index_.hashOf(key), [&](const Value& cached) { value = cached; });
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    // 命中时在共享锁内把值的引用交给visitor；visitor中不能再访问本缓存
+    bool visit(const Key& key, const std::function<void(const Value&)>& visitor) override
+    {
+        return lookup(key, index_.hashOf(key), visitor);
+    }
+
+    bool getHashed(const ZPHashedKey<Key>& key, Value& value) override
+    {
+        return lookup(key.key, key.hash, [&](const Value& cached) { value = cached; });
+    }
+
+    bool visitHashed(const ZPHashedKey<Key>& key, const std::function<void(const Value&)>& visitor) override
+    {
+        return lookup(key.key, key.hash, visitor);
+    }
+
+    void remove(const Key& key)
+    {
+        std::lock_guard<ZPSharedMutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end())
+            return;
+        uint32_t slot = it->second;
+        index_.erase(it);
+        erasePosition(slotPos_[slot]);
+        releaseSlot(slot);
+        settleHand();
+    }
+
+    size_t size()
+    {
+        std::shared_lock<ZPSharedMutex> lock(mutex_);
+        return index_.size();
+    }
+
+    ZPCacheStats stats() const override
+    {
+        ZPCacheStats snapshot;
+        counters_.fill(snapshot);
+        return snapshot;
+    }
+
+    void enableLatencySampling(uint32_t sampleEvery) override { counters_.enableLatencySampling(sampleEvery); }
+
+private:
+    static constexpr size_t kWordBits = 64;
+
+    static size_t ringSizeFor(size_t capacity)
+    {
+        size_t size = capacity * 2;
+        return (size + kWordBits - 1) / kWordBits * kWordBits + kWordBits;
+    }
+
+    static uint64_t bit(size_t pos) { return uint64_t(1) << (pos % kWordBits); }
+
+    // 从 pos 所在位（含）到字末尾的掩码
+    static uint64_t fromBit(size_t pos) { return ~uint64_t(0) << (pos % kWordBits); }
+
+    template<typename Lookup, typename Fn>
+    bool lookup(const Lookup& key, size_t hash, Fn&& fn)
+    {
+        auto latency = counters_.timeGet();
+        std::shared_lock<ZPSharedMutex> lock(mutex_);
+        auto it = index_.find(key, hash);
+        if (it == index_.end())
+        {
+            counters_.add(ZPCacheEvent::Miss);
+            return false;
+        }
+        markVisited(slotPos_[it->second]);
+        fn(values_[it->second]);
+        counters_.add(ZPCacheEvent::Hit);
+        return true;
+    }
+
+    // 已经置位时只读不写，热点key的缓存行不会在读线程之间来回失效
+    void markVisited(size_t pos)
+    {
+        std::atomic<uint64_t>& word = visited_[pos / kWordBits];
+        uint64_t mask = bit(pos);
+        if (!(word.load(std::memory_order_relaxed) & mask))
+            word.fetch_or(mask, std::memory_order_relaxed);
+    }
+
+    void insert(const Key& key, Value value)
+    {
+        uint32_t slot;
+        if (freeSlots_.empty())
+        {
+            size_t victimPos = evict();
+            slot = ring_[victimPos];
+            index_.erase(keys_[slot]);
+            erasePosition(victimPos);
+            settleHand();
+            counters_.add(ZPCacheEvent::Eviction);
+        }
+        else
+        {
+            slot = freeSlots_.back();
+            freeSlots_.pop_back();
+        }
+
+        if (head_ == ringSize_)
+            compact();
+        size_t pos = head_++;
+        ring_[pos] = slot;
+        slotPos_[slot] = static_cast<uint32_t>(pos);
+        occupied_[pos / kWordBits] |= bit(pos);
+        keys_[slot] = key;
+        values_[slot] = std::move(value);
+        index_.try_emplace(key, slot);
+    }
+
+    // 返回被淘汰条目在 ring_ 中的位置。扫过的 visited 位整字清零（空位的 visited 恒为0，清零不影响它们）
+    size_t evict()
+    {
+        size_t pos = hand_;
+        for (;;)
+        {
+            if (pos >= head_)
+                pos = 0;
+            size_t word = pos / kWordBits;
+            uint64_t visited = visited_[word].load(std::memory_order_relaxed);
+            uint64_t candidates = occupied_[word] & ~visited & fromBit(pos);
+            if (candidates)
+            {
+                size_t victim = word * kWordBits + static_cast<size_t>(__builtin_ctzll(candidates));
+                visited_[word].store(visited & ~(fromBit(pos) & ~fromBit(victim)), std::memory_order_relaxed);
+                hand_ = victim + 1;
+                return victim;
+            }
+            visited_[word].store(visited & ~fromBit(pos), std::memory_order_relaxed);
+            pos = (word + 1) * kWordBits;
+        }
+    }
+
+    // 把淘汰指针挪到它之后第一个存活的位置；之后已没有存活条目时绕回队尾，
+    // 否则之后新插入的条目会先于老条目被扫到
+    void settleHand()
+    {
+        for (size_t pos = hand_; pos < head_; pos = (pos / kWordBits + 1) * kWordBits)
+        {
+            size_t word = pos / kWordBits;
+            if (uint64_t bits = occupied_[word] & fromBit(pos))
+            {
+                size_t live = word * kWordBits + static_cast<size_t>(__builtin_ctzll(bits));
+                hand_ = live < head_ ? live : 0;
+                return;
+            }
+        }
+        hand_ = 0;
+    }
+
+    void erasePosition(size_t pos)
+    {
+        occupied_[pos / kWordBits] &= ~bit(pos);
+        visited_[pos / kWordBits].fetch_and(~bit(pos), std::memory_order_relaxed);
+    }
+
+    void releaseSlot(uint32_t slot)
+    {
+        values_[slot] = Value{};
+        freeSlots_.push_back(slot);
+    }
+
+    // 把存活条目按原顺序挪到 ring_ 开头，visited 位随之移动，淘汰指针映射到压实后的位置
+    void compact()
+    {
+        size_t next = 0;
+        size_t newHand = 0;
+        std::vector<uint64_t> visited(ringSize_ / kWordBits, 0);
+        for (size_t word = 0; word < occupied_.size(); ++word)
+        {
+            uint64_t bits = occupied_[word];
+            uint64_t visitedBits = visited_[word].load(std::memory_order_relaxed);
+            while (bits)
+            {
+                size_t pos = word * kWordBits + static_cast<size_t>(__builtin_ctzll(bits));
+                bits &= bits - 1;
+                if (pos < hand_)
+                    newHand = next + 1;
+                uint32_t slot = ring_[pos];
+                ring_[next] = slot;
+                slotPos_[slot] = static_cast<uint32_t>(next);
+                if (visitedBits & bit(pos))
+                    visited[next / kWordBits] |= bit(next);
+                ++next;
+            }
+        }
+
+        std::fill(occupied_.begin(), occupied_.end(), 0);
+        for (size_t pos = 0; pos < next; ++pos)
+            occupied_[pos / kWordBits] |= bit(pos);
+        for (size_t word = 0; word < visited.size(); ++word)
+            visited_[word].store(visited[word], std::memory_order_relaxed);
+        head_ = next;
+        hand_ = newHand < next ? newHand : 0;
+    }
+
+private:
+    size_t                                   capacity_;
+    size_t                                   ringSize_;
+    std::vector<Key>                         keys_;      // 槽位 -> key
+    std::vector<Value>                       values_;    // 槽位 -> value
+    std::vector<uint32_t>                    slotPos_;   // 槽位 -> 在 ring_ 中的位置
+    std::vector<uint32_t>                    ring_;      // 位置 -> 槽位，按插入顺序
+    std::vector<uint64_t>                    occupied_;  // ring_ 中哪些位置存有条目
+    std::unique_ptr<std::atomic<uint64_t>[]> visited_;   // 与 occupied_ 对齐，读线程在共享锁下置位
+    std::vector<uint32_t>                    freeSlots_;
+    IndexMap                                 index_;
+    size_t                                   head_ = 0;  // 下一个插入位置
+    size_t                                   hand_ = 0;  // 淘汰指针
+    ZPSharedMutex                            mutex_;
+    ZPCacheCounters                          counters_;
+};
+
+} // namespace ZPCache
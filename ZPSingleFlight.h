@@ -0,0 +1,74 @@
+#pragma once
+
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "ZPLockProfiling.h"
+
+namespace ZPCache
+{
+
+// 同一个key同一时刻只允许一次加载：第一个加入的调用者成为加载者，之后加入的调用者拿到同一个 shared_future 等待结果。
+// 表中只有正在加载的key，加载结束即删除，通常只有寥寥几项，所以直接用 std::unordered_map，不必预留容量
+template<typename Key, typename Value>
+class ZPSingleFlight
+{
+public:
+    struct Flight
+    {
+        std::shared_future<Value>           future;
+        std::shared_ptr<std::promise<Value>> promise; // 只有加载者持有，非空即表示由本次调用负责加载
+
+        bool leader() const { return promise != nullptr; }
+    };
+
+    Flight join(const Key& key)
+    {
+        std::lock_guard<ZPMutex> lock(mutex_);
+        auto it = flights_.find(key);
+        if (it != flights_.end())
+            return {it->second, nullptr};
+
+        auto promise = std::make_shared<std::promise<Value>>();
+        std::shared_future<Value> future = promise->get_future().share();
+        flights_.emplace(key, future);
+        return {std::move(future), std::move(promise)};
+    }
+
+    // 加载者在结果写入缓存之后调用：先从表中删除再唤醒等待者，之后到来的调用者会直接命中缓存
+    void complete(const Key& key, Flight& flight, const Value& value)
+    {
+        finish(key);
+        flight.promise->set_value(value);
+    }
+
+    // 加载失败：所有等待者从 future.get() 收到同一个异常，下一次调用会重新加载
+    void fail(const Key& key, Flight& flight, std::exception_ptr error)
+    {
+        finish(key);
+        flight.promise->set_exception(std::move(error));
+    }
+
+    bool inFlight(const Key& key)
+    {
+        std::lock_guard<ZPMutex> lock(mutex_);
+        return flights_.count(key) != 0;
+    }
+
+private:
+    void finish(const Key& key)
+    {
+        std::lock_guard<ZPMutex> lock(mutex_);
+        flights_.erase(key);
+    }
+
+private:
+    ZPMutex                                            mutex_;
+    std::unordered_map<Key, std::shared_future<Value>> flights_;
+};
+
+} // namespace ZPCache
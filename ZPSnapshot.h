@@ -0,0 +1,349 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ZPCACHE_SNAPSHOT_MMAP 1
+#endif
+
+#include "ZPTimingWheel.h"
+
+namespace ZPCache
+{
+
+class ZPSnapshotWriter;
+class ZPSnapshotReader;
+
+// 快照中键和值的编解码。可平凡复制的类型按字节原样写入，std::string 写长度加内容；
+// 其他类型需要特化 ZPSnapshotCodec<T>，提供 encode(ZPSnapshotWriter&, const T&) 与 decode(ZPSnapshotReader&, T&)
+template<typename T>
+struct ZPSnapshotCodec;
+
+template<typename T>
+    requires std::is_trivially_copyable_v<T>
+struct ZPSnapshotCodec<T>
+{
+    static void encode(ZPSnapshotWriter& out, const T& value);
+    static bool decode(ZPSnapshotReader& in, T& value);
+};
+
+template<>
+struct ZPSnapshotCodec<std::string>
+{
+    static void encode(ZPSnapshotWriter& out, const std::string& value);
+    static bool decode(ZPSnapshotReader& in, std::string& value);
+};
+
+enum class ZPSnapshotKind : uint32_t
+{
+    Lru = 1,
+    Lfu = 2,
+    Arc = 3,
+    Sharded = 4,
+};
+
+// 快照文件以小段头开始：魔数、版本、策略类型、键值类型的大小（粗略防止用错类型加载），以及保存时的墙钟时间。
+// 之后是各策略按自己的顺序写出的记录，加载时按同样的顺序直接建立链表与索引，不经过put
+struct ZPSnapshotHeader
+{
+    static constexpr uint32_t kMagic = 0x5343505a; // "ZPCS"
+    static constexpr uint32_t kVersion = 2; // 2：ARC 的幽灵表只写key的哈希
+
+    uint32_t magic = kMagic;
+    uint32_t version = kVersion;
+    uint32_t kind = 0;
+    uint32_t keySize = 0;
+    uint32_t valueSize = 0;
+    uint32_t reserved = 0;
+    uint64_t savedAt = 0; // system_clock 纳秒，加载时扣除停机期间流逝的TTL
+};
+
+inline uint64_t snapshotWallClock()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::system_clock::now().time_since_epoch())
+                                     .count());
+}
+
+// 先写入 path.tmp，commit 时刷盘并改名，中途失败不会破坏已有的快照
+class ZPSnapshotWriter
+{
+public:
+    static constexpr size_t kBufferSize = size_t(1) << 20;
+
+    explicit ZPSnapshotWriter(std::string path)
+        : path_(std::move(path))
+        , tmpPath_(path_ + ".tmp")
+        , file_(std::fopen(tmpPath_.c_str(), "wb"))
+    {
+        buffer_.reserve(kBufferSize);
+    }
+
+    // 编码到内存：直接追加到 sink，不创建文件，也不需要 commit（文件层用它把记录序列化进写缓冲）
+    explicit ZPSnapshotWriter(std::vector<char>& sink)
+        : file_(nullptr)
+        , sink_(&sink)
+    {}
+
+    ~ZPSnapshotWriter()
+    {
+        if (file_)
+        {
+            std::fclose(file_);
+            std::remove(tmpPath_.c_str());
+        }
+    }
+
+    ZPSnapshotWriter(const ZPSnapshotWriter&) = delete;
+    ZPSnapshotWriter& operator=(const ZPSnapshotWriter&) = delete;
+
+    bool ok() const { return sink_ || (file_ && !failed_); }
+
+    void writeBytes(const void* data, size_t size)
+    {
+        const char* bytes = static_cast<const char*>(data);
+        if (sink_)
+        {
+            sink_->insert(sink_->end(), bytes, bytes + size);
+            return;
+        }
+        if (buffer_.size() + size > kBufferSize)
+            flushBuffer();
+        if (size >= kBufferSize)
+        {
+            writeFile(data, size);
+            return;
+        }
+        buffer_.insert(buffer_.end(), bytes, bytes + size);
+    }
+
+    template<typename T>
+    void write(const T& value)
+    {
+        ZPSnapshotCodec<T>::encode(*this, value);
+    }
+
+    void writeHeader(ZPSnapshotKind kind, size_t keySize, size_t valueSize)
+    {
+        ZPSnapshotHeader header;
+        header.kind = static_cast<uint32_t>(kind);
+        header.keySize = static_cast<uint32_t>(keySize);
+        header.valueSize = static_cast<uint32_t>(valueSize);
+        header.savedAt = snapshotWallClock();
+        write(header);
+    }
+
+    // 把结点的到期时间换成剩余时间写出：0表示不过期，已到期的写1，加载后立即过期
+    void writeTtl(uint64_t expiresAt, uint64_t now)
+    {
+        uint64_t remaining = 0;
+        if (expiresAt)
+            remaining = std::max<uint64_t>(static_cast<uint64_t>(ZPTimingWheel::remaining(expiresAt, now).count()), 1);
+        write(remaining);
+    }
+
+    bool commit()
+    {
+        if (!file_)
+            return false;
+        flushBuffer();
+        bool success = !failed_ && std::fflush(file_) == 0;
+#ifdef ZPCACHE_SNAPSHOT_MMAP
+        success = success && ::fsync(::fileno(file_)) == 0;
+#endif
+        success = std::fclose(file_) == 0 && success;
+        file_ = nullptr;
+        if (success)
+            success = std::rename(tmpPath_.c_str(), path_.c_str()) == 0;
+        if (!success)
+            std::remove(tmpPath_.c_str());
+        return success;
+    }
+
+private:
+    void flushBuffer()
+    {
+        if (!buffer_.empty())
+            writeFile(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+
+    void writeFile(const void* data, size_t size)
+    {
+        if (ok() && std::fwrite(data, 1, size, file_) != size)
+            failed_ = true;
+    }
+
+private:
+    std::string       path_;
+    std::string       tmpPath_;
+    std::FILE*        file_;
+    std::vector<char>* sink_ = nullptr;
+    std::vector<char> buffer_;
+    bool              failed_ = false;
+};
+
+// 只读映射整个快照文件，记录直接从映射的页中解码；不支持mmap的平台退化为一次读入内存。
+// 所有读取都做越界检查，文件截断或损坏时返回false，不会读出界
+class ZPSnapshotReader
+{
+public:
+    explicit ZPSnapshotReader(const std::string& path)
+    {
+#ifdef ZPCACHE_SNAPSHOT_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void* mapped = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED)
+            {
+                ::madvise(mapped, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+                data_ = static_cast<const char*>(mapped);
+                size_ = static_cast<size_t>(st.st_size);
+                mapped_ = true;
+            }
+        }
+        ::close(fd);
+#else
+        if (std::FILE* file = std::fopen(path.c_str(), "rb"))
+        {
+            char chunk[1 << 16];
+            size_t n;
+            while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+                fallback_.insert(fallback_.end(), chunk, chunk + n);
+            std::fclose(file);
+            data_ = fallback_.data();
+            size_ = fallback_.size();
+        }
+#endif
+    }
+
+    // 解码调用者持有的一段内存，不复制；data 须在读取期间保持有效
+    ZPSnapshotReader(const char* data, size_t size)
+        : data_(data)
+        , size_(size)
+    {}
+
+    ~ZPSnapshotReader()
+    {
+#ifdef ZPCACHE_SNAPSHOT_MMAP
+        if (mapped_)
+            ::munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    ZPSnapshotReader(const ZPSnapshotReader&) = delete;
+    ZPSnapshotReader& operator=(const ZPSnapshotReader&) = delete;
+
+    bool ok() const { return data_ != nullptr; }
+    size_t remaining() const { return size_ - offset_; }
+
+    bool readBytes(void* data, size_t size)
+    {
+        const char* bytes = view(size);
+        if (!bytes)
+            return false;
+        std::memcpy(data, bytes, size);
+        return true;
+    }
+
+    // 直接返回映射内存中的size个字节并前移，越界返回nullptr
+    const char* view(size_t size)
+    {
+        if (!data_ || size > remaining())
+            return nullptr;
+        const char* bytes = data_ + offset_;
+        offset_ += size;
+        return bytes;
+    }
+
+    template<typename T>
+    bool read(T& value)
+    {
+        return ZPSnapshotCodec<T>::decode(*this, value);
+    }
+
+    // 校验文件头，并记下保存以来流逝的墙钟时间
+    bool readHeader(ZPSnapshotKind kind, size_t keySize, size_t valueSize)
+    {
+        ZPSnapshotHeader header;
+        if (!read(header))
+            return false;
+        if (header.magic != ZPSnapshotHeader::kMagic || header.version != ZPSnapshotHeader::kVersion ||
+            header.kind != static_cast<uint32_t>(kind) || header.keySize != keySize || header.valueSize != valueSize)
+            return false;
+        uint64_t wallNow = snapshotWallClock();
+        elapsed_ = wallNow > header.savedAt ? wallNow - header.savedAt : 0;
+        return true;
+    }
+
+    // 条目数等计数的上限：每条记录至少占一个字节，损坏的计数不会导致过量预留
+    uint64_t boundCount(uint64_t count) const { return std::min<uint64_t>(count, remaining()); }
+
+    // 把写出的剩余时间换回本进程的到期时间；expiresAt 为0表示不过期，已在停机期间到期的返回false
+    bool restoreDeadline(uint64_t remaining, uint64_t now, uint64_t& expiresAt) const
+    {
+        expiresAt = 0;
+        if (remaining == 0)
+            return true;
+        if (remaining <= elapsed_)
+            return false;
+        expiresAt = now + (remaining - elapsed_);
+        return true;
+    }
+
+private:
+    const char*       data_ = nullptr;
+    size_t            size_ = 0;
+    size_t            offset_ = 0;
+    uint64_t          elapsed_ = 0;
+    bool              mapped_ = false;
+    std::vector<char> fallback_;
+};
+
+template<typename T>
+    requires std::is_trivially_copyable_v<T>
+void ZPSnapshotCodec<T>::encode(ZPSnapshotWriter& out, const T& value)
+{
+    out.writeBytes(&value, sizeof(T));
+}
+
+template<typename T>
+    requires std::is_trivially_copyable_v<T>
+bool ZPSnapshotCodec<T>::decode(ZPSnapshotReader& in, T& value)
+{
+    return in.readBytes(&value, sizeof(T));
+}
+
+inline void ZPSnapshotCodec<std::string>::encode(ZPSnapshotWriter& out, const std::string& value)
+{
+    out.write(static_cast<uint64_t>(value.size()));
+    out.writeBytes(value.data(), value.size());
+}
+
+inline bool ZPSnapshotCodec<std::string>::decode(ZPSnapshotReader& in, std::string& value)
+{
+    uint64_t size = 0;
+    if (!in.read(size) || size > in.remaining())
+        return false;
+    const char* bytes = in.view(static_cast<size_t>(size));
+    value.assign(bytes, static_cast<size_t>(size));
+    return true;
+}
+
+} // namespace ZPCache
@@ -0,0 +1,518 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "ZPCachePolicy.h"
+#include "ZPFlatHashMap.h"
+#include "ZPFrequencySketch.h"
+#include "ZPHash.h"
+#include "ZPNodePool.h"
+
+namespace ZPCache
+{
+
+// 编译期组合的缓存：淘汰、准入、加锁、索引四个策略都是模板参数，所有调用静态分派，可以完全内联。
+//   ZPStaticCache<Key, Value>                                   单线程LRU，无锁、无虚调用
+//   ZPStaticCache<Key, Value, ZPLfuEviction<10>, ZPTinyLfuAdmission, ZPMutex>
+// 原来的运行期参数（例如 LFU 的 maxAverageNum_）在这里是策略的模板参数，命中路径上不再读取。
+// 需要运行期多态时用 ZPStaticCacheAdapter 包装成 ZPCachePolicy
+
+// 淘汰策略：结点继承 Hook 存放策略自己的链接，Policy<Node> 只通过这几个接口被调用
+template<typename Policy, typename Node>
+concept ZPEvictionPolicy = std::constructible_from<Policy, size_t> && requires(Policy& policy, Node* node) {
+    policy.onInsert(node); // 新结点进入缓存
+    policy.onHit(node);    // 命中或覆盖已有结点
+    policy.onErase(node);  // 结点即将被删除或淘汰
+    { policy.victim() } -> std::same_as<Node*>; // 下一个被淘汰的结点，空缓存返回nullptr
+    policy.clear();
+};
+
+// 准入策略：record 记录每次访问（含未命中），缓存已满时 admit 决定新key能否替换victim
+template<typename Admission>
+concept ZPAdmissionPolicy = std::constructible_from<Admission, size_t> && requires(Admission& admission, size_t hash) {
+    admission.record(hash);
+    { admission.admit(hash, hash) } -> std::convertible_to<bool>;
+    admission.clear();
+};
+
+template<typename Mutex>
+concept ZPLockingPolicy = requires(Mutex& mutex) {
+    mutex.lock();
+    mutex.unlock();
+};
+
+// 单线程使用的空锁，lock/unlock 内联后不产生任何指令
+struct ZPNullMutex
+{
+    void lock() {}
+    bool try_lock() { return true; }
+    void unlock() {}
+};
+
+// 全部接纳
+struct ZPAdmitAll
+{
+    explicit ZPAdmitAll(size_t) {}
+
+    void record(size_t) {}
+    bool admit(size_t, size_t) const { return true; }
+    void clear() {}
+};
+
+// TinyLFU 准入：只有sketch估计的频次高于victim时新key才进入缓存，与 ZPTinyLfuCache 的主缓存准入相同
+class ZPTinyLfuAdmission
+{
+public:
+    explicit ZPTinyLfuAdmission(size_t capacity) : sketch_(capacity) {}
+
+    void record(size_t hash) { sketch_.increment(hash); }
+    bool admit(size_t candidate, size_t victim) const { return sketch_.frequency(candidate) > sketch_.frequency(victim); }
+    void clear() { sketch_.clear(); }
+
+private:
+    ZPFrequencySketch sketch_;
+};
+
+// 索引策略：Index<K, M> 需要提供 find/end/try_emplace/erase/reserve/clear/size
+struct ZPFlatStorage
+{
+    template<typename K, typename M>
+    using Index = ZPFlatHashMap<K, M>;
+};
+
+struct ZPStdStorage
+{
+    template<typename K, typename M>
+    struct Index : std::unordered_map<K, M>
+    {
+        explicit Index(size_t expectedSize) { this->reserve(expectedSize); }
+    };
+};
+
+// LRU：循环双向链表，头部最近使用，尾部即victim
+struct ZPLruEviction
+{
+    struct Hook
+    {
+        Hook* prev = nullptr;
+        Hook* next = nullptr;
+    };
+
+    template<typename Node>
+    class Policy
+    {
+    public:
+        explicit Policy(size_t) { clear(); }
+
+        Policy(const Policy&) = delete;
+        Policy& operator=(const Policy&) = delete;
+
+        void onInsert(Node* node) { linkFront(node); }
+
+        void onHit(Node* node)
+        {
+            unlink(node);
+            linkFront(node);
+        }
+
+        void onErase(Node* node) { unlink(node); }
+
+        Node* victim() { return head_.prev == &head_ ? nullptr : static_cast<Node*>(head_.prev); }
+
+        void clear()
+        {
+            head_.prev = &head_;
+            head_.next = &head_;
+        }
+
+    private:
+        void linkFront(Hook* hook)
+        {
+            hook->prev = &head_;
+            hook->next = head_.next;
+            head_.next->prev = hook;
+            head_.next = hook;
+        }
+
+        static void unlink(Hook* hook)
+        {
+            hook->prev->next = hook->next;
+            hook->next->prev = hook->prev;
+        }
+
+    private:
+        Hook head_; // 虚拟结点
+    };
+};
+
+// LFU：按频次升序排列的频次桶，每个桶内头部是最近进入该频次的结点，victim 是最低频次桶的尾部，增减频次都是O(1)。
+// 平均访问频次超过 MaxAverageNum 时所有结点的频次减去 MaxAverageNum / 2（至少保留1），
+// 与 ZPLfuCache 的老化规则相同；按桶整体改写频次，只有被合并到频次1的结点需要逐个修改所属桶
+template<int MaxAverageNum = 10>
+struct ZPLfuEviction
+{
+    static_assert(MaxAverageNum > 0, "MaxAverageNum must be positive");
+
+    struct Bucket;
+
+    struct Hook
+    {
+        Hook*   prev = nullptr;
+        Hook*   next = nullptr;
+        Bucket* bucket = nullptr;
+    };
+
+    struct Bucket
+    {
+        int     freq = 0;
+        size_t  count = 0;
+        Hook    head;             // 桶内循环链表的虚拟结点
+        Bucket* prev = nullptr;
+        Bucket* next = nullptr;
+    };
+
+    template<typename Node>
+    class Policy
+    {
+    public:
+        explicit Policy(size_t capacity)
+            : bucketPool_(capacity > 0 ? std::min<size_t>(capacity, kReservedBuckets) : 0)
+        {
+            clear();
+        }
+
+        Policy(const Policy&) = delete;
+        Policy& operator=(const Policy&) = delete;
+
+        ~Policy() { releaseBuckets(); }
+
+        void onInsert(Node* node)
+        {
+            Bucket* first = buckets_.next;
+            if (first == &buckets_ || first->freq != 1)
+                first = insertBucketAfter(&buckets_, 1);
+            linkFront(first, node);
+            ++entries_;
+            ++totalFreq_;
+        }
+
+        void onHit(Node* node)
+        {
+            Bucket* bucket = node->bucket;
+            Bucket* next = bucket->next;
+            int freq = bucket->freq + 1;
+            if (next == &buckets_ || next->freq != freq)
+                next = insertBucketAfter(bucket, freq);
+            unlink(node);
+            linkFront(next, node);
+            if (bucket->count == 0)
+                removeBucket(bucket);
+
+            ++totalFreq_;
+            if (totalFreq_ > static_cast<size_t>(MaxAverageNum) * entries_)
+                age();
+        }
+
+        void onErase(Node* node)
+        {
+            Bucket* bucket = node->bucket;
+            totalFreq_ -= static_cast<size_t>(bucket->freq);
+            --entries_;
+            unlink(node);
+            if (bucket->count == 0)
+                removeBucket(bucket);
+        }
+
+        Node* victim()
+        {
+            Bucket* first = buckets_.next;
+            return first == &buckets_ ? nullptr : static_cast<Node*>(first->head.prev);
+        }
+
+        void clear()
+        {
+            releaseBuckets();
+            buckets_.prev = &buckets_;
+            buckets_.next = &buckets_;
+            entries_ = 0;
+            totalFreq_ = 0;
+        }
+
+    private:
+        static constexpr size_t kReservedBuckets = 64;
+        static constexpr int    kDecay = MaxAverageNum / 2 > 0 ? MaxAverageNum / 2 : 1;
+
+        void age()
+        {
+            Bucket* merged = nullptr; // 频次降到1的桶都并入第一个
+            totalFreq_ = 0;
+            for (Bucket* bucket = buckets_.next; bucket != &buckets_;)
+            {
+                Bucket* next = bucket->next;
+                bucket->freq = std::max(1, bucket->freq - kDecay);
+                totalFreq_ += static_cast<size_t>(bucket->freq) * bucket->count;
+                if (bucket->freq == 1 && merged)
+                {
+                    // 原先频次更高的结点放在合并桶的头部，淘汰时排在原先频次更低的结点之后
+                    while (bucket->count > 0)
+                    {
+                        Hook* hook = bucket->head.prev;
+                        unlink(hook);
+                        linkFront(merged, hook);
+                    }
+                    removeBucket(bucket);
+                }
+                else if (bucket->freq == 1)
+                {
+                    merged = bucket;
+                }
+                bucket = next;
+            }
+        }
+
+        Bucket* insertBucketAfter(Bucket* position, int freq)
+        {
+            Bucket* bucket = bucketPool_.acquire();
+            bucket->freq = freq;
+            bucket->count = 0;
+            bucket->head.prev = &bucket->head;
+            bucket->head.next = &bucket->head;
+            bucket->prev = position;
+            bucket->next = position->next;
+            position->next->prev = bucket;
+            position->next = bucket;
+            return bucket;
+        }
+
+        void removeBucket(Bucket* bucket)
+        {
+            bucket->prev->next = bucket->next;
+            bucket->next->prev = bucket->prev;
+            bucketPool_.release(bucket);
+        }
+
+        void releaseBuckets()
+        {
+            if (!buckets_.next)
+                return;
+            Bucket* bucket = buckets_.next;
+            while (bucket != &buckets_)
+            {
+                Bucket* next = bucket->next;
+                bucketPool_.release(bucket);
+                bucket = next;
+            }
+        }
+
+        static void linkFront(Bucket* bucket, Hook* hook)
+        {
+            hook->bucket = bucket;
+            hook->prev = &bucket->head;
+            hook->next = bucket->head.next;
+            bucket->head.next->prev = hook;
+            bucket->head.next = hook;
+            ++bucket->count;
+        }
+
+        static void unlink(Hook* hook)
+        {
+            hook->prev->next = hook->next;
+            hook->next->prev = hook->prev;
+            --hook->bucket->count;
+        }
+
+    private:
+        ZPNodePool<Bucket> bucketPool_;
+        Bucket             buckets_;        // 频次桶链表的虚拟结点
+        size_t             entries_ = 0;
+        size_t             totalFreq_ = 0;  // 所有结点的频次之和
+    };
+};
+
+template<typename Key, typename Value,
+         typename Eviction = ZPLruEviction,
+         typename Admission = ZPAdmitAll,
+         typename Locking = ZPNullMutex,
+         typename Storage = ZPFlatStorage>
+class ZPStaticCache
+{
+    struct Node : Eviction::Hook
+    {
+        Key   key{};
+        Value value{};
+    };
+
+    using EvictionPolicy = typename Eviction::template Policy<Node>;
+    using IndexType = typename Storage::template Index<Key, Node*>;
+
+    static_assert(ZPEvictionPolicy<EvictionPolicy, Node>, "Eviction::Policy<Node> does not model ZPEvictionPolicy");
+    static_assert(ZPAdmissionPolicy<Admission>, "Admission does not model ZPAdmissionPolicy");
+    static_assert(ZPLockingPolicy<Locking>, "Locking does not model ZPLockingPolicy");
+
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+
+    explicit ZPStaticCache(size_t capacity)
+        : capacity_(capacity)
+        , pool_(capacity)
+        , index_(capacity)
+        , eviction_(capacity)
+        , admission_(capacity)
+    {}
+
+    ZPStaticCache(const ZPStaticCache&) = delete;
+    ZPStaticCache& operator=(const ZPStaticCache&) = delete;
+
+    bool get(const Key& key, Value& value)
+    {
+        std::lock_guard<Locking> lock(mutex_);
+        admission_.record(hashKey(key));
+        auto it = index_.find(key);
+        if (it == index_.end())
+            return false;
+        eviction_.onHit(it->second);
+        value = it->second->value;
+        return true;
+    }
+
+    Value get(const Key& key)
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    // 命中时在锁内把值的引用交给visitor，visitor是模板参数，同样可以内联
+    template<typename Visitor>
+    bool visit(const Key& key, Visitor&& visitor)
+    {
+        std::lock_guard<Locking> lock(mutex_);
+        admission_.record(hashKey(key));
+        auto it = index_.find(key);
+        if (it == index_.end())
+            return false;
+        eviction_.onHit(it->second);
+        std::forward<Visitor>(visitor)(std::as_const(it->second->value));
+        return true;
+    }
+
+    // 缓存已满且准入策略拒绝时，新key不会进入缓存
+    void put(const Key& key, Value value)
+    {
+        if (capacity_ == 0)
+            return;
+
+        std::lock_guard<Locking> lock(mutex_);
+        size_t hash = hashKey(key);
+        admission_.record(hash);
+        auto it = index_.find(key);
+        if (it != index_.end())
+        {
+            it->second->value = std::move(value);
+            eviction_.onHit(it->second);
+            return;
+        }
+
+        if (index_.size() >= capacity_)
+        {
+            Node* victim = eviction_.victim();
+            if (!admission_.admit(hash, hashKey(victim->key)))
+                return;
+            eraseNode(victim);
+        }
+
+        Node* node = pool_.acquire();
+        node->key = key;
+        node->value = std::move(value);
+        index_.try_emplace(key, node);
+        eviction_.onInsert(node);
+    }
+
+    bool remove(const Key& key)
+    {
+        std::lock_guard<Locking> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end())
+            return false;
+        eraseNode(it->second);
+        return true;
+    }
+
+    void clear()
+    {
+        std::lock_guard<Locking> lock(mutex_);
+        for (auto& entry : index_)
+            releaseNode(entry.second);
+        index_.clear();
+        eviction_.clear();
+        admission_.clear();
+    }
+
+    size_t size()
+    {
+        std::lock_guard<Locking> lock(mutex_);
+        return index_.size();
+    }
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    void eraseNode(Node* node)
+    {
+        eviction_.onErase(node);
+        index_.erase(node->key);
+        releaseNode(node);
+    }
+
+    void releaseNode(Node* node)
+    {
+        node->value = Value{};
+        pool_.release(node);
+    }
+
+private:
+    size_t                             capacity_;
+    ZPNodePool<Node>                   pool_;
+    IndexType                          index_;
+    EvictionPolicy                     eviction_;
+    [[no_unique_address]] Admission    admission_;
+    [[no_unique_address]] Locking      mutex_;
+};
+
+// 把 ZPStaticCache 包装成 ZPCachePolicy，供需要运行期多态的调用者使用（例如 main.cc 的 caches 数组）。
+// 只有这一层是虚调用，内部仍是静态分派；并发使用时 Cache 的 Locking 不能是 ZPNullMutex
+template<typename Cache>
+class ZPStaticCacheAdapter : public ZPCachePolicy<typename Cache::key_type, typename Cache::mapped_type>
+{
+    using Key = typename Cache::key_type;
+    using Value = typename Cache::mapped_type;
+
+public:
+    template<typename... Args>
+    explicit ZPStaticCacheAdapter(Args&&... args) : cache_(std::forward<Args>(args)...) {}
+
+    void put(Key key, Value value) override { cache_.put(key, std::move(value)); }
+
+    bool get(Key key, Value& value) override { return cache_.get(key, value); }
+
+    Value get(Key key) override { return cache_.get(key); }
+
+    bool visit(const Key& key, const std::function<void(const Value&)>& visitor) override
+    {
+        return cache_.visit(key, visitor);
+    }
+
+    Cache& cache() { return cache_; }
+
+private:
+    Cache cache_;
+};
+
+} // namespace ZPCache
@@ -0,0 +1,598 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "ZPCachePolicy.h"
+#include "ZPFlatHashMap.h"
+#include "ZPHash.h"
+#include "ZPLockProfiling.h"
+#include "ZPLruCache.h"
+#include "ZPSnapshot.h"
+#include "ZPTimingWheel.h"
+
+namespace ZPCache
+{
+
+struct ZPFileTierOptions
+{
+    std::string directory;                          // 段文件所在的目录，不存在时创建
+    size_t      segmentBytes = size_t(256) << 20;   // 单个段文件的大小上限（不超过4GB）
+    size_t      maxSegments = 64;                   // 段数上限，文件层最多占用 segmentBytes * maxSegments 字节
+    size_t      writeBufferBytes = size_t(4) << 20; // 写缓冲攒够这么多字节整块写出
+    size_t      maxQueuedBuffers = 4;               // 等待写出的缓冲数上限，写盘跟不上时 store 阻塞
+};
+
+struct ZPFileTierStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t stores = 0;
+    uint64_t bytesWritten = 0;
+    uint64_t droppedSegments = 0; // 按FIFO整段回收的段数
+    uint64_t writeErrors = 0;     // 写失败的缓冲数，其中的条目已从索引中移除
+    uint64_t expired = 0;         // 读取时已到期而丢弃的条目数
+    size_t   entries = 0;
+    size_t   segments = 0;
+};
+
+// 日志结构的文件层：条目只追加写入当前段，不原地修改。
+//   - 记录用 ZPSnapshotCodec 编码（key 后接 value），先攒在内存写缓冲里，满了交给后台线程用一次 pwrite 顺序写出；
+//   - 内存中的索引只保存 key 的64位哈希到 (段号, 偏移, 长度) 的映射，不保存 key；读出记录后再比较 key，哈希相同的不同key只会互相覆盖成未命中；
+//   - 同一个key再次写入时索引指向新记录，旧记录成为垃圾，不单独回收：段数超过上限时删除最旧的整个段文件，并从索引中去掉仍指向它的条目；
+//   - 查找在锁内只查索引，pread 在锁外进行，段文件在最后一个读者结束前不会关闭。还在写缓冲中的记录直接从内存解码；
+//   - 带TTL的条目在索引中记下到期时间（本进程 ZPTimingWheel 的时钟），到期后查找在读盘之前就当作未命中并移出索引。
+// 文件层只是缓存：不写元数据，重启后不恢复，析构时删除全部段文件。仅支持POSIX
+template<typename Key, typename Value>
+class ZPFileTier
+{
+public:
+    explicit ZPFileTier(ZPFileTierOptions options)
+        : options_(normalize(std::move(options)))
+        , filePrefix_(options_.directory + "/zpcache-" + std::to_string(::getpid()) + "-" +
+                      std::to_string(nextInstance()) + "-")
+    {
+        std::error_code error;
+        std::filesystem::create_directories(options_.directory, error);
+        ok_ = openSegment();
+        writer_ = std::thread([this] { run(); });
+    }
+
+    // 等待已封存的写缓冲写完，之后删除所有段文件
+    ~ZPFileTier()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        workReady_.notify_one();
+        writer_.join();
+        for (const std::shared_ptr<Segment>& segment : segments_)
+            ::unlink(segment->path.c_str());
+    }
+
+    ZPFileTier(const ZPFileTier&) = delete;
+    ZPFileTier& operator=(const ZPFileTier&) = delete;
+
+    bool ok() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return ok_;
+    }
+
+    // 追加一条记录，同一个key之前的记录作废；expiresAt 为0表示不过期。记录比一个段还大或无法创建段文件时返回false
+    bool store(const Key& key, const Value& value, uint64_t expiresAt = 0)
+    {
+        thread_local std::vector<char> record;
+        record.clear();
+        ZPSnapshotWriter out(record);
+        out.write(key);
+        out.write(value);
+        if (record.size() > options_.segmentBytes)
+            return false;
+
+        uint64_t hash = hashKey(key);
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!ok_ || !reserveSpace(lock, record.size()))
+            return false;
+
+        Location location{active_->segment->id, static_cast<uint32_t>(active_->base + active_->bytes.size()),
+                          static_cast<uint32_t>(record.size()), expiresAt};
+        active_->bytes.insert(active_->bytes.end(), record.begin(), record.end());
+        active_->segment->hashes.push_back(hash);
+        index_.insert_or_assign(hash, location);
+        ++stores_;
+        return true;
+    }
+
+    bool lookup(const Key& key, Value& value)
+    {
+        uint64_t expiresAt = 0;
+        return read(key, value, false, expiresAt);
+    }
+
+    // 命中时读出并从索引中移除，用于把条目提升回内存层；expiresAt 带回存入时的到期时间，0表示不过期
+    bool take(const Key& key, Value& value, uint64_t& expiresAt) { return read(key, value, true, expiresAt); }
+
+    void erase(const Key& key)
+    {
+        uint64_t hash = hashKey(key);
+        std::lock_guard<std::mutex> lock(mutex_);
+        index_.erase(hash);
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return index_.size();
+    }
+
+    ZPFileTierStats stats() const
+    {
+        ZPFileTierStats snapshot;
+        snapshot.hits = hits_.load(std::memory_order_relaxed);
+        snapshot.misses = misses_.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex_);
+        snapshot.stores = stores_;
+        snapshot.bytesWritten = bytesWritten_;
+        snapshot.droppedSegments = droppedSegments_;
+        snapshot.writeErrors = writeErrors_;
+        snapshot.expired = expired_;
+        snapshot.entries = index_.size();
+        snapshot.segments = segments_.size();
+        return snapshot;
+    }
+
+private:
+    struct Location
+    {
+        uint32_t segment;
+        uint32_t offset;
+        uint32_t size;
+        uint64_t expiresAt; // 0表示不过期
+
+        bool operator==(const Location&) const = default;
+    };
+
+    struct Segment
+    {
+        Segment(uint32_t segmentId, int file, std::string filePath)
+            : id(segmentId), fd(file), path(std::move(filePath))
+        {}
+        ~Segment() { ::close(fd); }
+
+        uint32_t              id;
+        int                   fd;
+        std::string           path;
+        std::vector<uint64_t> hashes;          // 写入本段的记录的key哈希，回收时据此清理索引
+        bool                  dropped = false; // 已被回收，尚未写出的缓冲不必再写
+    };
+
+    struct WriteBuffer
+    {
+        std::shared_ptr<Segment> segment;
+        size_t                   base; // 缓冲第一个字节在段文件中的偏移
+        std::vector<char>        bytes;
+
+        bool holds(const Location& location) const
+        {
+            return segment->id == location.segment && location.offset >= base &&
+                   location.offset < base + bytes.size();
+        }
+    };
+
+    static ZPFileTierOptions normalize(ZPFileTierOptions options)
+    {
+        options.segmentBytes = std::clamp<size_t>(options.segmentBytes, 4096, UINT32_MAX);
+        options.maxSegments = std::max<size_t>(options.maxSegments, 1);
+        options.writeBufferBytes = std::clamp<size_t>(options.writeBufferBytes, 4096, options.segmentBytes);
+        options.maxQueuedBuffers = std::max<size_t>(options.maxQueuedBuffers, 1);
+        return options;
+    }
+
+    // 段文件名带上进程号与实例序号，多个文件层可以共用一个目录
+    static uint64_t nextInstance()
+    {
+        static std::atomic<uint64_t> instances{0};
+        return instances.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static bool decode(const char* data, size_t size, const Key& key, Value& value)
+    {
+        ZPSnapshotReader in(data, size);
+        Key stored{};
+        return in.read(stored) && stored == key && in.read(value);
+    }
+
+    bool read(const Key& key, Value& value, bool take, uint64_t& expiresAt)
+    {
+        uint64_t hash = hashKey(key);
+        Location location;
+        std::shared_ptr<Segment> segment;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = index_.find(hash);
+            if (it != index_.end() && it->second.expiresAt && it->second.expiresAt <= ZPTimingWheel::now())
+            {
+                index_.erase(it);
+                ++expired_;
+                it = index_.end();
+            }
+            if (it == index_.end())
+            {
+                misses_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            location = it->second;
+            expiresAt = location.expiresAt;
+            if (const WriteBuffer* buffer = bufferHolding(location))
+            {
+                bool decoded = decode(buffer->bytes.data() + (location.offset - buffer->base), location.size, key, value);
+                if (decoded && take)
+                    index_.erase(it);
+                (decoded ? hits_ : misses_).fetch_add(1, std::memory_order_relaxed);
+                return decoded;
+            }
+            segment = segments_[location.segment - segments_.front()->id];
+        }
+
+        thread_local std::vector<char> record;
+        record.resize(location.size);
+        if (!readFully(segment->fd, record.data(), location.size, location.offset) ||
+            !decode(record.data(), location.size, key, value))
+        {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (take)
+        {
+            // 锁外读盘期间这个key可能已被重新写入，只移除读到的那条记录
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = index_.find(hash);
+            if (it != index_.end() && it->second == location)
+                index_.erase(it);
+        }
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    const WriteBuffer* bufferHolding(const Location& location) const
+    {
+        if (active_->holds(location))
+            return active_.get();
+        for (const std::unique_ptr<WriteBuffer>& buffer : sealed_)
+        {
+            if (buffer->holds(location))
+                return buffer.get();
+        }
+        return nullptr;
+    }
+
+    // 保证当前写缓冲能再追加 size 字节：缓冲满了就封存交给写线程，段满了就换新段。
+    // 封存队列已满时释放锁等待写线程，醒来后重新检查
+    bool reserveSpace(std::unique_lock<std::mutex>& lock, size_t size)
+    {
+        for (;;)
+        {
+            size_t end = active_->base + active_->bytes.size();
+            bool segmentFull = end + size > options_.segmentBytes;
+            bool bufferFull = !active_->bytes.empty() && active_->bytes.size() + size > options_.writeBufferBytes;
+            if (!segmentFull && !bufferFull)
+                return true;
+            if (!active_->bytes.empty())
+            {
+                if (sealed_.size() >= options_.maxQueuedBuffers)
+                {
+                    spaceReady_.wait(lock);
+                    if (!ok_)
+                        return false;
+                    continue;
+                }
+                std::shared_ptr<Segment> segment = active_->segment;
+                sealed_.push_back(std::move(active_));
+                workReady_.notify_one();
+                active_ = std::make_unique<WriteBuffer>(WriteBuffer{std::move(segment), end, {}});
+                active_->bytes.reserve(options_.writeBufferBytes);
+            }
+            if (segmentFull && !openSegment())
+            {
+                ok_ = false;
+                return false;
+            }
+        }
+    }
+
+    // 新建一个段并让写缓冲指向它；段数超过上限时回收最旧的段
+    bool openSegment()
+    {
+        uint32_t id = nextSegmentId_++;
+        std::string path = filePrefix_ + std::to_string(id) + ".seg";
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return false;
+        auto segment = std::make_shared<Segment>(id, fd, std::move(path));
+        segments_.push_back(segment);
+        active_ = std::make_unique<WriteBuffer>(WriteBuffer{std::move(segment), 0, {}});
+        active_->bytes.reserve(options_.writeBufferBytes);
+        while (segments_.size() > options_.maxSegments)
+            dropOldestSegment();
+        return true;
+    }
+
+    void dropOldestSegment()
+    {
+        std::shared_ptr<Segment> segment = std::move(segments_.front());
+        segments_.pop_front();
+        for (uint64_t hash : segment->hashes)
+        {
+            auto it = index_.find(hash);
+            if (it != index_.end() && it->second.segment == segment->id)
+                index_.erase(it);
+        }
+        segment->hashes = {};
+        segment->dropped = true;
+        ::unlink(segment->path.c_str());
+        ++droppedSegments_;
+    }
+
+    // 缓冲没能写出时，其中的记录从索引中移除，之后的查找不会读到空洞
+    void forgetBuffer(const WriteBuffer& buffer)
+    {
+        for (uint64_t hash : buffer.segment->hashes)
+        {
+            auto it = index_.find(hash);
+            if (it != index_.end() && buffer.holds(it->second))
+                index_.erase(it);
+        }
+    }
+
+    static bool readFully(int fd, char* data, size_t size, size_t offset)
+    {
+        while (size)
+        {
+            ssize_t n = ::pread(fd, data, size, static_cast<off_t>(offset));
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= static_cast<size_t>(n);
+            offset += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    static bool writeFully(int fd, const char* data, size_t size, size_t offset)
+    {
+        while (size)
+        {
+            ssize_t n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= static_cast<size_t>(n);
+            offset += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // 写线程：依次在锁外写出封存的缓冲，写完才出队，出队之前的查找仍从缓冲解码
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;)
+        {
+            workReady_.wait(lock, [this] { return stopping_ || !sealed_.empty(); });
+            if (sealed_.empty())
+                return;
+            const WriteBuffer& buffer = *sealed_.front();
+            bool skip = buffer.segment->dropped;
+            lock.unlock();
+            bool written = skip || writeFully(buffer.segment->fd, buffer.bytes.data(), buffer.bytes.size(), buffer.base);
+            lock.lock();
+            if (!written)
+            {
+                ++writeErrors_;
+                forgetBuffer(buffer);
+            }
+            else if (!skip)
+            {
+                bytesWritten_ += buffer.bytes.size();
+            }
+            sealed_.pop_front();
+            spaceReady_.notify_all();
+        }
+    }
+
+private:
+    ZPFileTierOptions                         options_;
+    std::string                               filePrefix_;
+    mutable std::mutex                        mutex_;
+    std::condition_variable                   workReady_;  // 有缓冲等待写出或需要退出
+    std::condition_variable                   spaceReady_; // 写线程写完一个缓冲
+    ZPFlatHashMap<uint64_t, Location>         index_;      // key的哈希 -> 记录位置
+    std::deque<std::shared_ptr<Segment>>      segments_;   // 从旧到新，段号连续
+    std::unique_ptr<WriteBuffer>              active_;     // 正在追加的缓冲
+    std::deque<std::unique_ptr<WriteBuffer>>  sealed_;     // 等待写出的缓冲，队头正在写
+    uint32_t                                  nextSegmentId_ = 0;
+    bool                                      ok_ = false;
+    bool                                      stopping_ = false;
+    uint64_t                                  stores_ = 0;
+    uint64_t                                  bytesWritten_ = 0;
+    uint64_t                                  droppedSegments_ = 0;
+    uint64_t                                  writeErrors_ = 0;
+    uint64_t                                  expired_ = 0;
+    std::atomic<uint64_t>                     hits_{0};
+    std::atomic<uint64_t>                     misses_{0};
+    std::thread                               writer_;
+};
+
+// 两级缓存：内存层是任意支持淘汰监听的策略（ZPLruCache、ZPLfuCache、ZPArcCache、分片缓存等），
+// 被它淘汰的条目降级写入文件层，而不是直接丢弃；内存未命中时查文件层，命中的条目从文件层取出并提升回内存层。
+// 一个key同一时刻只在一层中有效。同一个key的put与提升按key哈希分条加锁串行，提升不会用文件层的旧值覆盖并发写入的新值。
+// 降级在内存层的锁内进行，只把记录追加到文件层的写缓冲；文件层的写盘跟不上时内存层的写入随之阻塞。
+// 带TTL写入的key另记到期时间：降级时随记录写入文件层，已到期的不再降级，提升回内存层时按剩余TTL重新写入
+template<typename Key, typename Value, typename Cache = ZPLruCache<Key, Value>>
+class ZPTieredCache : public ZPCachePolicy<Key, Value>
+{
+    static_assert(std::is_base_of_v<ZPCachePolicy<Key, Value>, Cache>, "Cache must implement ZPCachePolicy");
+
+public:
+    // args 原样转发给内存层的构造函数
+    template<typename... Args>
+    explicit ZPTieredCache(ZPFileTierOptions tierOptions, Args&&... args)
+        : cache_(std::forward<Args>(args)...)
+        , tier_(std::move(tierOptions))
+    {
+        demoting_ = cache_.setEvictionListener([this](const Key& key, const Value& value) {
+            uint64_t expiresAt = deadlineOf(key);
+            if (expiresAt && expiresAt <= ZPTimingWheel::now())
+                return;
+            if (tier_.store(key, value, expiresAt))
+                demotions_.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+
+    ~ZPTieredCache() override = default;
+
+    void put(Key key, Value value) override
+    {
+        std::lock_guard<ZPMutex> lock(stripeFor(key));
+        setDeadline(key, 0);
+        cache_.put(key, std::move(value));
+        tier_.erase(key);
+    }
+
+    void put(Key key, Value value, std::chrono::nanoseconds ttl) override
+    {
+        std::lock_guard<ZPMutex> lock(stripeFor(key));
+        setDeadline(key, ttl.count() > 0 ? ZPTimingWheel::deadline(ZPTimingWheel::now(), ttl) : 0);
+        cache_.put(key, std::move(value), ttl);
+        tier_.erase(key);
+    }
+
+    std::optional<std::chrono::nanoseconds> timeToLive(const Key& key) override { return cache_.timeToLive(key); }
+
+    bool get(Key key, Value& value) override
+    {
+        return cache_.get(key, value) || promote(key, value);
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    bool visit(const Key& key, const std::function<void(const Value&)>& visitor) override
+    {
+        if (cache_.visit(key, visitor))
+            return true;
+        Value value{};
+        if (!promote(key, value))
+            return false;
+        visitor(value);
+        return true;
+    }
+
+    // 文件层命中计入 hits，不计入内存层的 misses 与 puts
+    ZPCacheStats stats() const override
+    {
+        ZPCacheStats snapshot = cache_.stats();
+        uint64_t promoted = promotions_.load(std::memory_order_relaxed);
+        snapshot.hits += promoted;
+        snapshot.misses -= std::min(snapshot.misses, promoted);
+        snapshot.puts -= std::min(snapshot.puts, promoted);
+        return snapshot;
+    }
+
+    void enableLatencySampling(uint32_t sampleEvery) override { cache_.enableLatencySampling(sampleEvery); }
+
+    // 内存层不支持淘汰监听时文件层不会被写入
+    bool demoting() const { return demoting_; }
+    uint64_t demotions() const { return demotions_.load(std::memory_order_relaxed); }
+    uint64_t promotions() const { return promotions_.load(std::memory_order_relaxed); }
+
+    Cache& cache() { return cache_; }
+    ZPFileTier<Key, Value>& tier() { return tier_; }
+
+private:
+    static constexpr size_t kKeyStripes = 64;
+    static constexpr size_t kMinDeadlineSweep = 1024;
+
+    ZPMutex& stripeFor(const Key& key) { return stripes_[hashKey(key) & (kKeyStripes - 1)]; }
+
+    bool promote(const Key& key, Value& value)
+    {
+        std::lock_guard<ZPMutex> lock(stripeFor(key));
+        uint64_t expiresAt = 0;
+        if (!tier_.take(key, value, expiresAt))
+            return false;
+        if (expiresAt)
+            cache_.put(key, value, ZPTimingWheel::remaining(expiresAt, ZPTimingWheel::now()));
+        else
+            cache_.put(key, value);
+        promotions_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    uint64_t deadlineOf(const Key& key)
+    {
+        std::lock_guard<ZPMutex> lock(deadlineMutex_);
+        auto it = deadlines_.find(key);
+        return it == deadlines_.end() ? 0 : it->second;
+    }
+
+    // expiresAt 为0时忘掉key的到期时间。记录只在覆盖写入或清扫时删除：降级和提升都还要用到它。
+    // 条数翻倍时清扫一次已到期的记录，在内存层里到期的key不会一直留在表中
+    void setDeadline(const Key& key, uint64_t expiresAt)
+    {
+        std::lock_guard<ZPMutex> lock(deadlineMutex_);
+        if (!expiresAt)
+        {
+            deadlines_.erase(key);
+            return;
+        }
+        deadlines_.insert_or_assign(key, expiresAt);
+        if (deadlines_.size() < sweepAt_)
+            return;
+        uint64_t now = ZPTimingWheel::now();
+        std::vector<Key> expired;
+        for (const auto& [deadlineKey, deadline] : deadlines_)
+            if (deadline <= now)
+                expired.push_back(deadlineKey);
+        for (const Key& expiredKey : expired)
+            deadlines_.erase(expiredKey);
+        sweepAt_ = std::max(kMinDeadlineSweep, deadlines_.size() * 2);
+    }
+
+private:
+    Cache                             cache_;
+    ZPFileTier<Key, Value>            tier_;
+    std::array<ZPMutex, kKeyStripes>  stripes_;
+    ZPMutex                           deadlineMutex_;
+    ZPFlatHashMap<Key, uint64_t>      deadlines_;  // 带TTL写入的key -> 到期时间
+    size_t                            sweepAt_ = kMinDeadlineSweep;
+    bool                              demoting_ = false;
+    std::atomic<uint64_t>             demotions_{0};
+    std::atomic<uint64_t>             promotions_{0};
+};
+
+} // namespace ZPCache
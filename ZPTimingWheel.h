@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace ZPCache
+{
+
+// 定时轮中的侵入式链接，需要过期的缓存结点继承它。expiresAt_ 为0表示永不过期（未挂在定时轮上）
+class ZPTimerLink
+{
+public:
+    uint64_t expiresAt() const { return expiresAt_; }
+
+    // now 以 ZPTimingWheel::now() 为准
+    bool expiredAt(uint64_t now) const { return expiresAt_ != 0 && expiresAt_ <= now; }
+
+private:
+    ZPTimerLink* timerPrev_ = nullptr;
+    ZPTimerLink* timerNext_ = nullptr;
+    uint64_t     expiresAt_ = 0;
+
+    friend class ZPTimingWheel;
+};
+
+// 分层定时轮：5层，每层64个桶，第0层每桶约1ms（2^20ns），每升一层桶宽乘64，顶层一圈约13天，更远的到期时间在顶层绕圈。
+// 结点按剩余时间挂到能容纳它的最低一层的桶里；时间推进时只处理走过的桶，到期的回调给缓存，未到期的按剩余时间降层重挂。
+// 挂载/取消都是O(1)，每个结点一生至多降层5次，均摊O(1)；没有逐结点的定时器，也不扫描全部结点。
+// 不加锁，由持有它的缓存负责同步；结点可能比到期时间晚不到一个第0层桶宽才被回收，命中时由缓存用 expiredAt 精确判断
+class ZPTimingWheel
+{
+public:
+    static constexpr size_t kLevels = 5;
+    static constexpr size_t kBucketBits = 6;
+    static constexpr size_t kBuckets = size_t(1) << kBucketBits;
+    static constexpr std::array<uint32_t, kLevels> kShifts = {20, 26, 32, 38, 44};
+
+    ZPTimingWheel()
+        : nanos_(now())
+    {
+        clear();
+    }
+
+    ZPTimingWheel(const ZPTimingWheel&) = delete;
+    ZPTimingWheel& operator=(const ZPTimingWheel&) = delete;
+
+    // 单调时钟的纳秒数，到期时间都用这个时间基准
+    static uint64_t now()
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+                .count());
+    }
+
+    static uint64_t deadline(uint64_t now, std::chrono::nanoseconds ttl)
+    {
+        return now + static_cast<uint64_t>(std::max<int64_t>(ttl.count(), 1));
+    }
+
+    // 距离到期还剩多久，已到期返回0
+    static std::chrono::nanoseconds remaining(uint64_t expiresAt, uint64_t now)
+    {
+        return std::chrono::nanoseconds(expiresAt > now ? static_cast<int64_t>(expiresAt - now) : 0);
+    }
+
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+    // 挂载或重新挂载结点。调用前应先 advance 到当前时间，剩余时间按上次推进的时间计算
+    void schedule(ZPTimerLink* link, uint64_t expiresAt)
+    {
+        cancel(link);
+        link->expiresAt_ = expiresAt;
+        insertLink(link);
+    }
+
+    // 从定时轮上摘下结点，未挂载时什么也不做
+    void cancel(ZPTimerLink* link)
+    {
+        if (link->timerNext_)
+        {
+            removeLink(link);
+            --size_;
+        }
+        link->expiresAt_ = 0;
+    }
+
+    // 推进到 now，对每个到期结点调用 onExpire(link)，调用时结点已从定时轮摘下。返回到期的结点数。
+    // onExpire 中只能移除该结点本身，不能再挂载或取消其他结点
+    template<typename Fn>
+    size_t advance(uint64_t now, Fn&& onExpire)
+    {
+        if (now <= nanos_)
+            return 0;
+
+        uint64_t previous = nanos_;
+        nanos_ = now;
+        size_t expired = 0;
+        for (size_t level = 0; level < kLevels; ++level)
+        {
+            uint64_t previousTicks = previous >> kShifts[level];
+            uint64_t currentTicks = now >> kShifts[level];
+            if (currentTicks == previousTicks)
+                break;
+            expired += expireLevel(level, previousTicks, currentTicks - previousTicks, onExpire);
+        }
+        return expired;
+    }
+
+    // 丢弃所有挂载关系，结点由缓存自行释放
+    void clear()
+    {
+        for (ZPTimerLink& sentinel : buckets_)
+        {
+            sentinel.timerPrev_ = &sentinel;
+            sentinel.timerNext_ = &sentinel;
+        }
+        size_ = 0;
+    }
+
+private:
+    // 走过 delta 个桶宽：连同上次所在的桶一起处理，最多处理一整圈
+    template<typename Fn>
+    size_t expireLevel(size_t level, uint64_t previousTicks, uint64_t delta, Fn& onExpire)
+    {
+        size_t steps = static_cast<size_t>(std::min<uint64_t>(delta + 1, kBuckets));
+        size_t start = static_cast<size_t>(previousTicks & (kBuckets - 1));
+        size_t expired = 0;
+        for (size_t step = 0; step < steps; ++step)
+        {
+            ZPTimerLink* sentinel = &buckets_[level * kBuckets + ((start + step) & (kBuckets - 1))];
+            ZPTimerLink* link = sentinel->timerNext_;
+            sentinel->timerPrev_ = sentinel;
+            sentinel->timerNext_ = sentinel;
+            while (link != sentinel)
+            {
+                ZPTimerLink* next = link->timerNext_;
+                link->timerPrev_ = nullptr;
+                link->timerNext_ = nullptr;
+                --size_;
+                if (link->expiresAt_ <= nanos_)
+                {
+                    onExpire(link);
+                    ++expired;
+                }
+                else
+                {
+                    insertLink(link); // 未到期：按剩余时间挂到更低的层
+                }
+                link = next;
+            }
+        }
+        return expired;
+    }
+
+    // 已经到期的结点挂进当前桶，下次推进时立即处理
+    ZPTimerLink* bucketFor(uint64_t expiresAt)
+    {
+        expiresAt = std::max(expiresAt, nanos_);
+        uint64_t delta = expiresAt - nanos_;
+        size_t level = 0;
+        while (level + 1 < kLevels && delta >= (uint64_t(1) << (kShifts[level] + kBucketBits)))
+            ++level;
+        return &buckets_[level * kBuckets + ((expiresAt >> kShifts[level]) & (kBuckets - 1))];
+    }
+
+    void insertLink(ZPTimerLink* link)
+    {
+        ZPTimerLink* sentinel = bucketFor(link->expiresAt_);
+        link->timerNext_ = sentinel;
+        link->timerPrev_ = sentinel->timerPrev_;
+        sentinel->timerPrev_->timerNext_ = link;
+        sentinel->timerPrev_ = link;
+        ++size_;
+    }
+
+    void removeLink(ZPTimerLink* link)
+    {
+        link->timerPrev_->timerNext_ = link->timerNext_;
+        link->timerNext_->timerPrev_ = link->timerPrev_;
+        link->timerPrev_ = nullptr;
+        link->timerNext_ = nullptr;
+    }
+
+private:
+    std::array<ZPTimerLink, kLevels * kBuckets> buckets_; // 每个桶一个循环链表的虚拟结点
+    uint64_t                                     nanos_;   // 上次推进到的时间
+    size_t                                       size_ = 0;
+};
+
+} // namespace ZPCache
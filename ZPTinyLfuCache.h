@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+#include "ZPCachePolicy.h"
+#include "ZPFlatHashMap.h"
+#include "ZPFrequencySketch.h"
+#include "ZPHash.h"
+#include "ZPLockProfiling.h"
+#include "ZPNodePool.h"
+
+namespace ZPCache
+{
+
+template<typename Key, typename Value> class ZPTinyLfuCache;
+
+template<typename Key, typename Value>
+class TinyLfuNode
+{
+private:
+    enum class Region : uint8_t
+    {
+        Window,    // 准入窗口：新key先进入这里，吸收突发访问
+        Probation, // 主区的试用段：刚被准入、或从保护段降级的key
+        Protected, // 主区的保护段：在试用段中再次被访问的key
+    };
+
+    Key          key_{};
+    Value        value_{};
+    Region       region_ = Region::Window;
+    TinyLfuNode* prev_ = nullptr; // 结点由ZPNodePool统一持有，链表只用裸指针串联
+    TinyLfuNode* next_ = nullptr;
+
+public:
+    const Key& getKey() const { return key_; }
+    const Value& getValue() const { return value_; }
+
+    friend class ZPTinyLfuCache<Key, Value>;
+};
+
+// W-TinyLFU：约1%容量的窗口LRU + 分段LRU（试用段/保护段，保护段占主区80%）组成的主区。
+// 窗口溢出时，窗口中最旧的key作为候选者，与试用段中最旧的key比较 Count-Min Sketch 估计的频次，
+// 频次更高者留下。频率信息只存于 sketch（每个key约8字节），不像LRU-K那样为未准入的key保存完整的值
+template<typename Key, typename Value>
+class ZPTinyLfuCache : public ZPCachePolicy<Key, Value>
+{
+public:
+    using NodeType = TinyLfuNode<Key, Value>;
+    using NodePtr = NodeType*;
+    using Region = typename NodeType::Region;
+    using NodeMap = ZPFlatHashMap<Key, NodePtr>;
+
+    explicit ZPTinyLfuCache(size_t capacity, double windowRatio = 0.01)
+        : capacity_(capacity)
+        , pool_(capacity + 7) // 三段链表各两个虚拟结点，外加窗口溢出时暂存的一个候选结点
+        , nodeMap_(capacity)
+        , sketch_(capacity)
+    {
+        window_.init(pool_);
+        probation_.init(pool_);
+        protected_.init(pool_);
+        resize(windowRatio);
+    }
+
+    ~ZPTinyLfuCache() override = default;
+
+    void put(Key key, Value value) override
+    {
+        if (capacity_ == 0)
+            return;
+
+        auto latency = counters_.timePut();
+        std::lock_guard<ZPMutex> lock(mutex_);
+        counters_.add(ZPCacheEvent::Put);
+        size_t hash = nodeMap_.hashOf(key);
+        sketch_.increment(hash);
+
+        auto it = nodeMap_.find(key, hash);
+        if (it != nodeMap_.end())
+        {
+            it->second->value_ = std::move(value);
+            onHit(it->second);
+            return;
+        }
+
+        NodePtr node = pool_.acquire();
+        node->key_ = key;
+        node->value_ = std::move(value);
+        node->region_ = Region::Window;
+        window_.pushBack(node);
+        nodeMap_[key] = node;
+
+        if (window_.size > windowCapacity_)
+            evictFromWindow();
+    }
+
+    bool get(Key key, Value& value) override
+    {
+        return visit(key, [&](const Value& cached) { value = cached; });
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    // 在锁内把缓存中的值直接交给visitor，不做拷贝；visitor中不能再访问本缓存
+    bool visit(const Key& key, const std::function<void(const Value&)>& visitor) override
+    {
+        auto latency = counters_.timeGet();
+        std::lock_guard<ZPMutex> lock(mutex_);
+        size_t hash = nodeMap_.hashOf(key);
+        sketch_.increment(hash); // 未命中的访问同样计入频次，这正是准入判断所需的信息
+
+        auto it = nodeMap_.find(key, hash);
+        if (it == nodeMap_.end())
+        {
+            counters_.add(ZPCacheEvent::Miss);
+            return false;
+        }
+        onHit(it->second);
+        visitor(it->second->value_);
+        counters_.add(ZPCacheEvent::Hit);
+        return true;
+    }
+
+    ZPCacheStats stats() const override
+    {
+        ZPCacheStats snapshot;
+        counters_.fill(snapshot);
+        return snapshot;
+    }
+
+    void enableLatencySampling(uint32_t sampleEvery) override { counters_.enableLatencySampling(sampleEvery); }
+
+    size_t sketchMemoryUsage() const { return sketch_.memoryUsage(); }
+
+    // value 是新的窗口比例（0~1）：窗口越大越偏向近期访问，越小越依赖频次准入。
+    // 各区超出新份额的部分立即按平时的规则处理：主区淘汰，窗口经准入判断离开，保护段降回试用段
+    bool setTuning(double value) override
+    {
+        std::lock_guard<ZPMutex> lock(mutex_);
+        if (capacity_ == 0)
+            return false;
+        resize(value);
+        while (probation_.size + protected_.size > mainCapacity_)
+            evict(probation_.size ? probation_.front() : protected_.front());
+        while (window_.size > windowCapacity_)
+            evictFromWindow();
+        while (protected_.size > protectedCapacity_)
+        {
+            NodePtr demoted = protected_.front();
+            protected_.remove(demoted);
+            demoted->region_ = Region::Probation;
+            probation_.pushBack(demoted);
+        }
+        return true;
+    }
+
+private:
+    // 带两个虚拟结点的双向链表，head后面是最旧的结点，新结点插在tail前
+    struct NodeList
+    {
+        NodePtr head = nullptr;
+        NodePtr tail = nullptr;
+        size_t  size = 0;
+
+        void init(ZPNodePool<NodeType>& pool)
+        {
+            head = pool.acquire();
+            tail = pool.acquire();
+            head->next_ = tail;
+            tail->prev_ = head;
+        }
+
+        NodePtr front() const { return size ? head->next_ : nullptr; }
+
+        void pushBack(NodePtr node)
+        {
+            node->next_ = tail;
+            node->prev_ = tail->prev_;
+            tail->prev_->next_ = node;
+            tail->prev_ = node;
+            ++size;
+        }
+
+        void remove(NodePtr node)
+        {
+            node->prev_->next_ = node->next_;
+            node->next_->prev_ = node->prev_;
+            node->prev_ = nullptr;
+            node->next_ = nullptr;
+            --size;
+        }
+
+        void moveToBack(NodePtr node)
+        {
+            remove(node);
+            pushBack(node);
+        }
+    };
+
+    void resize(double windowRatio)
+    {
+        windowRatio = std::clamp(windowRatio, 0.0, 1.0);
+        windowCapacity_ = std::max<size_t>(1, static_cast<size_t>(capacity_ * windowRatio));
+        windowCapacity_ = std::min(windowCapacity_, capacity_);
+        mainCapacity_ = capacity_ - windowCapacity_;
+        protectedCapacity_ = static_cast<size_t>(mainCapacity_ * 0.8);
+    }
+
+    void onHit(NodePtr node)
+    {
+        switch (node->region_)
+        {
+        case Region::Window:
+            window_.moveToBack(node);
+            break;
+        case Region::Probation:
+            // 试用段中再次被访问：升入保护段，保护段溢出时最旧的结点降回试用段
+            probation_.remove(node);
+            node->region_ = Region::Protected;
+            protected_.pushBack(node);
+            if (protected_.size > protectedCapacity_)
+            {
+                NodePtr demoted = protected_.front();
+                protected_.remove(demoted);
+                demoted->region_ = Region::Probation;
+                probation_.pushBack(demoted);
+            }
+            break;
+        case Region::Protected:
+            protected_.moveToBack(node);
+            break;
+        }
+    }
+
+    // 窗口中最旧的key离开窗口：主区未满直接进入试用段，否则与主区的淘汰对象比较频次
+    void evictFromWindow()
+    {
+        NodePtr candidate = window_.front();
+        window_.remove(candidate);
+
+        if (probation_.size + protected_.size < mainCapacity_)
+        {
+            candidate->region_ = Region::Probation;
+            probation_.pushBack(candidate);
+            return;
+        }
+
+        NodePtr victim = probation_.size ? probation_.front() : protected_.front();
+        if (victim && admit(candidate, victim))
+        {
+            evict(victim);
+            candidate->region_ = Region::Probation;
+            probation_.pushBack(candidate);
+            return;
+        }
+        evict(candidate);
+    }
+
+    // 频次相同时保留主区中的旧key，一次性扫描不会把主区冲掉
+    bool admit(NodePtr candidate, NodePtr victim) const
+    {
+        return sketch_.frequency(nodeMap_.hashOf(candidate->key_)) > sketch_.frequency(nodeMap_.hashOf(victim->key_));
+    }
+
+    // candidate 已不在任何链表中；victim 还在试用段或保护段中
+    void evict(NodePtr node)
+    {
+        if (node->next_)
+        {
+            if (node->region_ == Region::Probation)
+                probation_.remove(node);
+            else
+                protected_.remove(node);
+        }
+        nodeMap_.erase(node->key_);
+        node->value_ = Value();
+        pool_.release(node);
+        counters_.add(ZPCacheEvent::Eviction);
+    }
+
+private:
+    size_t                capacity_;
+    size_t                windowCapacity_ = 0;
+    size_t                mainCapacity_ = 0;
+    size_t                protectedCapacity_ = 0;
+    ZPNodePool<NodeType>  pool_;
+    NodeMap               nodeMap_;
+    ZPFrequencySketch     sketch_;
+    NodeList              window_;
+    NodeList              probation_;
+    NodeList              protected_;
+    ZPMutex               mutex_;
+    ZPCacheCounters       counters_;
+};
+
+} // namespace ZPCache
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ZPCache::bench
+{
+
+// 把当前线程绑定到 cpu 号核心上（按可用核心数取模），避免调度迁移干扰扩展性曲线。仅 Linux 生效，其余平台返回 false
+inline bool pinCurrentThread(size_t cpu)
+{
+#if defined(__linux__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0)
+        return false;
+
+    // 在进程允许的核心中选第 cpu % count 个，容器里可用核心未必从0开始编号
+    size_t target = cpu % static_cast<size_t>(CPU_COUNT(&allowed));
+    for (int core = 0; core < CPU_SETSIZE; ++core)
+    {
+        if (!CPU_ISSET(core, &allowed))
+            continue;
+        if (target-- == 0)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(core, &set);
+            return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+        }
+    }
+    return false;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// 基准测试专用的计时器，使用单调时钟并以纳秒为单位
+class Timer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Timer() : start_(Clock::now()) {}
+
+    void reset() { start_ = Clock::now(); }
+
+    uint64_t elapsedNs() const
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_).count());
+    }
+
+    double elapsedMs() const { return elapsedNs() / 1e6; }
+
+private:
+    Clock::time_point start_;
+};
+
+// Zipf(s) 分布采样，Hörmann & Derflinger 的 rejection-inversion 算法：
+// O(1) 内存、期望O(1)时间，键空间到 10M 以上也不需要预先计算CDF表。返回值范围 [0, n)，0 最热。
+class ZipfGenerator
+{
+public:
+    ZipfGenerator(uint64_t n, double skew)
+        : n_(n)
+        , skew_(skew)
+    {
+        hIntegralX1_ = hIntegral(1.5) - 1.0;
+        hIntegralN_ = hIntegral(n_ + 0.5);
+        s_ = 2.0 - hIntegralInverse(hIntegral(2.5) - h(2.0));
+    }
+
+    template<typename Engine>
+    uint64_t operator()(Engine& engine)
+    {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        for (;;)
+        {
+            double u = hIntegralN_ + uniform(engine) * (hIntegralX1_ - hIntegralN_);
+            double x = hIntegralInverse(u);
+            double k = std::floor(x + 0.5);
+            k = std::clamp(k, 1.0, static_cast<double>(n_));
+            if (k - x <= s_ || u >= hIntegral(k + 0.5) - h(k))
+                return static_cast<uint64_t>(k) - 1;
+        }
+    }
+
+private:
+    double h(double x) const { return std::exp(-skew_ * std::log(x)); }
+
+    double hIntegral(double x) const
+    {
+        double logX = std::log(x);
+        return helper2((1.0 - skew_) * logX) * logX;
+    }
+
+    double hIntegralInverse(double x) const
+    {
+        double t = std::max(x * (1.0 - skew_), -1.0);
+        return std::exp(helper1(t) * x);
+    }
+
+    // log1p(x)/x 与 expm1(x)/x，在 x 接近0时用泰勒展开保证 skew 接近1时的数值稳定
+    static double helper1(double x)
+    {
+        return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+    }
+
+    static double helper2(double x)
+    {
+        return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+    }
+
+private:
+    uint64_t n_;
+    double   skew_;
+    double   hIntegralX1_;
+    double   hIntegralN_;
+    double   s_;
+};
+
+// 一次压测要执行的操作序列，计时开始前全部生成好，计时区间内只剩缓存本身的开销
+struct OpStream
+{
+    std::vector<uint64_t> keys;
+    std::vector<uint8_t>  isPut;
+};
+
+// skew <= 0 时均匀分布；热度名次经固定置换打散到键空间，避免热点键恰好是连续整数
+inline OpStream makeOpStream(size_t opCount, uint64_t keySpace, double skew, double putRatio, uint64_t seed)
+{
+    OpStream stream;
+    stream.keys.resize(opCount);
+    stream.isPut.resize(opCount);
+
+    std::mt19937_64 engine(seed);
+    std::bernoulli_distribution putDist(putRatio);
+    if (skew > 0)
+    {
+        ZipfGenerator zipf(keySpace, skew);
+        for (size_t i = 0; i < opCount; ++i)
+            stream.keys[i] = (zipf(engine) * 0x9E3779B97F4A7C15ull) % keySpace;
+    }
+    else
+    {
+        std::uniform_int_distribution<uint64_t> uniform(0, keySpace - 1);
+        for (size_t i = 0; i < opCount; ++i)
+            stream.keys[i] = uniform(engine);
+    }
+    for (size_t i = 0; i < opCount; ++i)
+        stream.isPut[i] = putDist(engine);
+    return stream;
+}
+
+} // namespace ZPCache::bench
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ZPCACHE_HAS_MMAP 1
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+namespace ZPCache::bench
+{
+
+// 支持的 trace 格式：
+//   Binary     —— 连续的 little-endian uint64 key，全部视为读请求
+//   ArcText    —— ARC/OLTP 论文使用的文本格式，每行 "起始块号 块数 忽略 请求号"，一行展开成 块数 个读请求
+//   TwitterCsv —— Twitter cache-trace：timestamp,key,key_size,value_size,client_id,operation,TTL
+enum class TraceFormat
+{
+    Binary,
+    ArcText,
+    TwitterCsv
+};
+
+inline bool parseTraceFormat(std::string_view name, TraceFormat& format)
+{
+    if (name == "binary")
+        format = TraceFormat::Binary;
+    else if (name == "arc")
+        format = TraceFormat::ArcText;
+    else if (name == "twitter")
+        format = TraceFormat::TwitterCsv;
+    else
+        return false;
+    return true;
+}
+
+// 解码后的一批请求。所有策略重放同一个 chunk，解析只做一次
+struct TraceChunk
+{
+    std::vector<uint64_t> keys;
+    std::vector<uint8_t>  isPut; // 0 为读请求（未命中时回填），1 为写请求
+
+    size_t size() const { return keys.size(); }
+
+    void clear()
+    {
+        keys.clear();
+        isPut.clear();
+    }
+};
+
+// 只读映射整个文件，并提示内核按顺序预读；不支持 mmap 的平台退化为一次性读入内存
+class ZPMappedFile
+{
+public:
+    explicit ZPMappedFile(const std::string& path)
+    {
+#ifdef ZPCACHE_HAS_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("cannot open trace file: " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("cannot stat trace file: " + path);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0)
+        {
+            void* addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error("cannot mmap trace file: " + path);
+            }
+            ::madvise(addr, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(addr);
+        }
+        ::close(fd); // 映射建立后即可关闭描述符
+#else
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            throw std::runtime_error("cannot open trace file: " + path);
+        buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+#endif
+    }
+
+    ~ZPMappedFile()
+    {
+#ifdef ZPCACHE_HAS_MMAP
+        if (data_)
+            ::munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    ZPMappedFile(const ZPMappedFile&) = delete;
+    ZPMappedFile& operator=(const ZPMappedFile&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t      size_ = 0;
+#ifndef ZPCACHE_HAS_MMAP
+    std::vector<char> buffer_;
+#endif
+};
+
+// 在映射区上游标式解码，每次最多产出 maxRequests 个请求，整个 trace 不会被完整展开到内存中
+class ZPTraceReader
+{
+public:
+    ZPTraceReader(const std::string& path, TraceFormat format)
+        : file_(path)
+        , format_(format)
+        , cursor_(file_.data())
+        , end_(file_.data() + file_.size())
+    {}
+
+    // 清空并填充 chunk；返回 false 表示 trace 已读完
+    bool next(TraceChunk& chunk, size_t maxRequests)
+    {
+        chunk.clear();
+        switch (format_)
+        {
+        case TraceFormat::Binary:
+            decodeBinary(chunk, maxRequests);
+            break;
+        case TraceFormat::ArcText:
+            decodeArc(chunk, maxRequests);
+            break;
+        case TraceFormat::TwitterCsv:
+            decodeTwitter(chunk, maxRequests);
+            break;
+        }
+        return chunk.size() > 0;
+    }
+
+    size_t bytesTotal() const { return file_.size(); }
+    size_t bytesConsumed() const { return static_cast<size_t>(cursor_ - file_.data()); }
+
+private:
+    void push(TraceChunk& chunk, uint64_t key, bool isPut)
+    {
+        chunk.keys.push_back(key);
+        chunk.isPut.push_back(isPut);
+    }
+
+    void decodeBinary(TraceChunk& chunk, size_t maxRequests)
+    {
+        size_t available = static_cast<size_t>(end_ - cursor_) / sizeof(uint64_t);
+        size_t count = available < maxRequests ? available : maxRequests;
+        chunk.keys.resize(count);
+        if (count > 0)
+            std::memcpy(chunk.keys.data(), cursor_, count * sizeof(uint64_t)); // 映射区不保证8字节对齐，按字节拷贝
+        chunk.isPut.assign(count, 0);
+        cursor_ += count * sizeof(uint64_t);
+        if (count == available)
+            cursor_ = end_; // 丢弃末尾不足8字节的残片
+    }
+
+    void decodeArc(TraceChunk& chunk, size_t maxRequests)
+    {
+        while (chunk.size() < maxRequests)
+        {
+            // 上一行未展开完的块优先输出，一行可能跨越多个chunk
+            if (pendingBlocks_ > 0)
+            {
+                size_t room = maxRequests - chunk.size();
+                uint64_t n = pendingBlocks_ < room ? pendingBlocks_ : room;
+                for (uint64_t i = 0; i < n; ++i)
+                    push(chunk, nextBlock_++, false);
+                pendingBlocks_ -= n;
+                continue;
+            }
+            if (cursor_ >= end_)
+                break;
+
+            const char* lineEnd = findLineEnd();
+            uint64_t startBlock = 0, blockCount = 0;
+            const char* p = cursor_;
+            if (parseUnsigned(p, lineEnd, startBlock) && parseUnsigned(p, lineEnd, blockCount))
+            {
+                nextBlock_ = startBlock;
+                pendingBlocks_ = blockCount;
+            }
+            cursor_ = lineEnd < end_ ? lineEnd + 1 : end_;
+        }
+    }
+
+    void decodeTwitter(TraceChunk& chunk, size_t maxRequests)
+    {
+        while (chunk.size() < maxRequests && cursor_ < end_)
+        {
+            const char* lineEnd = findLineEnd();
+            std::string_view fields[7];
+            size_t fieldCount = splitCsv(cursor_, lineEnd, fields, 7);
+            cursor_ = lineEnd < end_ ? lineEnd + 1 : end_;
+            if (fieldCount < 6)
+                continue;
+
+            std::string_view op = fields[5];
+            bool isGet = op == "get" || op == "gets";
+            bool isSet = op == "set" || op == "add" || op == "replace" || op == "cas" || op == "append"
+                      || op == "prepend" || op == "incr" || op == "decr";
+            if (!isGet && !isSet)
+                continue; // delete 等操作与缓存替换无关，跳过
+            push(chunk, std::hash<std::string_view>()(fields[1]), isSet);
+        }
+    }
+
+    const char* findLineEnd() const
+    {
+        const void* nl = std::memchr(cursor_, '\n', static_cast<size_t>(end_ - cursor_));
+        return nl ? static_cast<const char*>(nl) : end_;
+    }
+
+    // 跳过前导空白后解析一个十进制数，p 前进到数字之后
+    static bool parseUnsigned(const char*& p, const char* end, uint64_t& value)
+    {
+        while (p < end && (*p == ' ' || *p == '\t'))
+            ++p;
+        if (p >= end || *p < '0' || *p > '9')
+            return false;
+        value = 0;
+        while (p < end && *p >= '0' && *p <= '9')
+            value = value * 10 + static_cast<uint64_t>(*p++ - '0');
+        return true;
+    }
+
+    static size_t splitCsv(const char* begin, const char* end, std::string_view* fields, size_t maxFields)
+    {
+        if (end > begin && end[-1] == '\r')
+            --end;
+        size_t count = 0;
+        const char* fieldBegin = begin;
+        for (const char* p = begin; p <= end && count < maxFields; ++p)
+        {
+            if (p == end || *p == ',')
+            {
+                fields[count++] = std::string_view(fieldBegin, static_cast<size_t>(p - fieldBegin));
+                fieldBegin = p + 1;
+            }
+        }
+        return count;
+    }
+
+private:
+    ZPMappedFile file_;
+    TraceFormat  format_;
+    const char*  cursor_;
+    const char*  end_;
+    uint64_t     nextBlock_ = 0;     // ArcText：当前行下一个要输出的块号
+    uint64_t     pendingBlocks_ = 0; // ArcText：当前行剩余未输出的块数
+};
+
+} // namespace ZPCache::bench
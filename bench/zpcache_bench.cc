@@ -0,0 +1,654 @@
+/*
+    zpcache_bench：各缓存策略的吞吐与延迟基准测试
+
+    用法: zpcache_bench [--capacities=1000,100000] [--threads=1,2,4] [--policies=LRU,ARC]
+                        [--workloads=get,put,mixed] [--ops=1000000] [--key-space=2.0]
+                        [--skew=0.99] [--mixed-put-ratio=0.1] [--sample-every=64] [--seed=42] [--csv]
+    竞争模式: zpcache_bench --contention [--shards=1,4,16] [--threads=...] [--capacities=100000] [--no-pin]
+    重放模式: zpcache_bench --trace=<file> --trace-format=binary|arc|twitter [--capacities=...] [--policies=...]
+                        [--trace-chunk=65536] [--csv]
+
+    所有随机数都来自固定种子，key序列在计时前生成完毕，同一参数的两次运行可以直接比较。
+    竞争模式下各线程绑核，以 mixed 负载测量扩展性与锁等待时间；锁等待需以 ZPCACHE_LOCK_PROFILING 编译。
+    重放模式下 trace 经 mmap 分块解码，每块依次交给所有 (策略, 容量) 组合，整个 trace 只读一遍。
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <latch>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ZPBenchHarness.h"
+#include "ZPTraceReader.h"
+#include "ZPAdaptiveCache.h"
+#include "ZPCachePolicy.h"
+#include "ZPCacheStats.h"
+#include "ZPConcurrentCache.h"
+#include "ZPLfuCache.h"
+#include "ZPLockProfiling.h"
+#include "ZPLruCache.h"
+#include "ZPShardedCache.h"
+#include "ZPSieveCache.h"
+#include "ZPStaticCache.h"
+#include "ZPTinyLfuCache.h"
+#include "zp-arcCache/ZPArcCache.h"
+
+using namespace ZPCache;
+using namespace ZPCache::bench;
+
+namespace
+{
+
+using Key = uint64_t;
+using Value = uint64_t;
+using Policy = ZPCachePolicy<Key, Value>;
+
+struct BenchConfig
+{
+    std::vector<size_t>      capacities = {1000, 100000, 1000000, 10000000};
+    std::vector<int>         threads;
+    std::vector<std::string> policies;   // 为空表示全部
+    std::vector<std::string> workloads = {"get", "put", "mixed"};
+    size_t                   opsPerThread = 1000000;
+    double                   keySpaceFactor = 2.0;  // 键空间 = 容量 * keySpaceFactor
+    double                   skew = 0.99;           // Zipf 参数，<= 0 为均匀分布
+    double                   mixedPutRatio = 0.1;
+    size_t                   sampleEvery = 64;      // 每隔多少次操作采样一次单次延迟
+    uint64_t                 seed = 42;
+    bool                     csv = false;
+    std::string              tracePath;            // 非空时进入 trace 重放模式
+    TraceFormat              traceFormat = TraceFormat::Binary;
+    size_t                   traceChunk = 65536;   // 每次解码的请求数
+    bool                     contention = false;   // 竞争/扩展性模式
+    bool                     capacitiesGiven = false;
+    std::vector<int>         shardCounts;          // 竞争模式下分片缓存要比较的分片数
+    bool                     pinThreads = true;
+};
+
+struct PolicyFactory
+{
+    std::string                                           name;
+    std::function<std::unique_ptr<Policy>(size_t capacity)> make;
+};
+
+struct BenchResult
+{
+    uint64_t           elapsedNs = 0;
+    uint64_t           totalOps = 0;
+    uint64_t           gets = 0;
+    uint64_t           hits = 0;
+    ZPLatencyHistogram latency;
+    ZPLockStats        locks;     // 所有工作线程的加锁统计之和
+};
+
+std::vector<PolicyFactory> allPolicies()
+{
+    int shards = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    return {
+        {"LRU", [](size_t c) { return std::make_unique<ZPLruCache<Key, Value>>(static_cast<int>(c)); }},
+        {"LRU-Buffered", [](size_t c) {
+             return std::make_unique<ZPLruCache<Key, Value>>(static_cast<int>(c), LruHitMode::Buffered);
+         }},
+        {"LRU-K", [](size_t c) {
+             return std::make_unique<ZPLruKCache<Key, Value>>(static_cast<int>(c), static_cast<int>(c), 2);
+         }},
+        {"LRU-K-Compact", [](size_t c) {
+             return std::make_unique<ZPLruKCache<Key, Value>>(static_cast<int>(c), static_cast<int>(c), 2,
+                                                              LruKHistoryMode::Compact);
+         }},
+        {"SLRU", [](size_t c) { return std::make_unique<ZPSlruCache<Key, Value>>(static_cast<int>(c)); }},
+        {"SIEVE", [](size_t c) { return std::make_unique<ZPSieveCache<Key, Value>>(c); }},
+        {"Concurrent-LRU", [](size_t c) { return std::make_unique<ZPConcurrentCache<Key, Value>>(c); }},
+        {"Concurrent-LFU", [](size_t c) {
+             return std::make_unique<ZPConcurrentCache<Key, Value>>(c, ZPSampledEviction::Lfu);
+         }},
+        {"LFU", [](size_t c) { return std::make_unique<ZPLfuCache<Key, Value>>(static_cast<int>(c)); }},
+        {"ARC", [](size_t c) { return std::make_unique<ZPArcCache<Key, Value>>(c); }},
+        {"Adaptive-ARC", [](size_t c) {
+             ZPAdaptiveOptions options;
+             options.initial = 1;
+             return std::make_unique<ZPAdaptiveCache<Key, Value, ZPArcCache>>(std::vector<double>{1, 2, 3, 4, 6, 8},
+                                                                                options, c);
+         }},
+        {"TinyLFU", [](size_t c) { return std::make_unique<ZPTinyLfuCache<Key, Value>>(c); }},
+        {"Static-LRU", [](size_t c) {
+             return std::make_unique<ZPStaticCacheAdapter<ZPStaticCache<Key, Value, ZPLruEviction, ZPAdmitAll, ZPMutex>>>(c);
+         }},
+        {"Sharded-LRU", [shards](size_t c) {
+             return std::make_unique<ZPShardedCache<Key, Value, ZPLruCache<Key, Value>>>(c, shards);
+         }},
+        {"Sharded-ARC", [shards](size_t c) { return std::make_unique<ZPShardedArcCache<Key, Value>>(c, shards); }},
+    };
+}
+
+std::vector<std::string> splitList(const std::string& text)
+{
+    std::vector<std::string> items;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty())
+            items.push_back(item);
+    }
+    return items;
+}
+
+std::vector<int> defaultThreadCounts()
+{
+    int hardware = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<int> counts;
+    for (int n = 1; n < hardware; n <<= 1)
+        counts.push_back(n);
+    counts.push_back(hardware);
+    return counts;
+}
+
+bool parseArgs(int argc, char** argv, BenchConfig& config)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string name = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        if (name == "--capacities")
+        {
+            config.capacities.clear();
+            for (const auto& item : splitList(value))
+                config.capacities.push_back(std::stoull(item));
+            config.capacitiesGiven = true;
+        }
+        else if (name == "--threads")
+        {
+            config.threads.clear();
+            for (const auto& item : splitList(value))
+                config.threads.push_back(std::stoi(item));
+        }
+        else if (name == "--policies")
+            config.policies = splitList(value);
+        else if (name == "--workloads")
+            config.workloads = splitList(value);
+        else if (name == "--ops")
+            config.opsPerThread = std::stoull(value);
+        else if (name == "--key-space")
+            config.keySpaceFactor = std::stod(value);
+        else if (name == "--skew")
+            config.skew = std::stod(value);
+        else if (name == "--mixed-put-ratio")
+            config.mixedPutRatio = std::stod(value);
+        else if (name == "--sample-every")
+            config.sampleEvery = std::max<size_t>(1, std::stoull(value));
+        else if (name == "--seed")
+            config.seed = std::stoull(value);
+        else if (name == "--csv")
+            config.csv = true;
+        else if (name == "--trace")
+            config.tracePath = value;
+        else if (name == "--contention")
+            config.contention = true;
+        else if (name == "--shards")
+        {
+            config.shardCounts.clear();
+            for (const auto& item : splitList(value))
+                config.shardCounts.push_back(std::stoi(item));
+        }
+        else if (name == "--no-pin")
+            config.pinThreads = false;
+        else if (name == "--trace-format")
+        {
+            if (!parseTraceFormat(value, config.traceFormat))
+            {
+                std::cerr << "unknown trace format: " << value << std::endl;
+                return false;
+            }
+        }
+        else if (name == "--trace-chunk")
+            config.traceChunk = std::max<size_t>(1, std::stoull(value));
+        else
+        {
+            std::cerr << "unknown option: " << arg << std::endl;
+            return false;
+        }
+    }
+    if (config.threads.empty())
+        config.threads = defaultThreadCounts();
+    if (config.shardCounts.empty())
+        config.shardCounts = {static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))};
+    return true;
+}
+
+double putRatioOf(const std::string& workload, const BenchConfig& config)
+{
+    if (workload == "get")
+        return 0.0;
+    if (workload == "put")
+        return 1.0;
+    return config.mixedPutRatio;
+}
+
+// 单线程预热：按同一分布写入 2 * capacity 次，让get负载从接近稳态的缓存开始
+void warmUp(Policy& cache, size_t capacity, uint64_t keySpace, const BenchConfig& config)
+{
+    OpStream warm = makeOpStream(capacity * 2, keySpace, config.skew, 1.0, config.seed ^ 0x5741524Dull);
+    for (Key key : warm.keys)
+        cache.put(key, key);
+}
+
+// 防止编译器把只读结果的get整体优化掉
+volatile uint64_t gBlackHole = 0;
+
+uint64_t nowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Timer::Clock::now().time_since_epoch()).count());
+}
+
+BenchResult runCase(Policy& cache, const std::vector<OpStream>& streams, size_t sampleEvery, bool pinThreads = false)
+{
+    size_t threadCount = streams.size();
+    std::vector<ZPLatencyHistogram> histograms(threadCount);
+    std::vector<ZPLockStats> lockStats(threadCount);
+    std::vector<uint64_t> gets(threadCount, 0), hits(threadCount, 0), sinks(threadCount, 0);
+    std::latch ready(static_cast<std::ptrdiff_t>(threadCount));
+    std::atomic<bool> go{false};
+
+    auto worker = [&](size_t t) {
+        const OpStream& stream = streams[t];
+        ZPLatencyHistogram& histogram = histograms[t];
+        uint64_t localGets = 0, localHits = 0, sink = 0;
+        Value value{};
+
+        if (pinThreads)
+            pinCurrentThread(t);
+        resetThreadLockStats();
+        ready.count_down();
+        while (!go.load(std::memory_order_acquire))
+            std::this_thread::yield();
+
+        for (size_t i = 0; i < stream.keys.size(); ++i)
+        {
+            // 只有被采样的操作才读时钟，其余操作的计时开销为零
+            bool sample = i % sampleEvery == 0;
+            uint64_t start = sample ? nowNs() : 0;
+            Key key = stream.keys[i];
+            if (stream.isPut[i])
+            {
+                cache.put(key, key);
+            }
+            else
+            {
+                ++localGets;
+                if (cache.get(key, value))
+                {
+                    ++localHits;
+                    sink += value;
+                }
+            }
+            if (sample)
+                histogram.record(nowNs() - start);
+        }
+        gets[t] = localGets;
+        hits[t] = localHits;
+        sinks[t] = sink;
+        lockStats[t] = threadLockStats();
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount);
+    for (size_t t = 0; t < threadCount; ++t)
+        workers.emplace_back(worker, t);
+
+    ready.wait();
+    Timer wall;
+    go.store(true, std::memory_order_release);
+    for (auto& w : workers)
+        w.join();
+
+    BenchResult result;
+    result.elapsedNs = wall.elapsedNs();
+    uint64_t sink = 0;
+    for (size_t t = 0; t < threadCount; ++t)
+    {
+        result.totalOps += streams[t].keys.size();
+        result.gets += gets[t];
+        result.hits += hits[t];
+        result.latency.merge(histograms[t]);
+        result.locks.acquisitions += lockStats[t].acquisitions;
+        result.locks.contended += lockStats[t].contended;
+        result.locks.waitNs += lockStats[t].waitNs;
+        sink += sinks[t];
+    }
+    gBlackHole = sink;
+    return result;
+}
+
+void printHeader(const BenchConfig& config)
+{
+    if (config.csv)
+    {
+        std::cout << "policy,workload,capacity,threads,ns_per_op,ops_per_sec,p50_ns,p99_ns,p999_ns,hit_rate" << std::endl;
+        return;
+    }
+    std::cout << "# seed=" << config.seed << " ops/thread=" << config.opsPerThread << " skew=" << config.skew
+              << " key-space=" << config.keySpaceFactor << "x capacity"
+              << " mixed-put-ratio=" << config.mixedPutRatio << std::endl;
+    std::cout << std::left << std::setw(16) << "policy" << std::setw(9) << "workload" << std::right
+              << std::setw(10) << "capacity" << std::setw(8) << "threads" << std::setw(10) << "ns/op"
+              << std::setw(14) << "ops/s" << std::setw(9) << "p50" << std::setw(9) << "p99"
+              << std::setw(9) << "p999" << std::setw(8) << "hit%" << std::endl;
+}
+
+// ns/op 是单个线程看到的平均每次操作耗时，ops/s 是所有线程合计的吞吐
+void printRow(const BenchConfig& config, const std::string& policy, const std::string& workload,
+              size_t capacity, int threads, const BenchResult& result)
+{
+    double seconds = result.elapsedNs / 1e9;
+    double opsPerSec = seconds > 0 ? result.totalOps / seconds : 0.0;
+    double nsPerOp = result.totalOps ? double(result.elapsedNs) * threads / result.totalOps : 0.0;
+    double hitRate = result.gets ? 100.0 * result.hits / result.gets : 0.0;
+
+    if (config.csv)
+    {
+        std::cout << policy << ',' << workload << ',' << capacity << ',' << threads << ',' << std::fixed
+                  << std::setprecision(2) << nsPerOp << ',' << std::setprecision(0) << opsPerSec << ','
+                  << result.latency.percentile(0.50) << ',' << result.latency.percentile(0.99) << ','
+                  << result.latency.percentile(0.999) << ',' << std::setprecision(2) << hitRate << std::endl;
+        return;
+    }
+    std::cout << std::left << std::setw(16) << policy << std::setw(9) << workload << std::right
+              << std::setw(10) << capacity << std::setw(8) << threads << std::fixed << std::setprecision(1)
+              << std::setw(10) << nsPerOp << std::setprecision(0) << std::setw(14) << opsPerSec
+              << std::setw(9) << result.latency.percentile(0.50) << std::setw(9)
+              << result.latency.percentile(0.99) << std::setw(9) << result.latency.percentile(0.999)
+              << std::setprecision(1) << std::setw(8) << hitRate << std::endl;
+}
+
+bool selected(const std::vector<std::string>& filter, const std::string& name)
+{
+    return filter.empty() || std::find(filter.begin(), filter.end(), name) != filter.end();
+}
+
+// 竞争模式要比较的策略：单锁的 LRU/LFU/ARC、无全局锁的 Concurrent-LRU，以及每个候选分片数下的分片 LRU（即 ZPhashLruCaches）与分片 ARC
+std::vector<PolicyFactory> contentionPolicies(const BenchConfig& config)
+{
+    std::vector<PolicyFactory> policies = {
+        {"LRU", [](size_t c) { return std::make_unique<ZPLruCache<Key, Value>>(static_cast<int>(c)); }},
+        {"LFU", [](size_t c) { return std::make_unique<ZPLfuCache<Key, Value>>(static_cast<int>(c)); }},
+        {"ARC", [](size_t c) { return std::make_unique<ZPArcCache<Key, Value>>(c); }},
+        {"Concurrent-LRU", [](size_t c) { return std::make_unique<ZPConcurrentCache<Key, Value>>(c); }},
+    };
+    for (int shards : config.shardCounts)
+    {
+        policies.push_back({"Sharded-LRU/" + std::to_string(shards), [shards](size_t c) {
+                                return std::make_unique<ZPhashLruCaches<Key, Value>>(c, shards);
+                            }});
+        policies.push_back({"Sharded-ARC/" + std::to_string(shards), [shards](size_t c) {
+                                return std::make_unique<ZPShardedArcCache<Key, Value>>(c, shards);
+                            }});
+    }
+    return policies;
+}
+
+// --policies 按名字中 '/' 之前的部分过滤，例如 Sharded-LRU 选中所有分片数
+bool selectedBase(const std::vector<std::string>& filter, const std::string& name)
+{
+    return selected(filter, name) || selected(filter, name.substr(0, name.find('/')));
+}
+
+// 每个策略在各线程数下跑同一份 mixed 负载；speedup 相对于该策略最少线程数的那一行，
+// lock-wait% 是所有线程等待锁的时间占 (墙钟时间 * 线程数) 的比例
+int runContention(const BenchConfig& config)
+{
+    std::vector<size_t> capacities = config.capacitiesGiven ? config.capacities : std::vector<size_t>{100000};
+    bool profiled =
+#ifdef ZPCACHE_LOCK_PROFILING
+        true;
+#else
+        false;
+#endif
+
+    if (config.csv)
+        std::cout << "policy,capacity,threads,ops_per_sec,speedup,efficiency,p99_ns,lock_wait_pct,contended_pct" << std::endl;
+    else
+    {
+        std::cout << "# contention: seed=" << config.seed << " ops/thread=" << config.opsPerThread
+                  << " skew=" << config.skew << " put-ratio=" << config.mixedPutRatio
+                  << " pinned=" << (config.pinThreads ? "yes" : "no")
+                  << (profiled ? "" : " (lock wait needs -DZPCACHE_LOCK_PROFILING)") << std::endl;
+        std::cout << std::left << std::setw(16) << "policy" << std::right << std::setw(10) << "capacity"
+                  << std::setw(8) << "threads" << std::setw(14) << "ops/s" << std::setw(9) << "speedup"
+                  << std::setw(8) << "eff%" << std::setw(9) << "p99" << std::setw(11) << "lockwait%"
+                  << std::setw(11) << "contended%" << std::endl;
+    }
+
+    for (size_t capacity : capacities)
+    {
+        uint64_t keySpace = std::max<uint64_t>(1, static_cast<uint64_t>(capacity * config.keySpaceFactor));
+        for (const PolicyFactory& factory : contentionPolicies(config))
+        {
+            if (!selectedBase(config.policies, factory.name))
+                continue;
+            double baseline = 0.0;
+            int baselineThreads = 0;
+            for (int threads : config.threads)
+            {
+                std::vector<OpStream> streams;
+                streams.reserve(threads);
+                for (int t = 0; t < threads; ++t)
+                {
+                    streams.push_back(makeOpStream(config.opsPerThread, keySpace, config.skew, config.mixedPutRatio,
+                                                   config.seed + 0x9E3779B9ull * (t + 1)));
+                }
+
+                std::unique_ptr<Policy> cache = factory.make(capacity);
+                warmUp(*cache, capacity, keySpace, config);
+                BenchResult result = runCase(*cache, streams, config.sampleEvery, config.pinThreads);
+
+                double opsPerSec = result.elapsedNs ? result.totalOps * 1e9 / result.elapsedNs : 0.0;
+                if (baselineThreads == 0)
+                {
+                    baseline = opsPerSec / threads;
+                    baselineThreads = threads;
+                }
+                double speedup = baseline > 0 ? opsPerSec / baseline : 0.0;
+                double efficiency = 100.0 * speedup / threads;
+                double lockWait = result.elapsedNs ? 100.0 * result.locks.waitNs / (double(result.elapsedNs) * threads) : 0.0;
+                double contended = result.locks.acquisitions ? 100.0 * result.locks.contended / result.locks.acquisitions : 0.0;
+
+                if (config.csv)
+                {
+                    std::cout << factory.name << ',' << capacity << ',' << threads << ',' << std::fixed
+                              << std::setprecision(0) << opsPerSec << ',' << std::setprecision(2) << speedup << ','
+                              << efficiency << ',' << result.latency.percentile(0.99) << ',';
+                    if (profiled)
+                        std::cout << lockWait << ',' << contended << std::endl;
+                    else
+                        std::cout << ',' << std::endl;
+                    continue;
+                }
+                std::cout << std::left << std::setw(16) << factory.name << std::right << std::setw(10) << capacity
+                          << std::setw(8) << threads << std::fixed << std::setprecision(0) << std::setw(14) << opsPerSec
+                          << std::setprecision(2) << std::setw(9) << speedup << std::setprecision(1) << std::setw(8)
+                          << efficiency << std::setw(9) << result.latency.percentile(0.99);
+                if (profiled)
+                    std::cout << std::setprecision(2) << std::setw(11) << lockWait << std::setw(11) << contended;
+                else
+                    std::cout << std::setw(11) << "n/a" << std::setw(11) << "n/a";
+                std::cout << std::endl;
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+struct ReplayTarget
+{
+    std::string             policy;
+    size_t                  capacity;
+    std::unique_ptr<Policy> cache;
+    uint64_t                requests = 0;
+    uint64_t                gets = 0;
+    uint64_t                hits = 0;
+    uint64_t                elapsedNs = 0;
+};
+
+// 读请求未命中时按需回填（demand fill），写请求直接写入
+void replayChunk(ReplayTarget& target, const TraceChunk& chunk)
+{
+    Policy& cache = *target.cache;
+    Value value{};
+    uint64_t gets = 0, hits = 0;
+    for (size_t i = 0; i < chunk.size(); ++i)
+    {
+        Key key = chunk.keys[i];
+        if (chunk.isPut[i])
+        {
+            cache.put(key, key);
+            continue;
+        }
+        ++gets;
+        if (cache.get(key, value))
+            ++hits;
+        else
+            cache.put(key, key);
+    }
+    target.requests += chunk.size();
+    target.gets += gets;
+    target.hits += hits;
+}
+
+int runTraceReplay(const BenchConfig& config)
+{
+    ZPTraceReader reader(config.tracePath, config.traceFormat);
+
+    std::vector<ReplayTarget> targets;
+    for (size_t capacity : config.capacities)
+    {
+        for (const PolicyFactory& factory : allPolicies())
+        {
+            if (selected(config.policies, factory.name))
+                targets.push_back({factory.name, capacity, factory.make(capacity)});
+        }
+    }
+
+    // 解码与重放分开计时：吞吐只统计缓存自身，解码成本单独报告
+    TraceChunk chunk;
+    uint64_t decodeNs = 0, totalRequests = 0;
+    for (;;)
+    {
+        Timer decodeTimer;
+        bool more = reader.next(chunk, config.traceChunk);
+        decodeNs += decodeTimer.elapsedNs();
+        if (!more)
+            break;
+        totalRequests += chunk.size();
+
+        for (ReplayTarget& target : targets)
+        {
+            Timer timer;
+            replayChunk(target, chunk);
+            target.elapsedNs += timer.elapsedNs();
+        }
+    }
+
+    if (config.csv)
+        std::cout << "policy,capacity,requests,hit_rate,ns_per_request,requests_per_sec" << std::endl;
+    else
+    {
+        std::cout << "# trace=" << config.tracePath << " bytes=" << reader.bytesTotal() << " requests=" << totalRequests
+                  << " decode=" << std::fixed << std::setprecision(1)
+                  << (decodeNs ? totalRequests * 1e3 / decodeNs : 0.0) << " Mreq/s" << std::endl;
+        std::cout << std::left << std::setw(16) << "policy" << std::right << std::setw(10) << "capacity"
+                  << std::setw(14) << "requests" << std::setw(8) << "hit%" << std::setw(10) << "ns/req"
+                  << std::setw(14) << "req/s" << std::endl;
+    }
+    for (const ReplayTarget& target : targets)
+    {
+        double hitRate = target.gets ? 100.0 * target.hits / target.gets : 0.0;
+        double nsPerRequest = target.requests ? double(target.elapsedNs) / target.requests : 0.0;
+        double perSec = target.elapsedNs ? target.requests * 1e9 / target.elapsedNs : 0.0;
+        if (config.csv)
+        {
+            std::cout << target.policy << ',' << target.capacity << ',' << target.requests << ',' << std::fixed
+                      << std::setprecision(2) << hitRate << ',' << nsPerRequest << ',' << std::setprecision(0)
+                      << perSec << std::endl;
+            continue;
+        }
+        std::cout << std::left << std::setw(16) << target.policy << std::right << std::setw(10) << target.capacity
+                  << std::setw(14) << target.requests << std::fixed << std::setprecision(2) << std::setw(8)
+                  << hitRate << std::setprecision(1) << std::setw(10) << nsPerRequest << std::setprecision(0)
+                  << std::setw(14) << perSec << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    BenchConfig config;
+    if (!parseArgs(argc, argv, config))
+        return EXIT_FAILURE;
+
+    if (config.contention)
+        return runContention(config);
+
+    if (!config.tracePath.empty())
+    {
+        try
+        {
+            return runTraceReplay(config);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    printHeader(config);
+    std::vector<PolicyFactory> policies = allPolicies();
+
+    for (size_t capacity : config.capacities)
+    {
+        uint64_t keySpace = std::max<uint64_t>(1, static_cast<uint64_t>(capacity * config.keySpaceFactor));
+        for (const std::string& workload : config.workloads)
+        {
+            double putRatio = putRatioOf(workload, config);
+            for (int threads : config.threads)
+            {
+                // 每个线程一条独立的序列，种子由 (seed, 线程号) 决定，与策略无关，所有策略重放完全相同的操作
+                std::vector<OpStream> streams;
+                streams.reserve(threads);
+                for (int t = 0; t < threads; ++t)
+                {
+                    streams.push_back(makeOpStream(config.opsPerThread, keySpace, config.skew, putRatio,
+                                                   config.seed + 0x9E3779B9ull * (t + 1)));
+                }
+
+                for (const PolicyFactory& factory : policies)
+                {
+                    if (!selected(config.policies, factory.name))
+                        continue;
+                    std::unique_ptr<Policy> cache = factory.make(capacity);
+                    warmUp(*cache, capacity, keySpace, config);
+                    BenchResult result = runCase(*cache, streams, config.sampleEvery);
+                    printRow(config, factory.name, workload, capacity, threads, result);
+                }
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,455 @@
+/*
+    zpcache_examples：不依赖策略对比的组件用法示例，每个示例同时检查结果
+
+    用法: zpcache_examples
+
+    每个示例打印一行 ok 或 FAILED 及原因，任一示例失败时返回非0。
+    后端存储用进程内的 std::map 模拟，文件层写在系统临时目录下，集群节点是同一进程内的 ZPClusterServer，示例只依赖标准库。
+*/
+
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include "ZPBackingStore.h"
+#include "ZPCluster.h"
+#include "ZPLruCache.h"
+#include "ZPTieredCache.h"
+
+namespace
+{
+
+using namespace ZPCache;
+
+// 示例失败时记下原因，由 main 统一打印
+struct ExampleResult
+{
+    bool        ok = true;
+    std::string reason;
+
+    void check(bool condition, const std::string& what)
+    {
+        if (!condition && ok)
+        {
+            ok = false;
+            reason = what;
+        }
+    }
+};
+
+// 模拟的慢速后端：记录每次批量写入的条目数
+class MapStore
+{
+public:
+    ZPBackingStore<int, std::string> backing(ZPWriteMode mode, const ZPWriteBehindOptions& options = {})
+    {
+        ZPBackingStore<int, std::string> store;
+        store.loader = [this](const int& key) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = data_.find(key);
+            if (it == data_.end())
+                throw std::out_of_range("missing key");
+            return it->second;
+        };
+        store.writer = [this](std::span<const std::pair<int, std::string>> entries) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batches_.push_back(entries.size());
+            for (const auto& [key, value] : entries)
+                data_[key] = value;
+        };
+        store.mode = mode;
+        store.writeBehind = options;
+        return store;
+    }
+
+    bool holds(int key, const std::string& value) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = data_.find(key);
+        return it != data_.end() && it->second == value;
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return data_.size();
+    }
+
+    size_t batches() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return batches_.size();
+    }
+
+private:
+    mutable std::mutex         mutex_;
+    std::map<int, std::string> data_;
+    std::vector<size_t>        batches_;
+};
+
+// 写回：put 只进内存与队列，flush 之后后端看到合并过的批量写；淘汰出缓存的key读穿回后端
+ExampleResult writeBehindFlush()
+{
+    ExampleResult result;
+    MapStore store;
+    ZPWriteBehindOptions options;
+    options.maxBatch = 64;
+    options.flushInterval = std::chrono::milliseconds(10);
+    ZPBackedCache<int, std::string> cache(store.backing(ZPWriteMode::WriteBehind, options), 100);
+
+    const int keys = 1000;
+    for (int round = 0; round < 2; ++round)
+    {
+        for (int key = 0; key < keys; ++key)
+            cache.put(key, "v" + std::to_string(key) + "_" + std::to_string(round));
+    }
+    cache.flush();
+
+    result.check(store.size() == keys, "flush 之后后端缺少条目");
+    result.check(store.holds(0, "v0_1") && store.holds(keys - 1, "v" + std::to_string(keys - 1) + "_1"),
+                 "后端不是最后一次写入的值");
+    result.check(cache.writtenEntries() <= 2 * keys && cache.failedBatches() == 0, "写回计数异常");
+    result.check(store.batches() < 2 * keys, "写回没有合并成批");
+
+    // 容量只有100，key 0 早已被淘汰，读穿从后端取回
+    std::string value;
+    result.check(cache.get(0, value) && value == "v0_1", "读穿没有取回已淘汰的key");
+    result.check(!cache.get(keys + 1, value), "后端没有的key不应命中");
+    return result;
+}
+
+// 析构时写出全部积压：flushInterval 很长、一批也没攒满，也不会丢失
+ExampleResult writeBehindShutdown()
+{
+    ExampleResult result;
+    MapStore store;
+    ZPWriteBehindOptions options;
+    options.maxBatch = 4096;
+    options.flushInterval = std::chrono::seconds(30);
+    {
+        ZPBackedCache<int, std::string> cache(store.backing(ZPWriteMode::WriteBehind, options), 16);
+        for (int key = 0; key < 500; ++key)
+            cache.put(key, std::to_string(key));
+    }
+    result.check(store.size() == 500 && store.holds(499, "499"), "析构时没有写出积压");
+    return result;
+}
+
+// 写穿：后端失败时异常交给 put 的调用者，缓存保持原值
+ExampleResult writeThroughFailure()
+{
+    ExampleResult result;
+    MapStore store;
+    ZPBackingStore<int, std::string> backing = store.backing(ZPWriteMode::WriteThrough);
+    auto write = std::move(backing.writer);
+    backing.writer = [write](std::span<const std::pair<int, std::string>> entries) {
+        if (entries.front().first < 0)
+            throw std::runtime_error("rejected");
+        write(entries);
+    };
+    ZPBackedCache<int, std::string> cache(std::move(backing), 16);
+
+    cache.put(1, "one");
+    result.check(store.holds(1, "one"), "写穿没有立即写到后端");
+    bool threw = false;
+    try
+    {
+        cache.put(-1, "bad");
+    }
+    catch (const std::runtime_error&)
+    {
+        threw = true;
+    }
+    std::string value;
+    result.check(threw, "后端失败没有交给调用者");
+    result.check(!cache.cache().get(-1, value), "后端失败时缓存不应改变");
+    return result;
+}
+
+// 读穿与 put 并发：加载读到旧值期间有 put 写入新值，加载结束后缓存里仍是新值
+ExampleResult readThroughRace()
+{
+    ExampleResult result;
+    MapStore store;
+    ZPBackingStore<int, std::string> backing = store.backing(ZPWriteMode::WriteThrough);
+    backing.writer(std::vector<std::pair<int, std::string>>{{1, "old"}});
+    std::promise<void> loaded;
+    std::promise<void> resume;
+    std::shared_future<void> resumed = resume.get_future().share();
+    auto load = std::move(backing.loader);
+    backing.loader = [&, load](const int& key) {
+        std::string value = load(key);
+        loaded.set_value();
+        resumed.wait();
+        return value;
+    };
+    ZPBackedCache<int, std::string> cache(std::move(backing), 16);
+
+    std::string loadedValue;
+    std::thread reader([&] { cache.get(1, loadedValue); });
+    loaded.get_future().wait();
+    cache.put(1, "new");
+    resume.set_value();
+    reader.join();
+
+    std::string value;
+    result.check(loadedValue == "old", "加载没有读到旧值");
+    result.check(cache.get(1, value) && value == "new", "加载结果覆盖了并发 put 写入的新值");
+    result.check(store.holds(1, "new"), "后端不是最后一次写入的值");
+    return result;
+}
+
+// 两级缓存：内存层只放100条，其余条目降级到文件层，读取时原样提升回内存层
+ExampleResult tieredRoundTrip()
+{
+    ExampleResult result;
+    ZPFileTierOptions tierOptions;
+    std::filesystem::path directory =
+        std::filesystem::temp_directory_path() / ("zpcache_examples-" + std::to_string(::getpid()));
+    tierOptions.directory = directory.string();
+    tierOptions.segmentBytes = 64 << 10;
+    tierOptions.writeBufferBytes = 4 << 10;
+    tierOptions.maxSegments = 4;
+    {
+        ZPTieredCache<int, std::string> cache(tierOptions, 100);
+        result.check(cache.demoting() && cache.tier().ok(), "文件层没有启用");
+
+        const int keys = 1000;
+        for (int key = 0; key < keys; ++key)
+            cache.put(key, "value-" + std::to_string(key));
+        result.check(cache.demotions() == keys - 100, "被淘汰的条目没有全部降级");
+
+        // 依次读回：每次提升又会把内存层最久未访问的条目降级，条目在两层之间来回，但不会丢失
+        std::string value;
+        int matched = 0;
+        for (int key = 0; key < keys; ++key)
+            matched += cache.get(key, value) && value == "value-" + std::to_string(key);
+        result.check(matched == keys, "降级后读回的值不一致");
+        result.check(cache.promotions() >= keys - 100, "没有从文件层提升");
+
+        // 覆盖写入后文件层中的旧记录作废，之后读到的是新值
+        cache.put(0, "rewritten");
+        for (int key = keys; key < keys + 200; ++key)
+            cache.put(key, "value-" + std::to_string(key));
+        result.check(cache.get(0, value) && value == "rewritten", "读到了文件层的旧值");
+
+        // 写满段数上限后最旧的段整段回收，其中的条目变为未命中
+        std::string large(1000, 'x');
+        for (int key = 0; key < 2000; ++key)
+            cache.put(100000 + key, large);
+        ZPFileTierStats tierStats = cache.tier().stats();
+        result.check(tierStats.droppedSegments > 0 && tierStats.segments <= tierOptions.maxSegments,
+                     "段数超过上限时没有回收");
+        result.check(!cache.get(100000, value), "已回收段中的条目不应命中");
+    }
+
+    // 析构时删除全部段文件
+    std::error_code error;
+    result.check(std::filesystem::is_empty(directory, error), "析构后仍留有段文件");
+    std::filesystem::remove_all(directory, error);
+    return result;
+}
+
+// 带TTL的条目降级后仍按原来的到期时间失效，未到期的提升回内存层时保留剩余TTL
+ExampleResult tieredTtl()
+{
+    ExampleResult result;
+    ZPFileTierOptions tierOptions;
+    std::filesystem::path directory =
+        std::filesystem::temp_directory_path() / ("zpcache_examples-ttl-" + std::to_string(::getpid()));
+    tierOptions.directory = directory.string();
+    {
+        ZPTieredCache<int, std::string> cache(tierOptions, 10);
+        cache.put(1, "short-lived", std::chrono::milliseconds(50));
+        cache.put(2, "long-lived", std::chrono::hours(1));
+        for (int key = 100; key < 110; ++key)
+            cache.put(key, "filler");
+        result.check(cache.demotions() == 2, "带TTL的条目没有降级");
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        std::string value;
+        result.check(!cache.get(1, value), "降级后已到期的条目仍然命中");
+        result.check(cache.tier().stats().expired == 1, "文件层没有丢弃到期记录");
+        result.check(cache.get(2, value) && value == "long-lived", "未到期的条目没有提升");
+        std::optional<std::chrono::nanoseconds> ttl = cache.timeToLive(2);
+        result.check(ttl && *ttl > std::chrono::minutes(59) && *ttl <= std::chrono::hours(1),
+                     "提升后没有保留剩余TTL");
+    }
+
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    return result;
+}
+
+// 进程内的集群：每个节点一个本地LRU和一个 ZPClusterServer，传输层直接调用 handle，并按节点统计收到的帧
+class LocalCluster
+{
+public:
+    void addNode(uint32_t node) { nodes_[node] = std::make_unique<Node>(); }
+
+    // 节点不存在或被标记为故障时发送失败
+    ZPClusterTransport transport()
+    {
+        return [this](uint32_t node, std::vector<char> frame) {
+            auto it = nodes_.find(node);
+            if (it == nodes_.end() || it->second->down)
+                throw std::runtime_error("node unreachable");
+            ++it->second->frames;
+            std::promise<std::vector<char>> reply;
+            reply.set_value(it->second->server.handle(frame));
+            return reply.get_future();
+        };
+    }
+
+    ZPLruCache<int, std::string>& cache(uint32_t node) { return nodes_.at(node)->cache; }
+    ZPClusterServer<int, std::string>& server(uint32_t node) { return nodes_.at(node)->server; }
+    size_t frames(uint32_t node) const { return nodes_.at(node)->frames; }
+    void setDown(uint32_t node, bool down) { nodes_.at(node)->down = down; }
+
+    size_t totalFrames() const
+    {
+        size_t total = 0;
+        for (const auto& [node, state] : nodes_)
+            total += state->frames;
+        return total;
+    }
+
+private:
+    struct Node
+    {
+        ZPLruCache<int, std::string>      cache{10000};
+        ZPClusterServer<int, std::string> server{cache};
+        size_t                            frames = 0;
+        bool                              down = false;
+    };
+
+    std::map<uint32_t, std::unique_ptr<Node>> nodes_;
+};
+
+// 集群客户端：批量读写每个节点只发一帧；加入节点只移动约 1/N 的key；热点key由近端缓存应答
+ExampleResult clusterRouting()
+{
+    ExampleResult result;
+    LocalCluster cluster;
+    ZPClusterOptions options;
+    options.hotThreshold = 4;
+    ZPClusterClient<int, std::string> client(cluster.transport(), options);
+    for (uint32_t node = 1; node <= 3; ++node)
+    {
+        cluster.addNode(node);
+        client.addNode(node);
+    }
+
+    const int keys = 3000;
+    std::vector<int> keyList(keys);
+    std::vector<std::string> values(keys);
+    for (int key = 0; key < keys; ++key)
+    {
+        keyList[key] = key;
+        values[key] = "node-value-" + std::to_string(key);
+    }
+
+    // Put 帧：三个节点各收到一帧，每个key只写在环指定的节点上
+    client.putMany(keyList, values);
+    result.check(cluster.totalFrames() == 3, "批量写入没有按节点合并成帧");
+    int placed = 0;
+    for (int key = 0; key < keys; ++key)
+    {
+        std::string value;
+        placed += cluster.cache(*client.nodeFor(key)).get(key, value) && value == values[key];
+    }
+    result.check(placed == keys, "key没有写到环指定的节点");
+
+    // Get 帧：同样每个节点一帧，应答按请求顺序与key配对
+    std::vector<std::string> read(keys);
+    std::vector<bool> hits;
+    size_t hitCount = client.getMany(keyList, read, hits);
+    result.check(cluster.totalFrames() == 6, "批量读取没有按节点合并成帧");
+    result.check(hitCount == static_cast<size_t>(keys) && read == values, "批量读取的值不一致");
+
+    std::string value;
+    result.check(!client.get(keys + 1, value), "没有写入过的key不应命中");
+
+    // 无法解析的请求得到 Error 应答
+    std::vector<char> garbage(8, 'x');
+    std::vector<char> reply = cluster.server(1).handle(garbage);
+    ZPSnapshotReader in(reply.data(), reply.size());
+    ZPClusterFrameHeader header;
+    result.check(in.read(header) && header.valid(ZPClusterOp::Error), "无法解析的请求没有得到 Error 应答");
+
+    // 热点key：频次达到阈值后由近端缓存应答，不再每次都发往节点
+    size_t before = cluster.totalFrames();
+    for (int i = 0; i < 100; ++i)
+        client.get(7, value);
+    result.check(client.clusterStats().nearHits > 0 && cluster.totalFrames() - before < 20, "热点key没有进入近端缓存");
+
+    // 加入第4个节点：换节点的key都换到新节点上，比例约为 1/4
+    std::vector<uint32_t> owners(keys);
+    for (int key = 0; key < keys; ++key)
+        owners[key] = *client.nodeFor(key);
+    cluster.addNode(4);
+    client.addNode(4);
+    int moved = 0;
+    bool movedToNewNode = true;
+    for (int key = 0; key < keys; ++key)
+    {
+        uint32_t owner = *client.nodeFor(key);
+        if (owner != owners[key])
+        {
+            ++moved;
+            movedToNewNode = movedToNewNode && owner == 4;
+        }
+    }
+    result.check(movedToNewNode, "加入节点时有key在旧节点之间移动");
+    result.check(moved > keys / 8 && moved < keys * 3 / 8, "加入节点后移动的key比例偏离 1/4 太多");
+
+    // 节点故障：发往它的key按未命中处理并计入 failedRequests，其余节点照常应答
+    cluster.setDown(1, true);
+    hitCount = client.getMany(keyList, read, hits);
+    result.check(hitCount > 0 && hitCount < static_cast<size_t>(keys), "节点故障时其余节点应照常应答");
+    result.check(client.clusterStats().failedRequests > 0, "发送失败没有计入 failedRequests");
+    return result;
+}
+
+struct Example
+{
+    const char* name;
+    ExampleResult (*run)();
+};
+
+} // namespace
+
+int main()
+{
+    const Example examples[] = {
+        {"write-behind flush", writeBehindFlush},
+        {"write-behind shutdown", writeBehindShutdown},
+        {"write-through failure", writeThroughFailure},
+        {"read-through race", readThroughRace},
+        {"tiered demote/promote", tieredRoundTrip},
+        {"tiered ttl", tieredTtl},
+        {"cluster routing", clusterRouting},
+    };
+
+    int failed = 0;
+    for (const Example& example : examples)
+    {
+        ExampleResult result = example.run();
+        std::cout << example.name << ": " << (result.ok ? "ok" : "FAILED (" + result.reason + ")") << std::endl;
+        failed += !result.ok;
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -7,49 +7,37 @@
 
 #include <iostream>
 #include <string>
-#include <chrono>
 #include <vector>
 #include <iomanip>
 #include <random>
 #include <algorithm>
+#include <array>
+#include <unordered_map>
 
 #include <fmt/base.h>
 
+#include "ZPAdaptiveCache.h"
 #include "ZPCachePolicy.h"
+#include "ZPConcurrentCache.h"
+#include "ZPFlatHashMap.h"
 #include "ZPLfuCache.h"
 #include "ZPLruCache.h"
+#include "ZPShardedCache.h"
+#include "ZPSieveCache.h"
+#include "ZPTinyLfuCache.h"
 #include "zp-arcCache/ZPArcCache.h"
 
-class Timer {
-public:
-    Timer() : start_(std::chrono::high_resolution_clock::now()) {}
-    
-    double elapsed() {
-        auto now = std::chrono::high_resolution_clock::now();
-        return std::chrono::duration_cast<std::chrono::milliseconds>(now - start_).count();
-    }
-
-private:
-    std::chrono::time_point<std::chrono::high_resolution_clock> start_;
-};
+// 固定种子：每个算法重放完全相同的访问序列，多次运行的结果也可以直接比较（性能数据见 bench/zpcache_bench）
+constexpr unsigned kWorkloadSeed = 20240601;
 
 // 辅助函数：打印结果
 void printResults(const std::string& testName, int capacity, 
+                 const std::vector<std::string>& names,
                  const std::vector<int>& get_operations, 
                  const std::vector<int>& hits) {
     std::cout << "=== " << testName << " 结果汇总 ===" << std::endl;
     std::cout << "缓存大小: " << capacity << std::endl;
     
-    // 假设对应的算法名称已在测试函数中定义
-    std::vector<std::string> names;
-    if (hits.size() == 3) {
-        names = {"LRU", "LFU", "ARC"};
-    } else if (hits.size() == 4) {
-        names = {"LRU", "LFU", "ARC", "LRU-K"};
-    } else if (hits.size() == 5) {
-        names = {"LRU", "LFU", "ARC", "LRU-K", "LFU-Aging"};
-    }
-    
     for (size_t i = 0; i < hits.size(); ++i) {
         double hitRate = 100.0 * hits[i] / get_operations[i];
         std::cout << (i < names.size() ? names[i] : "Algorithm " + std::to_string(i+1)) 
@@ -69,6 +57,7 @@ void testHotDataAccess() {
     const int OPERATIONS = 500000;   // 总操作次数
     const int HOT_KEYS = 20;         // 热点数据数量
     const int COLD_KEYS = 5000;      // 冷数据数量
+    const int SHARDS = 4;            // 分片LRU的分片数
     
     ZPCache::ZPLruCache<int, std::string> lru(CAPACITY);
     ZPCache::ZPLfuCache<int, std::string> lfu(CAPACITY);
@@ -79,18 +68,22 @@ void testHotDataAccess() {
     // - k=2表示数据被访问2次后才会进入缓存，适合区分热点和冷数据
     ZPCache::ZPLruKCache<int, std::string> lruk(CAPACITY, HOT_KEYS + COLD_KEYS, 2);
     ZPCache::ZPLfuCache<int, std::string> lfuAging(CAPACITY, 20000);
+    ZPCache::ZPShardedCache<int, std::string, ZPCache::ZPLruCache<int, std::string>> shardedLru(CAPACITY, SHARDS);
+    ZPCache::ZPTinyLfuCache<int, std::string> tinyLfu(CAPACITY);
+    ZPCache::ZPSlruCache<int, std::string> slru(CAPACITY);
+    ZPCache::ZPSieveCache<int, std::string> sieve(CAPACITY);
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937 gen;
     
     // 基类指针指向派生类对象，添加LFU-Aging
-    std::array<ZPCache::ZPCachePolicy<int, std::string>*, 5> caches = {&lru, &lfu, &arc, &lruk, &lfuAging};
-    std::vector<int> hits(5, 0);
-    std::vector<int> get_operations(5, 0);
-    std::vector<std::string> names = {"LRU", "LFU", "ARC", "LRU-K", "LFU-Aging"};
+    std::array<ZPCache::ZPCachePolicy<int, std::string>*, 9> caches = {&lru, &lfu, &arc, &lruk, &lfuAging, &shardedLru, &tinyLfu, &slru, &sieve};
+    std::vector<int> hits(9, 0);
+    std::vector<int> get_operations(9, 0);
+    std::vector<std::string> names = {"LRU", "LFU", "ARC", "LRU-K", "LFU-Aging", "Sharded-LRU", "W-TinyLFU", "SLRU", "SIEVE"};
 
     // 为所有的缓存对象进行相同的操作序列测试
     for (int i = 0; i < caches.size(); ++i) {
+        gen.seed(kWorkloadSeed);
         // 先预热缓存，插入一些数据
         for (int key = 0; key < HOT_KEYS; ++key) {
             std::string value = "value" + std::to_string(key);
@@ -127,7 +120,7 @@ void testHotDataAccess() {
     }
 
     // 打印测试结果
-    printResults("热点数据访问测试", CAPACITY, get_operations, hits);
+    printResults("热点数据访问测试", CAPACITY, names, get_operations, hits);
 }
 
 void testLoopPattern() {
@@ -136,6 +129,7 @@ void testLoopPattern() {
     const int CAPACITY = 50;          // 缓存容量
     const int LOOP_SIZE = 500;        // 循环范围大小
     const int OPERATIONS = 200000;    // 总操作次数
+    const int SHARDS = 4;             // 分片LRU的分片数
     
     ZPCache::ZPLruCache<int, std::string> lru(CAPACITY);
     ZPCache::ZPLfuCache<int, std::string> lfu(CAPACITY);
@@ -145,17 +139,21 @@ void testLoopPattern() {
     // - k=2，对于循环访问，这是一个合理的阈值
     ZPCache::ZPLruKCache<int, std::string> lruk(CAPACITY, LOOP_SIZE * 2, 2);
     ZPCache::ZPLfuCache<int, std::string> lfuAging(CAPACITY, 3000);
+    ZPCache::ZPShardedCache<int, std::string, ZPCache::ZPLruCache<int, std::string>> shardedLru(CAPACITY, SHARDS);
+    ZPCache::ZPTinyLfuCache<int, std::string> tinyLfu(CAPACITY);
+    ZPCache::ZPSlruCache<int, std::string> slru(CAPACITY);
+    ZPCache::ZPSieveCache<int, std::string> sieve(CAPACITY);
 
-    std::array<ZPCache::ZPCachePolicy<int, std::string>*, 5> caches = {&lru, &lfu, &arc, &lruk, &lfuAging};
-    std::vector<int> hits(5, 0);
-    std::vector<int> get_operations(5, 0);
-    std::vector<std::string> names = {"LRU", "LFU", "ARC", "LRU-K", "LFU-Aging"};
+    std::array<ZPCache::ZPCachePolicy<int, std::string>*, 9> caches = {&lru, &lfu, &arc, &lruk, &lfuAging, &shardedLru, &tinyLfu, &slru, &sieve};
+    std::vector<int> hits(9, 0);
+    std::vector<int> get_operations(9, 0);
+    std::vector<std::string> names = {"LRU", "LFU", "ARC", "LRU-K", "LFU-Aging", "Sharded-LRU", "W-TinyLFU", "SLRU", "SIEVE"};
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937 gen;
 
     // 为每种缓存算法运行相同的测试
     for (int i = 0; i < caches.size(); ++i) {
+        gen.seed(kWorkloadSeed);
         // 先预热一部分数据（只加载20%的数据）
         for (int key = 0; key < LOOP_SIZE / 5; ++key) {
             std::string value = "loop" + std::to_string(key);
@@ -196,7 +194,7 @@ void testLoopPattern() {
         }
     }
 
-    printResults("循环扫描测试", CAPACITY, get_operations, hits);
+    printResults("循环扫描测试", CAPACITY, names, get_operations, hits);
 }
 
 void testWorkloadShift() {
@@ -205,22 +203,31 @@ void testWorkloadShift() {
     const int CAPACITY = 30;            // 缓存容量
     const int OPERATIONS = 80000;       // 总操作次数
     const int PHASE_LENGTH = OPERATIONS / 5;  // 每个阶段的长度
+    const int SHARDS = 4;               // 分片LRU的分片数
     
     ZPCache::ZPLruCache<int, std::string> lru(CAPACITY);
     ZPCache::ZPLfuCache<int, std::string> lfu(CAPACITY);
     ZPCache::ZPArcCache<int, std::string> arc(CAPACITY);
     ZPCache::ZPLruKCache<int, std::string> lruk(CAPACITY, 500, 2);
     ZPCache::ZPLfuCache<int, std::string> lfuAging(CAPACITY, 10000);
+    ZPCache::ZPShardedCache<int, std::string, ZPCache::ZPLruCache<int, std::string>> shardedLru(CAPACITY, SHARDS);
+    ZPCache::ZPTinyLfuCache<int, std::string> tinyLfu(CAPACITY);
+    ZPCache::ZPSlruCache<int, std::string> slru(CAPACITY);
+    ZPCache::ZPSieveCache<int, std::string> sieve(CAPACITY);
+    // 在线调整ARC的转换阈值，从默认的2开始
+    ZPCache::ZPAdaptiveOptions adaptiveOptions;
+    adaptiveOptions.initial = 1;
+    ZPCache::ZPAdaptiveCache<int, std::string, ZPCache::ZPArcCache> adaptiveArc({1, 2, 3, 4, 6, 8}, adaptiveOptions, size_t(CAPACITY));
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::array<ZPCache::ZPCachePolicy<int, std::string>*, 5> caches = {&lru, &lfu, &arc, &lruk, &lfuAging};
-    std::vector<int> hits(5, 0);
-    std::vector<int> get_operations(5, 0);
-    std::vector<std::string> names = {"LRU", "LFU", "ARC", "LRU-K", "LFU-Aging"};
+    std::mt19937 gen;
+    std::array<ZPCache::ZPCachePolicy<int, std::string>*, 10> caches = {&lru, &lfu, &arc, &lruk, &lfuAging, &shardedLru, &tinyLfu, &slru, &sieve, &adaptiveArc};
+    std::vector<int> hits(10, 0);
+    std::vector<int> get_operations(10, 0);
+    std::vector<std::string> names = {"LRU", "LFU", "ARC", "LRU-K", "LFU-Aging", "Sharded-LRU", "W-TinyLFU", "SLRU", "SIEVE", "Adaptive-ARC"};
 
     // 为每种缓存算法运行相同的测试
     for (int i = 0; i < caches.size(); ++i) { 
+        gen.seed(kWorkloadSeed);
         // 先预热缓存，只插入少量初始数据
         for (int key = 0; key < 30; ++key) {
             std::string value = "init" + std::to_string(key);
@@ -284,12 +291,99 @@ void testWorkloadShift() {
         }
     }
 
-    printResults("工作负载剧烈变化测试", CAPACITY, get_operations, hits);
+    printResults("工作负载剧烈变化测试", CAPACITY, names, get_operations, hits);
+}
+
+void testColdInsertWave() {
+    std::cout << "\n=== 测试场景4：冷数据写入冲刷测试（抽样淘汰） ===" << std::endl;
+
+    const int CAPACITY = 20000;
+    const int HOT_KEYS = 5000;          // 先写入并各读取多次的热点key
+    const int HOT_READS = 200;
+    const int COLD_KEYS = 15000;        // 只写不读的冷key，恰好填满容量
+    const int WAVE_KEYS = 5000;         // 之后写入的新key，迫使淘汰同样多的条目
+
+    std::vector<std::string> names = {"Concurrent-LRU", "Concurrent-LFU"};
+    for (auto eviction : {ZPCache::ZPSampledEviction::Lru, ZPCache::ZPSampledEviction::Lfu}) {
+        ZPCache::ZPConcurrentCache<int, int> cache(CAPACITY, eviction);
+        for (int key = 0; key < HOT_KEYS; ++key)
+            cache.put(key, key);
+        int value = 0;
+        for (int round = 0; round < HOT_READS; ++round) {
+            for (int key = 0; key < HOT_KEYS; ++key)
+                cache.get(key, value);
+        }
+        for (int key = 0; key < COLD_KEYS; ++key)
+            cache.put(HOT_KEYS + key, key);
+        for (int key = 0; key < WAVE_KEYS; ++key)
+            cache.put(HOT_KEYS + COLD_KEYS + key, key);
+
+        int hotKept = 0;
+        for (int key = 0; key < HOT_KEYS; ++key)
+            hotKept += cache.get(key, value);
+        std::cout << names[eviction == ZPCache::ZPSampledEviction::Lfu] << " - 热点保留: " << hotKept << "/" << HOT_KEYS;
+        // 频次优先时热点不应先于从未读过的冷key被淘汰
+        if (eviction == ZPCache::ZPSampledEviction::Lfu && hotKept < HOT_KEYS * 9 / 10)
+            std::cout << "  [异常] 频次没有生效";
+        std::cout << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+// 统计分配字节数的分配器，用于估算std::unordered_map的索引内存
+// （rebind后的各类分配器共用同一个计数）
+inline size_t countedBytes = 0;
+
+template<typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+    template<typename U> CountingAllocator(const CountingAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        countedBytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, size_t n) {
+        countedBytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+    template<typename U> bool operator==(const CountingAllocator<U>&) const { return true; }
+};
+
+void testIndexMemory() {
+    std::cout << "\n=== 索引内存对比：key -> NodePtr ===" << std::endl;
+
+    for (int entries : {1000, 100000, 1000000}) {
+        using Pair = std::pair<const int, void*>;
+        countedBytes = 0;
+        {
+            std::unordered_map<int, void*, std::hash<int>, std::equal_to<int>, CountingAllocator<Pair>> nodeMap;
+            for (int key = 0; key < entries; ++key)
+                nodeMap[key] = nullptr;
+            size_t bytes = countedBytes + sizeof(nodeMap);
+            std::cout << "条目数: " << entries << std::endl;
+            std::cout << "std::unordered_map - " << std::fixed << std::setprecision(2)
+                      << static_cast<double>(bytes) / entries << " 字节/条目" << std::endl;
+        }
+
+        ZPCache::ZPFlatHashMap<int, void*> flatMap(entries);
+        for (int key = 0; key < entries; ++key)
+            flatMap[key] = nullptr;
+        std::cout << "ZPFlatHashMap      - " << std::fixed << std::setprecision(2)
+                  << static_cast<double>(flatMap.memoryUsage()) / entries << " 字节/条目" << std::endl;
+    }
+
+    std::cout << std::endl;
 }
 
 int main() {
     testHotDataAccess();
     testLoopPattern();
     testWorkloadShift();
+    testColdInsertWave();
+    testIndexMemory();
     return 0;
 }
\ No newline at end of file
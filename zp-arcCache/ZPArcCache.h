@@ -1,9 +1,21 @@
 #pragma once    
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstddef>
+#include <functional>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
 
 #include "../ZPCachePolicy.h"
+#include "../ZPLockProfiling.h"
+#include "../ZPShardedCache.h"
+#include "../ZPSnapshot.h"
 #include "ZPArcLruPart.h"
 #include "ZPArcLfuPart.h"
 
@@ -13,49 +25,118 @@
 
 namespace ZPCache{
 
+// 一次put/get的全部步骤（幽灵表检查、容量调整、两部分之间的转移）都在同一个临界区内完成，
+// 两个part本身不再加锁。高并发场景使用下方的 ZPShardedArcCache，每个分片各自持有完整的T1/T2/B1/B2。
 template<typename Key, typename Value> 
 class ZPArcCache : public ZPCachePolicy<Key, Value>
 {
 
 public:
     explicit ZPArcCache(size_t capacity = 10, size_t transformThreshold = 2)
+    : ZPArcCache(std::allocator_arg, std::pmr::get_default_resource(), capacity, transformThreshold)
+    {}
+
+    // 两部分的结点池与索引从resource分配，要求resource比缓存活得更久
+    ZPArcCache(std::allocator_arg_t, std::pmr::memory_resource* resource, size_t capacity,
+               size_t transformThreshold = 2)
     : capacity_(capacity)
     , transformThreshold_(transformThreshold)
-    , lruPart_(std::make_unique<ArcLruPart<Key, Value>>(capacity, transformThreshold))
-    , lfuPart_(std::make_unique<ArcLfuPart<Key, Value>>(capacity, transformThreshold))
+    , lruPart_(std::make_unique<ArcLruPart<Key, Value>>(capacity, transformThreshold, capacity, resource))
+    , lfuPart_(std::make_unique<ArcLfuPart<Key, Value>>(capacity, transformThreshold, capacity, resource))
+    {
+        watchRemovals();
+    }
+
+    // 按权重计容量：两部分的容量以及幽灵表命中时的自适应调整都以权重（例如字节数）为单位，
+    // 命中幽灵表时按该条目被淘汰时的权重在两部分之间移动容量
+    ZPArcCache(size_t capacity, size_t transformThreshold, ZPWeigher<Key, Value> weigher)
+    : ZPArcCache(std::allocator_arg, std::pmr::get_default_resource(), capacity, transformThreshold, std::move(weigher))
     {}
 
+    ZPArcCache(std::allocator_arg_t, std::pmr::memory_resource* resource, size_t capacity,
+               size_t transformThreshold, ZPWeigher<Key, Value> weigher)
+    : capacity_(capacity)
+    , transformThreshold_(transformThreshold)
+    , weigher_(std::move(weigher))
+    , lruPart_(std::make_unique<ArcLruPart<Key, Value>>(capacity, transformThreshold, kWeightedReserve, resource))
+    , lfuPart_(std::make_unique<ArcLfuPart<Key, Value>>(capacity, transformThreshold, kWeightedReserve, resource))
+    {
+        watchRemovals();
+    }
+
     ~ZPArcCache() override = default;
 
     void put(Key key, Value value) override
     {
-        checkGhostCaches(key);
+        auto latency = counters_.timePut();
+        std::lock_guard<ZPMutex> lock(mutex_);
+        expireEntries();
+        putInternal(key, std::move(value), 0);
+    }
 
-        // 检查 LFU 部分是否存在该键
-        bool inLfu = lfuPart_->contain(key);
-        // 更新 LRu 部分缓存
-        lruPart_->put(key,value);
-        // 如果LFU 部分存在该键， 则更新LFU部分
-        if(inLfu)
+    // 带TTL的添加：ttl之后条目在两部分中都过期，不再命中，并在之后的读写中由定时轮回收（计入淘汰统计，不进入幽灵表）。
+    // 同一个key之后不带TTL的put会取消过期时间；ttl<=0 等同于删除
+    void put(Key key, Value value, std::chrono::nanoseconds ttl) override
+    {
+        auto latency = counters_.timePut();
+        std::lock_guard<ZPMutex> lock(mutex_);
+        uint64_t now = ZPTimingWheel::now();
+        lruPart_->expire(now);
+        lfuPart_->expire(now);
+        if(ttl.count() <= 0)
         {
-            lfuPart_->put(key, value);
+            counters_.add(ZPCacheEvent::Put);
+            lruPart_->remove(key);
+            lfuPart_->remove(key);
+            return;
         }
+        putInternal(key, std::move(value), ZPTimingWheel::deadline(now, ttl));
     }
 
     bool get(Key key, Value& vlaue) override
     {
-        checkGhostCaches(key);
+        auto latency = counters_.timeGet();
+        std::lock_guard<ZPMutex> lock(mutex_);
+        expireEntries();
+        return getInternal(key, vlaue);
+    }
+
+    // 一次哈希同时用于幽灵表检查与两部分的主表，std::string 键可以直接用 string_view 查询
+    bool getHashed(const ZPHashedKey<Key>& key, Value& value) override
+    {
+        auto latency = counters_.timeGet();
+        std::lock_guard<ZPMutex> lock(mutex_);
+        expireEntries();
+        NodeType* node = accessInternal(key.key, key.hash);
+        if(!node)
+            return false;
+        value = node->getValue();
+        return true;
+    }
 
-        bool shouldTransform = false;
-        if(lruPart_->get(key, vlaue, shouldTransform))
-        {
-            if(shouldTransform)
-            {
-                lfuPart_->put(key, vlaue);
-            }
-            return lfuPart_->get(key, vlaue);
-        }
-        return false;
+    bool visitHashed(const ZPHashedKey<Key>& key, const std::function<void(const Value&)>& visitor) override
+    {
+        auto latency = counters_.timeGet();
+        std::lock_guard<ZPMutex> lock(mutex_);
+        expireEntries();
+        NodeType* node = accessInternal(key.key, key.hash);
+        if(!node)
+            return false;
+        visitor(node->getValue());
+        return true;
+    }
+
+    // 命中时在锁内把结点中的值直接交给visitor，不做拷贝；visitor中不可再访问本缓存
+    bool visit(const Key& key, const std::function<void(const Value&)>& visitor) override
+    {
+        auto latency = counters_.timeGet();
+        std::lock_guard<ZPMutex> lock(mutex_);
+        expireEntries();
+        NodeType* node = accessInternal(key);
+        if(!node)
+            return false;
+        visitor(node->getValue());
+        return true;
     }
 
     Value get(Key key) override 
@@ -65,36 +146,285 @@ public:
         return value;
     }
 
-private:
-    bool checkGhostCaches(Key key)
+    // 整批只加一次锁，并提前预取后续key在两部分索引中的槽位
+    size_t getMany(std::span<const Key> keys, std::span<Value> values, std::vector<bool>& hits) override
     {
-        bool inGhost = false;
-        if(lruPart_->checkGhost(key))
+        hits.assign(keys.size(), false);
+        size_t hitCount = 0;
+        std::lock_guard<ZPMutex> lock(mutex_);
+        expireEntries();
+        for (size_t i = 0; i < keys.size(); ++i)
         {
-            if(lfuPart_->decreaseCapacity())
+            prefetchAhead(keys, i);
+            if (getInternal(keys[i], values[i]))
             {
-                lruPart_->increasCapacity();
+                hits[i] = true;
+                ++hitCount;
             }
-            inGhost = true;
         }
-        else if(lfuPart_->checkGhost(key))
+        return hitCount;
+    }
+
+    void putMany(std::span<const Key> keys, std::span<const Value> values) override
+    {
+        std::lock_guard<ZPMutex> lock(mutex_);
+        expireEntries();
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            prefetchAhead(keys, i);
+            putInternal(keys[i], values[i], 0);
+        }
+    }
+
+    // 快照保存两部分当前的容量划分、T1/T2（两部分主链表）以及B1/B2（两部分幽灵表），访问次数与频次一并保存
+    bool saveSnapshot(const std::string& path)
+    {
+        ZPSnapshotWriter out(path);
+        writeSnapshot(out);
+        return out.commit();
+    }
+
+    // 用快照替换当前全部内容，直接重建两部分的链表与索引，不经过put。
+    // 容量与保存时不同时按比例换算容量划分；文件损坏或类型不符时缓存为空并返回false
+    bool loadSnapshot(const std::string& path)
+    {
+        ZPSnapshotReader in(path);
+        return readSnapshot(in);
+    }
+
+    void writeSnapshot(ZPSnapshotWriter& out)
+    {
+        std::lock_guard<ZPMutex> lock(mutex_);
+        uint64_t now = ZPTimingWheel::now();
+        out.writeHeader(ZPSnapshotKind::Arc, sizeof(Key), sizeof(Value));
+        out.write(static_cast<uint64_t>(lruPart_->capacity()));
+        out.write(static_cast<uint64_t>(lfuPart_->capacity()));
+        lruPart_->writeSnapshot(out, now);
+        lfuPart_->writeSnapshot(out, now);
+    }
+
+    bool readSnapshot(ZPSnapshotReader& in)
+    {
+        std::lock_guard<ZPMutex> lock(mutex_);
+        uint64_t savedLru = 0;
+        uint64_t savedLfu = 0;
+        bool valid = in.readHeader(ZPSnapshotKind::Arc, sizeof(Key), sizeof(Value)) && in.read(savedLru) &&
+                     in.read(savedLfu);
+
+        // 两部分容量之和恒为 2 * capacity_
+        size_t total = capacity_ * 2;
+        size_t lruCapacity = capacity_;
+        if(valid && savedLru + savedLfu > 0)
+        {
+            double share = static_cast<double>(savedLru) / static_cast<double>(savedLru + savedLfu);
+            lruCapacity = std::min(total, static_cast<size_t>(std::llround(share * static_cast<double>(total))));
+        }
+
+        uint64_t now = ZPTimingWheel::now();
+        auto weigher = [this](const Key& key, const Value& value) { return weigh(key, value); };
+        valid = valid && lruPart_->readSnapshot(in, now, lruCapacity, weigher) &&
+                lfuPart_->readSnapshot(in, now, total - lruCapacity, weigher);
+        if(!valid)
+        {
+            lruPart_->clear();
+            lfuPart_->clear();
+        }
+        return valid;
+    }
+
+    // 两部分中的副本过期时间相同，先查LRU部分
+    std::optional<std::chrono::nanoseconds> timeToLive(const Key& key) override
+    {
+        std::lock_guard<ZPMutex> lock(mutex_);
+        uint64_t expiresAt = lruPart_->expiresAtOf(key);
+        if (expiresAt == 0)
+            expiresAt = lfuPart_->expiresAtOf(key);
+        if (expiresAt == 0)
+            return std::nullopt;
+        return ZPTimingWheel::remaining(expiresAt, ZPTimingWheel::now());
+    }
+
+    // 容量划分属于两个part的内部状态，需要在锁内读取
+    ZPCacheStats stats() const override
+    {
+        ZPCacheStats snapshot;
+        counters_.fill(snapshot);
+        std::lock_guard<ZPMutex> lock(mutex_);
+        snapshot.recencyCapacity = lruPart_->capacity();
+        snapshot.frequencyCapacity = lfuPart_->capacity();
+        return snapshot;
+    }
+
+    void enableLatencySampling(uint32_t sampleEvery) override { counters_.enableLatencySampling(sampleEvery); }
+
+    // 只有key离开了整个缓存才通知：一部分淘汰了它、另一部分仍持有时不算淘汰
+    bool setEvictionListener(ZPEvictionListener<Key, Value> listener) override
+    {
+        evictionListener_ = std::move(listener);
+        return true;
+    }
+
+    // value 是新的 transformThreshold：LRU部分的条目被访问这么多次后转入LFU部分
+    bool setTuning(double value) override
+    {
+        std::lock_guard<ZPMutex> lock(mutex_);
+        transformThreshold_ = static_cast<size_t>(std::max(std::lround(value), 1L));
+        lruPart_->setTransformThreshold(transformThreshold_);
+        return true;
+    }
+
+private:
+    static constexpr size_t kPrefetchDistance = 4;
+    static constexpr size_t kWeightedReserve = 64;
+
+    size_t weigh(const Key& key, const Value& value) const
+    {
+        return weigher_ ? std::max<size_t>(weigher_(key, value), 1) : 1;
+    }
+
+    void prefetchAhead(std::span<const Key> keys, size_t i)
+    {
+        if (i + kPrefetchDistance < keys.size())
+        {
+            lruPart_->prefetch(keys[i + kPrefetchDistance]);
+            lfuPart_->prefetch(keys[i + kPrefetchDistance]);
+        }
+    }
+
+    using NodeType = ArcNode<Key, Value>;
+
+    // 以下函数都要求调用者已持有 mutex_
+
+    // 两部分各自淘汰或过期时回调；另一部分仍持有同一个key时它没有离开缓存，淘汰统计与监听器都不计。
+    // 两部分中的副本过期时间相同，同时到期时只有后移出的那一份计入
+    void watchRemovals()
+    {
+        lruPart_->setRemovalListener([this](const Key& key, const Value& value, bool expired)
+        {
+            if(!lfuPart_->contain(key, hashKey(key)))
+                recordRemoval(key, value, expired);
+        });
+        lfuPart_->setRemovalListener([this](const Key& key, const Value& value, bool expired)
+        {
+            if(!lruPart_->contain(key, hashKey(key)))
+                recordRemoval(key, value, expired);
+        });
+    }
+
+    void recordRemoval(const Key& key, const Value& value, bool expired)
+    {
+        counters_.add(ZPCacheEvent::Eviction);
+        if(expired)
+            counters_.add(ZPCacheEvent::Expiration);
+        else if(evictionListener_)
+            evictionListener_(key, value);
+    }
+
+    // 任一部分挂有带TTL的结点时才读时钟，两部分推进到同一时间
+    void expireEntries()
+    {
+        if(!lruPart_->hasTimers() && !lfuPart_->hasTimers())
+            return;
+        uint64_t now = ZPTimingWheel::now();
+        lruPart_->expire(now);
+        lfuPart_->expire(now);
+    }
+
+    // expiresAt 为0表示不过期
+    void putInternal(const Key& key, Value value, uint64_t expiresAt)
+    {
+        counters_.add(ZPCacheEvent::Put);
+        size_t hash = hashKey(key);
+        checkGhostCaches(hash);
+        size_t weight = weigh(key, value);
+
+        // 检查 LFU 部分是否存在该键
+        bool inLfu = lfuPart_->contain(key, hash);
+        if(inLfu)
+        {
+            // 更新 LRu 部分缓存，值的最后一份交给 LFU 部分
+            lruPart_->put(key, value, weight, expiresAt);
+            lfuPart_->put(key, std::move(value), weight, expiresAt);
+        }
+        else
+        {
+            lruPart_->put(key, std::move(value), weight, expiresAt);
+        }
+    }
+
+    bool getInternal(const Key& key, Value& vlaue)
+    {
+        NodeType* node = accessInternal(key);
+        if(!node)
+            return false;
+        vlaue = node->getValue();
+        return true;
+    }
+
+    // 记录一次访问并返回持有该值的结点，值只在调用者真正需要时才拷贝
+    NodeType* accessInternal(const Key& key)
+    {
+        return accessInternal(key, hashKey(key));
+    }
+
+    // 两部分的主表与幽灵表共用调用方算好的哈希；lookup 可以是 Key 的视图，只有转入 LFU 部分时才构造Key
+    template<typename Lookup>
+    NodeType* accessInternal(const Lookup& key, size_t hash)
+    {
+        checkGhostCaches(hash);
+
+        bool shouldTransform = false;
+        NodeType* lruNode = lruPart_->access(key, hash, shouldTransform);
+        if(lruNode)
         {
-            if(lruPart_->decreaseCapacity())
+            if(shouldTransform)
             {
-                lfuPart_->increasCapacity();
+                lfuPart_->put(lruNode->getKey(), lruNode->getValue(), lruNode->getWeight(), lruNode->expiresAt());
+                counters_.add(ZPCacheEvent::Promotion);
             }
-            return inGhost;
+            // 同步更新 LFU 部分的访问频次；LRU 部分的命中本身已经算作命中
+            lfuPart_->access(key, hash);
+            counters_.add(ZPCacheEvent::Hit);
+            return lruNode;
         }
-        return inGhost;
+        // 已被 LRU 部分淘汰、但仍留在 LFU 部分的热点数据
+        NodeType* lfuNode = lfuPart_->access(key, hash);
+        counters_.add(lfuNode ? ZPCacheEvent::Hit : ZPCacheEvent::Miss);
+        return lfuNode;
+    }
+
+    // 命中哪一部分的幽灵表，就从另一部分挪出与该条目等量的容量（未设置weigher时为1）；幽灵表只按哈希查找
+    bool checkGhostCaches(size_t hash)
+    {
+        if(size_t weight = lruPart_->checkGhost(hash))
+        {
+            counters_.add(ZPCacheEvent::RecencyGhostHit);
+            lruPart_->increasCapacity(lfuPart_->decreaseCapacity(weight));
+            return true;
+        }
+        if(size_t weight = lfuPart_->checkGhost(hash))
+        {
+            counters_.add(ZPCacheEvent::FrequencyGhostHit);
+            lfuPart_->increasCapacity(lruPart_->decreaseCapacity(weight));
+        }
+        return false;
     }
 
 
 private:
     size_t capacity_;
     size_t transformThreshold_;
+    ZPWeigher<Key, Value> weigher_; // 为空时每个条目权重为1
+    ZPEvictionListener<Key, Value> evictionListener_;
+    mutable ZPMutex mutex_;
+    ZPCacheCounters counters_;
     std::unique_ptr<ArcLruPart<Key,Value>> lruPart_;
     std::unique_ptr<ArcLfuPart<Key,Value>> lfuPart_;
 
 };
 
+// 分片ARC：每个分片是一个独立的 ZPArcCache，一次操作只获取所在分片的一把锁
+template<typename Key, typename Value>
+using ZPShardedArcCache = ZPShardedCache<Key, Value, ZPArcCache<Key, Value>>;
+
 } // namespace ZPCache
\ No newline at end of file
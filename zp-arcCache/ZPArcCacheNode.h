@@ -1,34 +1,64 @@
 #pragma once
 
 #include <cstddef>
+#include <functional>
 #include <memory>
+#include <utility>
+
+#include "../ZPTimingWheel.h"
 
 namespace ZPCache {
 
+template<typename Key, typename Value> class ArcNode;
+
+// 主链表的结点因容量淘汰（expired 为false）或TTL到期而移出时，part 调用 ZPArcCache 设置的这个回调
+template<typename Key, typename Value>
+using ArcRemovalListener = std::function<void(const Key& key, const Value& value, bool expired)>;
+
+// ArcLfuPart 中同一访问频次的结点组成一个桶，所有桶按频次升序串成双向链表
+template<typename Key, typename Value>
+struct ArcFreqBucket
+{
+    size_t freq = 0;
+    ArcNode<Key, Value>* head = nullptr; // 最早进入该频次的结点，优先淘汰
+    ArcNode<Key, Value>* tail = nullptr;
+    ArcFreqBucket* prev = nullptr;
+    ArcFreqBucket* next = nullptr;
+
+    bool empty() const { return head == nullptr; }
+};
+
+// 带TTL的结点挂在所在part的定时轮上，进入幽灵链表时摘下
 template<typename Key, typename Value>
-class ArcNode
+class ArcNode : public ZPTimerLink
 {
 private:
     Key key_;
     Value value_;
     size_t accessCount_;
-    std::weak_ptr<ArcNode> prev_;
-    std::shared_ptr<ArcNode> next_;
+    size_t weight_;   // 条目权重，按条目数计容量时恒为1；进入幽灵表后保留，用于按权重调整两部分的容量
+    ArcNode* prev_;   // 结点由所在part的ZPNodePool持有，链表只用裸指针串联
+    ArcNode* next_;
+    ArcFreqBucket<Key, Value>* bucket_; // 仅在ArcLfuPart主缓存中有效
 
 public:
-    ArcNode() : accessCount_(1), next_(nullptr){}
+    ArcNode() : accessCount_(1), weight_(1), prev_(nullptr), next_(nullptr), bucket_(nullptr) {}
 
     ArcNode(Key key, Value value)
-    : key_(key)
-    , value_(value)
+    : key_(std::move(key))
+    , value_(std::move(value))
     , accessCount_(1)
-    ,next_(nullptr)
+    , weight_(1)
+    , prev_(nullptr)
+    , next_(nullptr)
+    , bucket_(nullptr)
     {}
 
     // Getters
     Key getKey() const { return key_;}
-    Value getValue() const { return value_;}
+    const Value& getValue() const { return value_;}
     size_t getAccessCount() const { return accessCount_; }
+    size_t getWeight() const { return weight_; }
 
     // Setters
     void setValue(const Value& value) { value_ = value; }
@@ -38,4 +68,4 @@ public:
     template<typename  K, typename  V> friend class ArcLfuPart;
 };
 
-} // namespace ZPCache
\ No newline at end of file
+} // namespace ZPCache
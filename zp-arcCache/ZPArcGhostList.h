@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace ZPCache {
+
+// ARC 的幽灵表（B1/B2）。幽灵只需要回答"这个key最近是否被淘汰过、当时的权重是多少"，所以不保存key、值和结点，只保存key的哈希：
+//   - ring_ 是按淘汰顺序排列的FIFO环，每项记录完整哈希与权重；被命中取走的项权重置0留作墓碑，出队时跳过；
+//   - buckets_ 按哈希分桶，每个桶正好一个缓存行，8个槽位各存32位指纹与该项在 ring_ 中的位置。
+// 未命中的查找只读一个桶；指纹相同时再比较 ring_ 中的完整哈希，只有64位哈希相同的不同key才会被误认。
+// 桶满时丢弃桶中最旧的一项，相当于它提前出队。
+// 存活项始终不超过环长的一半，桶的平均负载不超过4个槽位：存活项将要超过一半时环加倍，墓碑把环写满时按原顺序原地压实。
+// 未设置weigher时存活项不超过容量，环长至少是容量的两倍，从不扩容；按权重计容量时条目数未知，环按需加倍，均摊O(1)。
+// 哈希由 part 的主表的 hashOf 给出，快照中只写哈希，同一程序重启后哈希不变。
+// 不加锁，由所属的 part 在 ZPArcCache 的锁内调用
+class ArcGhostList
+{
+public:
+    // capacity 是所有幽灵的权重上限，reserveCount 是预计的幽灵条目数
+    ArcGhostList(size_t capacity, size_t reserveCount, std::pmr::memory_resource* resource)
+    : capacity_(capacity)
+    , ring_(resource)
+    , buckets_(resource)
+    {
+        resize(ringSizeFor(reserveCount));
+    }
+
+    size_t size() const { return size_; }
+    size_t weight() const { return weight_; }
+
+    // 命中时取走该幽灵并返回它记录的权重，未命中返回0
+    size_t take(size_t hash)
+    {
+        Bucket& bucket = bucketFor(hash);
+        uint32_t tag = tagOf(hash);
+        for(size_t i = 0; i < kBucketSlots; ++i)
+        {
+            if(bucket.tags[i] == tag && ring_[bucket.positions[i]].hash == hash)
+            {
+                Entry& entry = ring_[bucket.positions[i]];
+                size_t weight = entry.weight;
+                bucket.tags[i] = 0;
+                drop(entry);
+                return weight;
+            }
+        }
+        return 0;
+    }
+
+    // 记下一个刚被淘汰的key，同一个key之前的幽灵先被取走，免得重复计入权重；超出权重上限时从最旧的一端出队
+    void push(size_t hash, size_t weight)
+    {
+        if(weight == 0 || weight > capacity_)
+            return;
+        take(hash);
+        while(weight_ + weight > capacity_)
+            popOldest();
+        append(hash, weight);
+    }
+
+    void prefetch(size_t hash) const
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(&buckets_[bucketIndex(hash)]);
+#else
+        (void)hash;
+#endif
+    }
+
+    // 从旧到新对每个幽灵调用 fn(hash, weight)
+    template<typename Fn>
+    void forEach(Fn&& fn) const
+    {
+        for(size_t seq = head_; seq != tail_; ++seq)
+        {
+            const Entry& entry = ring_[seq & mask_];
+            if(entry.weight)
+                fn(entry.hash, entry.weight);
+        }
+    }
+
+    void clear()
+    {
+        std::fill(buckets_.begin(), buckets_.end(), Bucket{});
+        head_ = 0;
+        tail_ = 0;
+        size_ = 0;
+        weight_ = 0;
+    }
+
+private:
+    static constexpr size_t kBucketSlots = 8;
+    static constexpr size_t kMinRingSize = 64;
+
+    struct Entry
+    {
+        uint64_t hash = 0;
+        uint64_t weight = 0; // 0 表示墓碑
+    };
+
+    struct alignas(64) Bucket
+    {
+        uint32_t tags[kBucketSlots] = {};      // 0 表示空槽位
+        uint32_t positions[kBucketSlots] = {}; // 在 ring_ 中的下标
+    };
+
+    static size_t ringSizeFor(size_t count)
+    {
+        return std::bit_ceil(std::max(count * 2, kMinRingSize));
+    }
+
+    static uint32_t tagOf(size_t hash)
+    {
+        uint32_t tag = static_cast<uint32_t>(hash);
+        return tag ? tag : 1;
+    }
+
+    // 低32位做指纹，高位选桶
+    size_t bucketIndex(size_t hash) const
+    {
+        return static_cast<size_t>(static_cast<uint64_t>(hash) >> 32) & (buckets_.size() - 1);
+    }
+
+    Bucket& bucketFor(size_t hash) { return buckets_[bucketIndex(hash)]; }
+
+    void drop(Entry& entry)
+    {
+        weight_ -= entry.weight;
+        entry.weight = 0;
+        --size_;
+    }
+
+    void popOldest()
+    {
+        while(head_ != tail_)
+        {
+            uint32_t position = static_cast<uint32_t>(head_++ & mask_);
+            Entry& entry = ring_[position];
+            if(!entry.weight)
+                continue;
+            Bucket& bucket = bucketFor(entry.hash);
+            for(size_t i = 0; i < kBucketSlots; ++i)
+            {
+                if(bucket.tags[i] && bucket.positions[i] == position)
+                {
+                    bucket.tags[i] = 0;
+                    break;
+                }
+            }
+            drop(entry);
+            return;
+        }
+    }
+
+    void append(size_t hash, size_t weight)
+    {
+        while(head_ != tail_ && !ring_[head_ & mask_].weight)
+            ++head_;
+        if(size_ * 2 >= ring_.size())
+            resize(ring_.size() * 2);
+        else if(tail_ - head_ == ring_.size())
+            resize(ring_.size());
+
+        uint32_t position = static_cast<uint32_t>(tail_++ & mask_);
+        ring_[position] = {hash, weight};
+        weight_ += weight;
+        ++size_;
+
+        Bucket& bucket = bucketFor(hash);
+        size_t slot = kBucketSlots;
+        size_t oldestAge = SIZE_MAX;
+        for(size_t i = 0; i < kBucketSlots; ++i)
+        {
+            if(!bucket.tags[i])
+            {
+                slot = i;
+                break;
+            }
+            size_t age = (bucket.positions[i] - head_) & mask_; // 距队头越近越旧
+            if(age < oldestAge)
+            {
+                oldestAge = age;
+                slot = i;
+            }
+        }
+        if(bucket.tags[slot])
+            drop(ring_[bucket.positions[slot]]);
+        bucket.tags[slot] = tagOf(hash);
+        bucket.positions[slot] = position;
+    }
+
+    // 换成长度为 ringSize 的环，存活项按原顺序重新入队
+    void resize(size_t ringSize)
+    {
+        std::pmr::vector<Entry> live(ring_.get_allocator());
+        live.reserve(size_);
+        forEach([&](uint64_t hash, uint64_t weight) { live.push_back({hash, weight}); });
+
+        ring_.assign(ringSize, Entry{});
+        buckets_.assign(ringSize / kBucketSlots, Bucket{});
+        mask_ = ringSize - 1;
+        head_ = 0;
+        tail_ = 0;
+        size_ = 0;
+        weight_ = 0;
+        for(const Entry& entry : live)
+            append(entry.hash, entry.weight);
+    }
+
+private:
+    size_t capacity_;     // 幽灵权重之和的上限
+    size_t weight_ = 0;
+    size_t size_ = 0;     // 存活的幽灵数，不含墓碑
+    size_t head_ = 0;     // 最旧一项的序号，ring_ 下标为 序号 & mask_
+    size_t tail_ = 0;     // 下一项的序号
+    size_t mask_ = 0;
+    std::pmr::vector<Entry>  ring_;
+    std::pmr::vector<Bucket> buckets_;
+};
+
+} // namespace ZPCache
@@ -3,236 +3,498 @@
 
 
 #include "ZPArcCacheNode.h"
+#include "ZPArcGhostList.h"
+#include "../ZPCachePolicy.h"
+#include "../ZPFlatHashMap.h"
+#include "../ZPNodePool.h"
+#include "../ZPSnapshot.h"
+#include <algorithm>
 #include <cstddef>
-#include <iterator>
-#include <list>
 #include <memory>
-#include <mutex>
-#include <unordered_map>
+#include <memory_resource>
 namespace ZPCache {
 
+// LFU half of ARC. Nodes of the same frequency are linked intrusively inside a bucket,
+// and buckets form a doubly-linked chain ordered by frequency, so hit/insert/evict are all O(1):
+// a hit moves the node into the neighbouring bucket, eviction takes the head of the first bucket.
+// Not synchronized on its own: every call is made by ZPArcCache while it holds its mutex.
 template<typename Key, typename Value>
 class ArcLfuPart
 {
 public:
     using NodeType = ArcNode<Key, Value>;
-    using NodePtr = std::shared_ptr<NodeType>;
-    using NodeMap = std::unordered_map<Key, NodePtr>;
-    using FreqMap = std::unordered_map<size_t, std::list<NodePtr>>;
+    using NodePtr = NodeType*;
+    using NodeMap = ZPFlatHashMap<Key, NodePtr>;
+    using BucketType = ArcFreqBucket<Key, Value>;
 
     explicit ArcLfuPart(size_t capacity, size_t transformThreshold)
+    : ArcLfuPart(capacity, transformThreshold, capacity)
+    {}
+
+    // capacity bounds the total weight of the main cache and of the ghost list; with a weigher the entry count is
+    // unknown, so pools, indexes and the ghost list only reserve reserveCount entries and grow on demand.
+    // All of them allocate from resource
+    ArcLfuPart(size_t capacity, size_t transformThreshold, size_t reserveCount,
+               std::pmr::memory_resource* resource = std::pmr::get_default_resource())
     : capacity_(capacity)
-    , ghostCapacity_(capacity)
     , transformThreshold_(transformThreshold)
-    , minFreq_(0)
+    , pool_(reserveCount, resource)
+    , bucketPool_(reserveCount + 1, resource)
+    , mainCache_(reserveCount, resource)
+    , ghosts_(capacity, reserveCount, resource)
     {
         initializeLists();
     }
 
-    bool put(Key key, Value value)
+    // weight is computed by ZPArcCache, 1 when no weigher is set; expiresAt 0 means no expiry
+    bool put(Key key, Value value, size_t weight = 1, uint64_t expiresAt = 0)
     {
-        if(capacity_ == 0)
+        auto it = mainCache_.find(key);
+        if(weight > capacity_)
+        {
+            // the new value does not fit, and the old one must not stay behind
+            if(it != mainCache_.end())
+                removeFromMain(it->second);
             return false;
+        }
 
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto it = mainCache_.find(key);
         if(it != mainCache_.end())
         {
-            return updateExistingNode(it->second, value);
+            return updateExistingNode(it->second, std::move(value), weight, expiresAt);
         }
-        return addNewNode(key, value);
+        return addNewNode(key, std::move(value), weight, expiresAt);
     }
 
-    bool get(Key key, Value& value)
+    bool remove(const Key& key)
     {
-        std::lock_guard<std::mutex> lock(mutex_);
         auto it = mainCache_.find(key);
-        if(it != mainCache_.end())
+        if(it == mainCache_.end())
+            return false;
+        removeFromMain(it->second);
+        return true;
+    }
+
+    // reclaim expired nodes (deleted outright, they do not become ghosts) and remember now for later hit checks
+    void expire(uint64_t now)
+    {
+        now_ = now;
+        timers_.advance(now, [this](ZPTimerLink* link)
         {
-            updateNodeFrequency(it->second);
-            value = it->second->getValue();
+            expireNode(static_cast<NodePtr>(link));
+        });
+    }
+
+    bool hasTimers() const { return !timers_.empty(); }
+
+    // deadline of a resident node, 0 when absent or without TTL
+    uint64_t expiresAtOf(const Key& key) const
+    {
+        auto it = mainCache_.find(key);
+        return it != mainCache_.end() ? it->second->expiresAt() : 0;
+    }
+
+    bool get(Key key, Value& value)
+    {
+        NodePtr node = access(key);
+        if(node)
+        {
+            value = node->getValue();
             return true;
         }
         return false;
     }
 
+    // record one access and return the node (nullptr on miss), so the caller can read the value in place
+    NodePtr access(const Key& key)
+    {
+        return access(key, mainCache_.hashOf(key));
+    }
+
+    // lookup is a Key or a view of one; hash must match hashOf and is shared with the other part
+    template<typename Lookup>
+    NodePtr access(const Lookup& key, size_t hash)
+    {
+        auto it = mainCache_.find(key, hash);
+        if(it != mainCache_.end())
+        {
+            if(it->second->expiredAt(now_))
+            {
+                // expired, but the timing wheel has not reached it yet
+                expireNode(it->second);
+                return nullptr;
+            }
+            updateNodeFrequency(it->second);
+            return it->second;
+        }
+        return nullptr;
+    }
+
     bool contain(Key key){
         return mainCache_.find(key) != mainCache_.end();
     }
 
-    bool checkGhost(Key key)
+    template<typename Lookup>
+    bool contain(const Lookup& key, size_t hash) const
+    {
+        return mainCache_.find(key, hash) != mainCache_.end();
+    }
+
+    // called when the main cache evicts for capacity or drops an expired node, set by ZPArcCache
+    void setRemovalListener(ArcRemovalListener<Key, Value> listener) { removalListener_ = std::move(listener); }
+
+    // on a ghost hit remove the ghost and return the weight it recorded, 0 on miss; hash matches the main index's hashOf
+    size_t checkGhost(size_t hash)
+    {
+        return ghosts_.take(hash);
+    }
+
+    // 预取key在主缓存与幽灵缓存索引中的槽位，供批量操作使用
+    void prefetch(const Key& key) const
     {
-        auto it = ghostCache_.find(key);
-        if(it != ghostCache_.end())
+        size_t hash = mainCache_.hashOf(key);
+        mainCache_.prefetchHash(hash);
+        ghosts_.prefetch(hash);
+    }
+
+    // resident nodes go out by descending frequency, newest first within a bucket; ghost hashes oldest first
+    void writeSnapshot(ZPSnapshotWriter& out, uint64_t now) const
+    {
+        out.write(static_cast<uint64_t>(mainCache_.size()));
+        for(const BucketType* bucket = freqHead_.prev; bucket != &freqHead_; bucket = bucket->prev)
         {
-            reMoveFromGhost(it->second);
-            ghostCache_.erase(it);
-            return true;
+            for(NodePtr node = bucket->tail; node; node = node->prev_)
+            {
+                out.write(node->key_);
+                out.write(node->value_);
+                out.write(static_cast<uint64_t>(node->accessCount_));
+                out.writeTtl(node->expiresAt(), now);
+            }
         }
-        return false;
+        out.write(static_cast<uint64_t>(ghosts_.size()));
+        ghosts_.forEach([&](uint64_t hash, uint64_t weight)
+        {
+            out.write(hash);
+            out.write(weight);
+        });
     }
 
-    void increasCapacity() { ++capacity_; }
+    // rebuild from a snapshot with the restored adaptive capacity; every record lands at the cold end,
+    // records that no longer fit are decoded and skipped. Frequencies must arrive in descending order
+    template<typename Weigh>
+    bool readSnapshot(ZPSnapshotReader& in, uint64_t now, size_t capacity, Weigh&& weigh)
+    {
+        clear();
+        capacity_ = capacity;
+        timers_.advance(now, [](ZPTimerLink*) {});
+        now_ = now;
+
+        uint64_t count = 0;
+        if(!in.read(count))
+            return false;
+        reserve(in.boundCount(count));
+        for(uint64_t i = 0; i < count; ++i)
+        {
+            Key key{};
+            Value value{};
+            uint64_t freq = 0;
+            uint64_t ttl = 0;
+            if(!in.read(key) || !in.read(value) || !in.read(freq) || !in.read(ttl))
+                return false;
+            freq = std::max<uint64_t>(freq, 1);
+            BucketType* coldest = freqHead_.next;
+            if(coldest != &freqHead_ && freq > coldest->freq)
+                return false;
+
+            uint64_t expiresAt = 0;
+            if(!in.restoreDeadline(ttl, now, expiresAt))
+                continue;
+            size_t weight = weigh(key, value);
+            if(weight > capacity_ - mainWeight_ || mainCache_.find(key) != mainCache_.end())
+                continue;
+
+            NodePtr node = pool_.acquire();
+            node->key_ = std::move(key);
+            node->value_ = std::move(value);
+            node->accessCount_ = static_cast<size_t>(freq);
+            node->weight_ = weight;
+            mainWeight_ += weight;
+            setExpiry(node, expiresAt);
+            mainCache_[node->key_] = node;
+            if(coldest == &freqHead_ || coldest->freq != freq)
+                coldest = insertBucketAfter(&freqHead_, static_cast<size_t>(freq));
+            pushFront(coldest, node);
+        }
 
-    bool decreaseCapacity()
+        if(!in.read(count))
+            return false;
+        for(uint64_t i = 0; i < count; ++i)
+        {
+            uint64_t hash = 0;
+            uint64_t weight = 0;
+            if(!in.read(hash) || !in.read(weight))
+                return false;
+            ghosts_.push(static_cast<size_t>(hash), static_cast<size_t>(std::max<uint64_t>(weight, 1)));
+        }
+        return true;
+    }
+
+    // release every resident node and bucket, and forget every ghost
+    void clear()
     {
-        if(capacity_ <= 0) return false;
-        if(mainCache_.size() == capacity_)
+        while(freqHead_.next != &freqHead_)
+        {
+            BucketType* bucket = freqHead_.next;
+            for(NodePtr node = bucket->head; node;)
+            {
+                NodePtr next = node->next_;
+                node->bucket_ = nullptr;
+                node->prev_ = nullptr;
+                node->next_ = nullptr;
+                releaseNode(node);
+                node = next;
+            }
+            bucket->head = nullptr;
+            bucket->tail = nullptr;
+            removeBucket(bucket);
+        }
+        mainCache_.clear();
+        ghosts_.clear();
+        timers_.clear();
+        mainWeight_ = 0;
+    }
+
+    void increasCapacity(size_t delta = 1) { capacity_ += delta; }
+
+    size_t capacity() const { return capacity_; }
+    size_t weight() const { return mainWeight_; }
+
+    // shrink by at most delta and return the actual amount; whatever no longer fits is evicted into the ghost list
+    size_t decreaseCapacity(size_t delta = 1)
+    {
+        delta = std::min(delta, capacity_);
+        capacity_ -= delta;
+        while(mainWeight_ > capacity_)
         {
             evictLeastFrequent();
         }
-        --capacity_;
-        return true;
+        return delta;
     }
 
 private:
     void initializeLists()
     {
-        ghostHead_ = std::make_shared<NodeType>();
-        ghostTail_ = std::make_shared<NodeType>();
-        ghostHead_->next_ = ghostTail_;
-        ghostTail_->prev_ = ghostHead_;
+        // circular sentinel: freqHead_.next is the least frequent bucket
+        freqHead_.prev = &freqHead_;
+        freqHead_.next = &freqHead_;
     }
 
-    bool updateExistingNode(NodePtr node, const Value& value)
+    bool updateExistingNode(NodePtr node, Value value, size_t weight, uint64_t expiresAt)
     {
-        node->setValue(value);
+        mainWeight_ = mainWeight_ - node->weight_ + weight;
+        node->weight_ = weight;
+        node->value_ = std::move(value);
+        setExpiry(node, expiresAt);
         updateNodeFrequency(node);
+        while(mainWeight_ > capacity_)
+        {
+            evictLeastFrequent();
+        }
         return true;
     }
 
-    bool addNewNode(const Key& key, const Value& value)
+    bool addNewNode(const Key& key, Value value, size_t weight, uint64_t expiresAt)
     {
-        if(mainCache_.size() >= capacity_)
+        while(mainWeight_ + weight > capacity_ && mainCache_.size() > 0)
         {
             evictLeastFrequent();
         }
 
-        NodePtr newNode = std::make_shared<NodeType>(key, value);
+        NodePtr newNode = pool_.acquire();
+        newNode->key_ = key;
+        newNode->value_ = std::move(value);
+        newNode->accessCount_ = 1;
+        newNode->weight_ = weight;
+        mainWeight_ += weight;
+        setExpiry(newNode, expiresAt);
         mainCache_[key] = newNode;
 
-        // add new ndoe to list that frenquent equil 1
-        if(freqMap_.find(1) == freqMap_.end())
+        // add new node to the bucket whose frequency equals 1, it is always the first one
+        BucketType* bucket = freqHead_.next;
+        if(bucket == &freqHead_ || bucket->freq != 1)
         {
-            freqMap_[1] = std::list<NodePtr>();
+            bucket = insertBucketAfter(&freqHead_, 1);
         }
-        freqMap_[1].push_back(newNode);
-        minFreq_ = 1;
+        pushBack(bucket, newNode);
 
         return true;
     }
 
     void updateNodeFrequency(NodePtr node)
     {
-        size_t oldFreq = node->getAccessCount();
+        BucketType* oldBucket = node->bucket_;
         node->incrementAccessCount();
         size_t newFreq = node->getAccessCount();
 
-        // remove from old frequency list
-        auto& oldList = freqMap_[oldFreq];
-        oldList.remove(node);
-        if(oldList.empty())
+        // the bucket of newFreq, if exists, is right after the old one
+        BucketType* newBucket = oldBucket->next;
+        if(newBucket == &freqHead_ || newBucket->freq != newFreq)
         {
-            freqMap_.erase(oldFreq);
-            if(oldFreq == minFreq_)
-            {
-                minFreq_ = newFreq;
-            }
+            newBucket = insertBucketAfter(oldBucket, newFreq);
         }
 
-        // add to new frequent list
-        if(freqMap_.find(newFreq) == freqMap_.end())
+        unlinkFromBucket(node);
+        pushBack(newBucket, node);
+        if(oldBucket->empty())
         {
-            freqMap_[newFreq] = std::list<NodePtr>();
+            removeBucket(oldBucket);
         }
-        freqMap_[newFreq].push_back(node);
     }
 
-    void evictLeastFrequent()
+    void setExpiry(NodePtr node, uint64_t expiresAt)
     {
-        if(freqMap_.empty()) return;
-
-        // obtain the least frequent List
-        auto& minFreqList = freqMap_[minFreq_];
-        if(minFreqList.empty())
-        {
-            return;
-        }
+        if(expiresAt)
+            timers_.schedule(node, expiresAt);
+        else
+            timers_.cancel(node);
+    }
 
-        // remove the node of least use node
-        NodePtr leastNode = minFreqList.front();
-        minFreqList.pop_front();
+    // TTL expiry: reported to the listener, then deleted without leaving a ghost
+    void expireNode(NodePtr node)
+    {
+        if(removalListener_)
+            removalListener_(node->key_, node->value_, true);
+        removeFromMain(node);
+    }
 
-        // if the frequency of list is empty, detele the frequency project
-        if(minFreqList.empty())
+    // drop a resident node without turning it into a ghost
+    void removeFromMain(NodePtr node)
+    {
+        BucketType* bucket = node->bucket_;
+        unlinkFromBucket(node);
+        if(bucket->empty())
         {
-            freqMap_.erase(minFreq_);
-            // update least frequent
-            if(!freqMap_.empty())
-            {
-                minFreq_ = freqMap_.begin()->first;
-            }
+            removeBucket(bucket);
         }
+        mainWeight_ -= node->weight_;
+        mainCache_.erase(node->key_);
+        releaseNode(node);
+    }
 
-        // move node to ghost cache
-        if(ghostCache_.size() >= ghostCapacity_)
+    void evictLeastFrequent()
+    {
+        BucketType* minBucket = freqHead_.next;
+        if(minBucket == &freqHead_) return;
+
+        // remove the least recently used node of the least frequent bucket
+        NodePtr leastNode = minBucket->head;
+        unlinkFromBucket(leastNode);
+        if(minBucket->empty())
         {
-            removeOldestGhost();
+            removeBucket(minBucket);
         }
-        addToGhost(leastNode);
 
         // remove it from main cache
-        mainCache_.erase(leastNode->getKey());
+        mainWeight_ -= leastNode->weight_;
+        mainCache_.erase(leastNode->key_);
+        if(removalListener_)
+            removalListener_(leastNode->key_, leastNode->value_, false);
+
+        // a ghost only records the key's hash and weight, the node and its value are released right away
+        ghosts_.push(mainCache_.hashOf(leastNode->key_), leastNode->weight_);
+        releaseNode(leastNode);
     }
 
-    void reMoveFromGhost(NodePtr node)
+    BucketType* insertBucketAfter(BucketType* pos, size_t freq)
     {
-        if(!node->prev_.expired() && node->next_) {
-            auto prev = node->prev_.lock();
-            prev->next_ = node->next_;
-            prev->next_->prev_ = node->prev_;
-            node->next_ = nullptr; // clear ptr, prevent dangling references
-        }
+        BucketType* bucket = bucketPool_.acquire();
+        bucket->freq = freq;
+        bucket->head = nullptr;
+        bucket->tail = nullptr;
+        bucket->prev = pos;
+        bucket->next = pos->next;
+        pos->next->prev = bucket;
+        pos->next = bucket;
+        return bucket;
     }
 
-    void addToGhost(NodePtr node)
+    void removeBucket(BucketType* bucket)
     {
-        node->next_ = ghostTail_;
-        node->prev_ = ghostTail_->prev_;
-        if(!ghostTail_->prev_.expired())
-        {
-            ghostTail_->prev_.lock()->next_ = node;
-        }
-        ghostTail_->prev_ = node;
-        ghostCache_[node->getKey()] = node;
+        bucket->prev->next = bucket->next;
+        bucket->next->prev = bucket->prev;
+        bucketPool_.release(bucket);
     }
 
-    void removeOldestGhost()
+    void pushBack(BucketType* bucket, NodePtr node)
     {
-        NodePtr oldestGhost = ghostHead_->next_;
-        if(oldestGhost != ghostTail_)
-        {
-            reMoveFromGhost(oldestGhost);
-            ghostCache_.erase(oldestGhost->getKey());
-        }
+        node->bucket_ = bucket;
+        node->prev_ = bucket->tail;
+        node->next_ = nullptr;
+        if(bucket->tail)
+            bucket->tail->next_ = node;
+        else
+            bucket->head = node;
+        bucket->tail = node;
+    }
+
+    void pushFront(BucketType* bucket, NodePtr node)
+    {
+        node->bucket_ = bucket;
+        node->prev_ = nullptr;
+        node->next_ = bucket->head;
+        if(bucket->head)
+            bucket->head->prev_ = node;
+        else
+            bucket->tail = node;
+        bucket->head = node;
+    }
+
+    void reserve(uint64_t count)
+    {
+        size_t bounded = static_cast<size_t>(std::min<uint64_t>(count, capacity_));
+        mainCache_.reserve(bounded);
+        pool_.reserve(bounded);
+        bucketPool_.reserve(bounded);
+    }
+
+    void unlinkFromBucket(NodePtr node)
+    {
+        BucketType* bucket = node->bucket_;
+        if(node->prev_)
+            node->prev_->next_ = node->next_;
+        else
+            bucket->head = node->next_;
+        if(node->next_)
+            node->next_->prev_ = node->prev_;
+        else
+            bucket->tail = node->prev_;
+        node->prev_ = nullptr;
+        node->next_ = nullptr;
+        node->bucket_ = nullptr;
+    }
+
+    void releaseNode(NodePtr node)
+    {
+        timers_.cancel(node);
+        node->value_ = Value();
+        pool_.release(node);
     }
 
 
 
 private:
-    size_t capacity_;
-    size_t ghostCapacity_;
+    size_t capacity_;        // weight budget of the main cache, an entry count when no weigher is set
+    size_t mainWeight_ = 0;  // total weight of the resident nodes
     size_t transformThreshold_;
-    size_t minFreq_;
-    std::mutex mutex_;
+    ZPTimingWheel timers_;       // only resident nodes with a TTL are scheduled
+    uint64_t now_ = 0;           // time of the last expire(); with an empty wheel no node can be expired
+    ArcRemovalListener<Key, Value> removalListener_;
 
+    ZPNodePool<NodeType> pool_;
+    ZPNodePool<BucketType> bucketPool_; // at most one bucket per resident node
     NodeMap mainCache_;
-    NodeMap ghostCache_;
-    FreqMap freqMap_;
-
-    NodePtr ghostHead_;
-    NodePtr ghostTail_;
+    ArcGhostList ghosts_; // hashes of recently evicted keys
+    BucketType freqHead_; // sentinel of the ordered bucket chain
 };
 
 
-} // namespace ZPCache
\ No newline at end of file
+} // namespace ZPCache
@@ -2,115 +2,327 @@
 
 
 #include "ZPArcCacheNode.h"
+#include "ZPArcGhostList.h"
+#include "../ZPCachePolicy.h"
+#include "../ZPFlatHashMap.h"
+#include "../ZPNodePool.h"
+#include "../ZPSnapshot.h"
+#include <algorithm>
 #include <cstddef>
 #include <memory>
-#include <mutex>
-#include <unordered_map>
+#include <memory_resource>
 
 
 namespace ZPCache {
 
+// LRU half of ARC (T1/B1). Not synchronized on its own: every call is made by ZPArcCache while it holds its mutex.
 template<typename Key, typename Value>
 class ArcLruPart
 {
 public:
     using NodeType = ArcNode<Key, Value>;
-    using NodePtr = std::shared_ptr<NodeType>;
-    using NodeMap = std::unordered_map<Key, NodePtr>;
+    using NodePtr = NodeType*;
+    using NodeMap = ZPFlatHashMap<Key, NodePtr>;
 
     explicit ArcLruPart(size_t capacity, size_t transformThreshold)
+    : ArcLruPart(capacity, transformThreshold, capacity)
+    {}
+
+    // capacity 是主链表与幽灵表各自的权重上限；按权重计容量时条目数未知，结点池、索引与幽灵表只按 reserveCount 预留。
+    // 都从 resource 分配
+    ArcLruPart(size_t capacity, size_t transformThreshold, size_t reserveCount,
+               std::pmr::memory_resource* resource = std::pmr::get_default_resource())
     : capacity_(capacity)
-    , ghostCapacity_(capacity)
     , transformThreshold_(transformThreshold)
+    , pool_(reserveCount + 2, resource) // 主链表 + 2个虚拟结点
+    , mainCache_(reserveCount, resource)
+    , ghosts_(capacity, reserveCount, resource)
     {
         initializeLists();
     }
 
-    bool put(Key key, Value value)
+    // weight 由 ZPArcCache 计算，未设置 weigher 时为1；expiresAt 为0表示不过期
+    bool put(Key key, Value value, size_t weight = 1, uint64_t expiresAt = 0)
     {
-        if(capacity_ == 0) return false;
-
-        std::lock_guard<std::mutex> lock(mutex_);
         auto it = mainCache_.find(key);
+        if(weight > capacity_)
+        {
+            // 放不下新值，旧值也不能留着
+            if(it != mainCache_.end())
+                removeFromMain(it->second);
+            return false;
+        }
+
         if(it!=mainCache_.end())
         {
-            return updateExistingNode(it->second, value);
+            return updateExistingNode(it->second, std::move(value), weight, expiresAt);
         }
-        return addNewNode(key, value);
+        return addNewNode(key, std::move(value), weight, expiresAt);
     }
 
-    bool get(Key key, Value& value, bool& shouldTransform)
+    bool remove(const Key& key)
     {
-        std::lock_guard<std::mutex> lock(mutex_);
         auto it = mainCache_.find(key);
-        if(it!= mainCache_.end())
+        if(it == mainCache_.end())
+            return false;
+        removeFromMain(it->second);
+        return true;
+    }
+
+    // 回收到期的结点（直接删除，不进入幽灵链表），并记下now供之后的命中判断使用
+    void expire(uint64_t now)
+    {
+        now_ = now;
+        timers_.advance(now, [this](ZPTimerLink* link)
         {
-            shouldTransform = updateNodeAccess(it->second);
-            value = it->second->getValue();
+            expireNode(static_cast<NodePtr>(link));
+        });
+    }
+
+    bool hasTimers() const { return !timers_.empty(); }
+
+    template<typename Lookup>
+    bool contain(const Lookup& key, size_t hash) const
+    {
+        return mainCache_.find(key, hash) != mainCache_.end();
+    }
+
+    // 主链表因容量淘汰或TTL到期移出结点时调用，由 ZPArcCache 设置
+    void setRemovalListener(ArcRemovalListener<Key, Value> listener) { removalListener_ = std::move(listener); }
+
+    // 只影响之后的访问，已达到新阈值的条目在下一次命中时转入LFU部分
+    void setTransformThreshold(size_t transformThreshold) { transformThreshold_ = transformThreshold; }
+
+    // 主表中结点的过期时间，不在主表或没有TTL时返回0
+    uint64_t expiresAtOf(const Key& key) const
+    {
+        auto it = mainCache_.find(key);
+        return it != mainCache_.end() ? it->second->expiresAt() : 0;
+    }
+
+    bool get(Key key, Value& value, bool& shouldTransform)
+    {
+        NodePtr node = access(key, shouldTransform);
+        if(node)
+        {
+            value = node->getValue();
             return true;
         }
         return false;
     }
 
-    bool checkGhost(Key key){
-        auto it = ghostCache_.find(key);
-        if(it!=ghostCache_.end())
+    // 记录一次访问并返回结点（未命中返回nullptr），供调用者在锁内直接读取值
+    NodePtr access(const Key& key, bool& shouldTransform)
+    {
+        return access(key, mainCache_.hashOf(key), shouldTransform);
+    }
+
+    // lookup 是 Key 或其视图，hash 与 hashOf 一致，由 ZPArcCache 对两部分的主表与幽灵表共用
+    template<typename Lookup>
+    NodePtr access(const Lookup& key, size_t hash, bool& shouldTransform)
+    {
+        auto it = mainCache_.find(key, hash);
+        if(it!= mainCache_.end())
         {
-            reMoveFromGhost(it->second);
-            ghostCache_.erase(it);
-            return true;
+            if(it->second->expiredAt(now_))
+            {
+                // 已过期但还没轮到定时轮回收
+                expireNode(it->second);
+                return nullptr;
+            }
+            shouldTransform = updateNodeAccess(it->second);
+            return it->second;
         }
-        return false;
+        return nullptr;
     }
 
-    void increasCapacity() { ++capacity_; }
+    // 命中幽灵表时移除该幽灵并返回它记录的权重，未命中返回0；hash 与主表的 hashOf 一致
+    size_t checkGhost(size_t hash){
+        return ghosts_.take(hash);
+    }
 
-    bool decreaseCapacity()
+    // 预取key在主缓存与幽灵缓存索引中的槽位，供批量操作使用
+    void prefetch(const Key& key) const
     {
-        if(capacity_ <= 0) return false;
-        if(mainCache_.size() == capacity_) {
-            evicitLeastRecent();
+        size_t hash = mainCache_.hashOf(key);
+        mainCache_.prefetchHash(hash);
+        ghosts_.prefetch(hash);
+    }
+
+    // 主链表从新到旧写出键、值、访问次数与剩余TTL，幽灵表从旧到新写出哈希与权重
+    void writeSnapshot(ZPSnapshotWriter& out, uint64_t now) const
+    {
+        out.write(static_cast<uint64_t>(mainCache_.size()));
+        for(NodePtr node = mainHead_->next_; node != mainTail_; node = node->next_)
+        {
+            out.write(node->key_);
+            out.write(node->value_);
+            out.write(static_cast<uint64_t>(node->accessCount_));
+            out.writeTtl(node->expiresAt(), now);
+        }
+        out.write(static_cast<uint64_t>(ghosts_.size()));
+        ghosts_.forEach([&](uint64_t hash, uint64_t weight)
+        {
+            out.write(hash);
+            out.write(weight);
+        });
+    }
+
+    // 清空后按快照重建，capacity 为恢复出的自适应容量；每条记录都追加到最旧的一端，装不下的记录只解码跳过
+    template<typename Weigh>
+    bool readSnapshot(ZPSnapshotReader& in, uint64_t now, size_t capacity, Weigh&& weigh)
+    {
+        clear();
+        capacity_ = capacity;
+        timers_.advance(now, [](ZPTimerLink*) {});
+        now_ = now;
+
+        uint64_t count = 0;
+        if(!in.read(count))
+            return false;
+        reserve(in.boundCount(count));
+        for(uint64_t i = 0; i < count; ++i)
+        {
+            Key key{};
+            Value value{};
+            uint64_t accessCount = 0;
+            uint64_t ttl = 0;
+            if(!in.read(key) || !in.read(value) || !in.read(accessCount) || !in.read(ttl))
+                return false;
+
+            uint64_t expiresAt = 0;
+            if(!in.restoreDeadline(ttl, now, expiresAt))
+                continue;
+            size_t weight = weigh(key, value);
+            if(weight > capacity_ - mainWeight_ || mainCache_.find(key) != mainCache_.end())
+                continue;
+
+            NodePtr node = pool_.acquire();
+            node->key_ = std::move(key);
+            node->value_ = std::move(value);
+            node->accessCount_ = std::max<uint64_t>(accessCount, 1);
+            node->weight_ = weight;
+            mainWeight_ += weight;
+            setExpiry(node, expiresAt);
+            mainCache_[node->key_] = node;
+            insertBefore(mainTail_, node);
+        }
+
+        if(!in.read(count))
+            return false;
+        for(uint64_t i = 0; i < count; ++i)
+        {
+            uint64_t hash = 0;
+            uint64_t weight = 0;
+            if(!in.read(hash) || !in.read(weight))
+                return false;
+            ghosts_.push(static_cast<size_t>(hash), static_cast<size_t>(std::max<uint64_t>(weight, 1)));
         }
-        --capacity_;
         return true;
     }
 
+    // 释放主链表中的全部结点并清空幽灵表
+    void clear()
+    {
+        for(NodePtr node = mainHead_->next_; node != mainTail_;)
+        {
+            NodePtr next = node->next_;
+            releaseNode(node);
+            node = next;
+        }
+        mainHead_->next_ = mainTail_;
+        mainTail_->prev_ = mainHead_;
+        mainCache_.clear();
+        ghosts_.clear();
+        timers_.clear();
+        mainWeight_ = 0;
+    }
+
+    void increasCapacity(size_t delta = 1) { capacity_ += delta; }
+
+    size_t capacity() const { return capacity_; }
+    size_t weight() const { return mainWeight_; }
+
+    // 容量至多减少delta，返回实际减少的量；超出新容量的结点淘汰到幽灵表
+    size_t decreaseCapacity(size_t delta = 1)
+    {
+        delta = std::min(delta, capacity_);
+        capacity_ -= delta;
+        while(mainWeight_ > capacity_) {
+            evicitLeastRecent();
+        }
+        return delta;
+    }
+
 
 
 private:
     void initializeLists()
     {
-        mainHead_ = std::make_shared<NodeType>();
-        mainTail_ = std::make_shared<NodeType>();
+        mainHead_ = pool_.acquire();
+        mainTail_ = pool_.acquire();
         mainHead_->next_ = mainTail_;
         mainTail_->prev_ = mainHead_;
-
-        ghostHead_ = std::make_shared<NodeType>();
-        ghostTail_ = std::make_shared<NodeType>();
-        ghostHead_->next_ = ghostTail_;
-        ghostTail_->prev_= ghostHead_;
     }
 
-    bool updateExistingNode(NodePtr node, const Value& value)
+    bool updateExistingNode(NodePtr node, Value value, size_t weight, uint64_t expiresAt)
     {
-        node->setValue(value);
+        mainWeight_ = mainWeight_ - node->weight_ + weight;
+        node->weight_ = weight;
+        node->value_ = std::move(value);
+        setExpiry(node, expiresAt);
         moveToFront(node);
+        while(mainWeight_ > capacity_)
+        {
+            evicitLeastRecent();
+        }
         return true;
     }
 
-    bool addNewNode(const Key& key, const Value& value)
+    bool addNewNode(const Key& key, Value value, size_t weight, uint64_t expiresAt)
     {
-        if(mainCache_.size() >= capacity_)
+        while(mainWeight_ + weight > capacity_ && mainCache_.size() > 0)
         {
             evicitLeastRecent(); // 驱逐最近最少访问
         }
 
-        NodePtr newNode = std::make_shared<NodeType>(key,value);
+        NodePtr newNode = pool_.acquire();
+        newNode->key_ = key;
+        newNode->value_ = std::move(value);
+        newNode->accessCount_ = 1;
+        newNode->weight_ = weight;
+        mainWeight_ += weight;
+        setExpiry(newNode, expiresAt);
         mainCache_[key] = newNode;
         addToFront(newNode);
         return true;
     }
 
+    void setExpiry(NodePtr node, uint64_t expiresAt)
+    {
+        if(expiresAt)
+            timers_.schedule(node, expiresAt);
+        else
+            timers_.cancel(node);
+    }
+
+    // TTL到期：先通知，再直接删除，不进入幽灵链表
+    void expireNode(NodePtr node)
+    {
+        if(removalListener_)
+            removalListener_(node->key_, node->value_, true);
+        removeFromMain(node);
+    }
+
+    // 直接删除主链表中的结点，不进入幽灵链表
+    void removeFromMain(NodePtr node)
+    {
+        unlink(node);
+        mainWeight_ -= node->weight_;
+        mainCache_.erase(node->key_);
+        releaseNode(node);
+    }
+
     bool updateNodeAccess(NodePtr node)
     {
         moveToFront(node);
@@ -121,17 +333,27 @@ private:
     void moveToFront(NodePtr node)
     {
         // remove from this site
-        if(!node->prev_.expired() && node->next_) {
-            auto prev = node->prev_.lock();
-            prev->next_ = node->next_;
-            node->next_->prev_ = node->prev_;
-            node->next_ = nullptr; // clear ptr, 防止悬垂引用
-        }
+        unlink(node);
 
         // add to head
         addToFront(node);
     }
 
+    void insertBefore(NodePtr pos, NodePtr node)
+    {
+        node->next_ = pos;
+        node->prev_ = pos->prev_;
+        pos->prev_->next_ = node;
+        pos->prev_ = node;
+    }
+
+    void reserve(uint64_t count)
+    {
+        size_t bounded = static_cast<size_t>(std::min<uint64_t>(count, capacity_));
+        mainCache_.reserve(bounded);
+        pool_.reserve(bounded);
+    }
+
     void addToFront(NodePtr node)
     {
         node->next_ = mainHead_->next_;
@@ -142,86 +364,56 @@ private:
 
     void evicitLeastRecent()
     {
-        NodePtr leastRecent = mainTail_->prev_.lock();
-        if(!leastRecent || leastRecent == mainHead_)
+        NodePtr leastRecent = mainTail_->prev_;
+        if(leastRecent == mainHead_)
             return;
 
         // delete from main list
-        removeFromMain(leastRecent);
-
-        // add to ghost(👻) cache
-        if(ghostCache_.size() >= ghostCapacity_)
-        {
-            removeOldestGhost();
-        }
-        addToGhost(leastRecent);
-
-        // 从主缓存映射中移除
-        mainCache_.erase(leastRecent->getKey());
+        unlink(leastRecent);
+        mainWeight_ -= leastRecent->weight_;
+        mainCache_.erase(leastRecent->key_);
+        if(removalListener_)
+            removalListener_(leastRecent->key_, leastRecent->value_, false);
+
+        // add to ghost(👻) cache：幽灵只记key的哈希和权重，结点与值立即释放
+        ghosts_.push(mainCache_.hashOf(leastRecent->key_), leastRecent->weight_);
+        releaseNode(leastRecent);
     }
 
-    void removeFromMain(NodePtr node)
+    // 从主链表中摘下结点
+    void unlink(NodePtr node)
     {
-        if(!node->prev_.expired() && node->next_)
-        {
-            auto prev = node->prev_.lock();
-            prev->next_ = node->next_;
-            prev->next_->prev_ = node->prev_;
-            node->next_ = nullptr;
-        }
-    }
-
-    void reMoveFromGhost(NodePtr node){
-        if(!node->prev_.expired() && node->next_)
+        if(node->prev_ && node->next_)
         {
-            auto prev = node->prev_.lock();
-            prev->next_ = node->next_;
-            prev->next_->prev_ = node->prev_;
+            node->prev_->next_ = node->next_;
+            node->next_->prev_ = node->prev_;
+            node->prev_ = nullptr;
             node->next_ = nullptr;
         }
     }
 
-    void addToGhost(NodePtr node)
+    void releaseNode(NodePtr node)
     {
-        // reset access count of node
-        node->accessCount_ = 1;
-
-        // add to head of ghost cache
-        node->next_ = ghostHead_->next_;
-        node->prev_ = ghostHead_;
-        ghostHead_->next_->prev_ = node;
-        ghostHead_->next_ = node;
-
-        // add to cache map of ghost
-        ghostCache_[node->getKey()]=node;
-    }
-
-    void removeOldestGhost()
-    {
-        // 使用lock
-        NodePtr oldestGhost = ghostTail_->prev_.lock();
-        if(!oldestGhost || oldestGhost == ghostHead_)
-            return;
-
-        removeFromMain(oldestGhost);
-        ghostCache_.erase(oldestGhost->getKey());
+        timers_.cancel(node);
+        node->value_ = Value();
+        pool_.release(node);
     }
 
 private:
-    size_t capacity_;
-    size_t ghostCapacity_;
+    size_t capacity_;            // 主链表的权重上限，未设置weigher时即条目数
+    size_t mainWeight_ = 0;      // 主链表中所有结点的权重之和
     size_t transformThreshold_; // 转换门槛阈值
-    std::mutex mutex_;
-    
+    ZPTimingWheel timers_;       // 只挂主链表中带TTL的结点
+    uint64_t now_ = 0;           // 最近一次expire的时间，定时轮为空时没有结点会过期
+    ArcRemovalListener<Key, Value> removalListener_;
+
+    ZPNodePool<NodeType> pool_; // 主链表的结点存储
     NodeMap mainCache_; // key-> arcNode
-    NodeMap ghostCache_;
+    ArcGhostList ghosts_; // 被淘汰的key的哈希
 
     // mian list
     NodePtr mainHead_;
     NodePtr mainTail_;
-    // list out 
-    NodePtr ghostHead_;
-    NodePtr ghostTail_;
 };
 
-} // namespace ZPCache
\ No newline at end of file
+} // namespace ZPCache